@@ -0,0 +1,232 @@
+/***************************************************
+Decode and seek benchmark of FFGrabber.
+
+For one video, measures:
+  decode         every frame in one capture (frames per second)
+  sparse         single frames at random, one build/capture/cleanUp each, as mmread does
+  sparseBatch    the same frames in one setFrames capture
+  sparseSession  the same frames in increasing order in a persistent session
+  window         one second windows at random with setTime
+and prints one JSON object per line with the latencies (ms), the peak resident memory
+of the process so far (kB) and the number and size of the allocations of the test.
+The random frames and windows are drawn with a fixed seed, so that runs on different
+commits measure the same requests.
+
+usage: benchFFGrab video [nbRequests [repeats]]
+
+build: g++ -O2 benchFFGrab.cpp ../dataAPI/MappedFile.cpp -lavbin -pthread -o benchFFGrab
+**************************************************/
+
+#include "../frameGrabAPI/FFGrab.cpp"
+
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+// the allocations of the process: malloc, calloc and realloc (operator new too), and
+// posix_memalign, which ffmpeg uses for its frames and packets
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+
+static std::atomic<size_t> allocations(0), allocatedBytes(0);
+
+extern "C" void* malloc(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(n*size, std::memory_order_relaxed);
+	return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* p, size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	return __libc_realloc(p, size);
+}
+
+extern "C" int posix_memalign(void** p, size_t alignment, size_t size)
+{
+	if (alignment < sizeof(void*) || (alignment & (alignment-1))) return EINVAL;
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	*p = __libc_memalign(alignment, size);
+	return *p ? 0 : ENOMEM;
+}
+#else
+static std::atomic<size_t> allocations(0), allocatedBytes(0);
+#endif
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static long maxRSS()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+// the frames are dropped as they are decoded, only the decoding is measured
+static void dropFrame(void* user, const uint8_t* /*data*/, unsigned int /*nrBytes*/, int /*width*/, int /*height*/, double /*time*/, unsigned int /*frameNr*/)
+{
+	(*(unsigned int*)user)++;
+}
+
+struct Result
+{
+	Result(const char* test) : test(test), frames(0), seconds(0), allocations(0), allocatedBytes(0) {}
+
+	const char* test;
+	vector<double> ms;
+	unsigned int frames;
+	double seconds;
+	size_t allocations, allocatedBytes;
+};
+
+static void report(const char* video, const Result &r)
+{
+	vector<double> ms(r.ms);
+	sort(ms.begin(), ms.end());
+	double mean = 0;
+	for (size_t i=0; i<ms.size(); i++) mean += ms[i]/ms.size();
+
+	printf("{\"benchmark\": \"FFGrab\", \"video\": \"%s\", \"test\": \"%s\", \"requests\": %d, \"frames\": %u, \"seconds\": %.6f, \"fps\": %.3f",
+		video, r.test, (int)ms.size(), r.frames, r.seconds, r.seconds > 0 ? r.frames/r.seconds : 0.0);
+	if (!ms.empty()) printf(", \"ms_mean\": %.3f, \"ms_median\": %.3f, \"ms_max\": %.3f", mean, ms[ms.size()/2], ms.back());
+	printf(", \"maxrss_kb\": %ld, \"allocations\": %zu, \"allocated_bytes\": %zu}\n", maxRSS(), r.allocations, r.allocatedBytes);
+	fflush(stdout);
+}
+
+// one capture of the frames or of [startTime, stopTime), the number of frames decoded
+static unsigned int capture(FFGrabber &FFG, char* video, vector<unsigned int> frames, double startTime, double stopTime, bool persistent)
+{
+	unsigned int nbFrames = 0;
+	FFG.setPersistent(persistent);
+	if (FFG.build(video,false,true,true)) return 0;
+	if (stopTime > 0)
+	{
+		FFG.setTime(startTime, stopTime);
+	} else if (!frames.empty()) {
+		FFG.setFrames(&frames[0], frames.size());
+	}
+	FFG.setFrameCallback(dropFrame, &nbFrames);
+	FFG.doCapture();
+	FFG.cleanUp();
+	return nbFrames;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		FFprintf("usage: %s video [nbRequests [repeats]]\n",argv[0]);
+		return 1;
+	}
+	char* video = argv[1];
+	int nbRequests = argc > 2 ? atoi(argv[2]) : 20;
+	int repeats = argc > 3 ? atoi(argv[3]) : 3;
+
+	FFGrabber FFG;
+
+	// the whole video, the best of the repeats
+	Result decode("decode");
+	for (int r=0; r<repeats; r++)
+	{
+		size_t a = allocations, b = allocatedBytes;
+		double t = now();
+		unsigned int frames = capture(FFG, video, vector<unsigned int>(), 0, 0, false);
+		t = now()-t;
+		if (r == 0 || t < decode.seconds)
+		{
+			decode.seconds = t;
+			decode.frames = frames;
+			decode.allocations = allocations-a;
+			decode.allocatedBytes = allocatedBytes-b;
+		}
+	}
+	if (decode.frames == 0)
+	{
+		FFprintf("could not decode %s\n",video);
+		return 1;
+	}
+	report(video, decode);
+
+	unsigned int nbFrames = decode.frames;
+	double duration = nbFrames/25.0;
+	int width, height, nrFramesCaptured, nrFramesTotal;
+	double rate, totalDuration;
+	FFG.build(video,false,true,true);
+	if (!FFG.getVideoInfo(0, &width, &height, &rate, &nrFramesCaptured, &nrFramesTotal, &totalDuration) && rate > 0) duration = nbFrames/rate;
+	FFG.close();
+
+	// the same requests on every run
+	srand(1);
+	vector<unsigned int> frames(nbRequests);
+	vector<double> starts(nbRequests);
+	for (int i=0; i<nbRequests; i++)
+	{
+		frames[i] = 1 + rand()%nbFrames;
+		starts[i] = max(duration-1,0.0)*(rand()/(double)RAND_MAX);
+	}
+
+	Result sparse("sparse"), batch("sparseBatch"), session("sparseSession"), window("window");
+	Result* results[] = {&sparse, &batch, &session, &window};
+	for (int k=0; k<4; k++)
+	{
+		Result &r = *results[k];
+		size_t a = allocations, b = allocatedBytes;
+		double start = now();
+		r.frames = 0;
+		if (k == 0)
+		{
+			for (int i=0; i<nbRequests; i++)
+			{
+				double t = now();
+				r.frames += capture(FFG, video, vector<unsigned int>(1,frames[i]), 0, 0, false);
+				r.ms.push_back(1000*(now()-t));
+			}
+		} else if (k == 1) {
+			double t = now();
+			r.frames = capture(FFG, video, frames, 0, 0, false);
+			r.ms.push_back(1000*(now()-t));
+		} else if (k == 2) {
+			vector<unsigned int> sorted(frames);
+			sort(sorted.begin(), sorted.end());
+			for (int i=0; i<nbRequests; i++)
+			{
+				double t = now();
+				r.frames += capture(FFG, video, vector<unsigned int>(1,sorted[i]), 0, 0, true);
+				r.ms.push_back(1000*(now()-t));
+			}
+			FFG.close();
+		} else {
+			for (int i=0; i<nbRequests; i++)
+			{
+				double t = now();
+				r.frames += capture(FFG, video, vector<unsigned int>(), starts[i], starts[i]+1, false);
+				r.ms.push_back(1000*(now()-t));
+			}
+		}
+		r.seconds = now()-start;
+		r.allocations = allocations-a;
+		r.allocatedBytes = allocatedBytes-b;
+		report(video, r);
+	}
+
+	return 0;
+}
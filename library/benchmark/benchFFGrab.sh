@@ -0,0 +1,32 @@
+#!/bin/sh
+# Generates the synthetic corpus (makeTestVideo) and runs benchFFGrab on every video;
+# the JSON results go to results.jsonl (or the first argument), one line per test.
+# Everything runs locally: the encoders and AVbin are the only dependencies.
+#
+# usage: ./benchFFGrab.sh [results [corpus directory]]
+# CODECS, SIZES (WxH), GOPS, FRAMES and REQUESTS override the corpus and the requests.
+
+set -e
+cd "$(dirname "$0")"
+
+RESULTS=${1:-results.jsonl}
+CORPUS=${2:-corpus}
+CODECS=${CODECS:-"mpeg1video mpeg2video mpeg4 libx264"}
+SIZES=${SIZES:-"640x480 1280x720 1920x1080"}
+GOPS=${GOPS:-"1 12 250"}
+FRAMES=${FRAMES:-500}
+REQUESTS=${REQUESTS:-20}
+
+mkdir -p "$CORPUS"
+for codec in $CODECS; do
+	for size in $SIZES; do
+		for gop in $GOPS; do
+			video="$CORPUS/${codec}_${size}_gop${gop}.mpg"
+			# the corpus is only generated once, so that successive runs decode the same files
+			if [ ! -s "$video" ]; then
+				./makeTestVideo "$video" "${size%x*}" "${size#*x}" "$FRAMES" "$codec" "$gop" > /dev/null || continue
+			fi
+			./benchFFGrab "$video" "$REQUESTS" >> "$RESULTS"
+		done
+	done
+done
@@ -0,0 +1,280 @@
+/***************************************************
+Micro-benchmarks of the image kernels.
+
+Every kernel runs on synthetic ROIs of the sizes found in
+our videos (a strip along the gauge length up to a full HD
+frame) with 3 to 24 markers, drawn with a fixed seed so
+that the results of different commits can be compared.
+Each measure is made twice:
+  warm  the same buffers over and over, the best of 5 batches of at least 50 ms
+  cold  the caches are flushed (64 MB written) before each of 9 runs, the median
+and reported as one JSON object per line with the time per pixel of the ROI (ns) and
+the bandwidth (GB/s) over the bytes the kernel reads.
+
+There are no intrinsic SIMD paths: the fast paths are the word parallel ones (64
+pixels per word for the binary images, four histogram banks and 8 byte reads), and
+each is measured next to a per-pixel scalar loop that computes the same result
+("path": "word" or "scalar").
+
+usage: benchKernels [WxH ...]
+
+build: g++ -O2 benchKernels.cpp ../trackerAPI/BlobTracker.cpp ../trackerAPI/Threshold.cpp ../trackerAPI/BinaryImage.cpp ../trackerAPI/Labelling.cpp ../trackerAPI/Prediction.cpp ../trackerAPI/WorkerPool.cpp ../trackerAPI/Projection.cpp -I<CImg> -pthread -o benchKernels
+(add -DWITHOUT_CIMG to leave out the FFGrab.h conversions and stretch when CImg and the ffmpeg headers are not installed)
+**************************************************/
+
+#ifndef WITHOUT_CIMG
+#include "../frameGrabAPI/FFGrab.h"
+#endif
+
+#include "../trackerAPI/BlobTracker.h"
+#include "../trackerAPI/Projection.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+using namespace std;
+
+static double now()
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// larger than the last level cache of the machines we run on
+static vector<uint8_t> flushBuffer(64 << 20);
+
+static void flushCaches()
+{
+	static uint8_t value = 0;
+	value++;
+	for (size_t i=0; i<flushBuffer.size(); i+=64) flushBuffer[i] = value;
+}
+
+struct Case
+{
+	int width, height, markers;
+};
+
+// seconds per call, warm or cold
+template <class F> static double measure(F f, bool cold)
+{
+	if (cold)
+	{
+		vector<double> t(9);
+		for (size_t i=0; i<t.size(); i++)
+		{
+			flushCaches();
+			double start = now();
+			f();
+			t[i] = now()-start;
+		}
+		sort(t.begin(), t.end());
+		return t[t.size()/2];
+	}
+
+	f();
+	double best = 1e300;
+	for (int batch=0; batch<5; batch++)
+	{
+		int calls = 0;
+		double start = now(), elapsed;
+		do
+		{
+			f();
+			calls++;
+			elapsed = now()-start;
+		} while (elapsed < 0.05);
+		best = min(best, elapsed/calls);
+	}
+	return best;
+}
+
+template <class F> static void bench(const char* kernel, const char* path, const Case &c, double bytes, F f)
+{
+	double pixels = (double)c.width*c.height;
+	for (int cold=0; cold<2; cold++)
+	{
+		double t = measure(f, cold != 0);
+		printf("{\"benchmark\": \"kernels\", \"kernel\": \"%s\", \"path\": \"%s\", \"width\": %d, \"height\": %d, \"markers\": %d, \"cache\": \"%s\", \"us\": %.3f, \"ns_per_pixel\": %.4f, \"gb_per_s\": %.3f}\n",
+			kernel, path, c.width, c.height, c.markers, cold ? "cold" : "warm", 1e6*t, 1e9*t/pixels, bytes/t/1e9);
+		fflush(stdout);
+	}
+}
+
+// interleaved RGB24 ROI: a noisy dark background and bright round markers along the middle
+static void makeROI(const Case &c, vector<uint8_t> &frame)
+{
+	frame.resize((size_t)c.width*c.height*3);
+	uint32_t noise = 1;
+	double radius = max(min(c.height/6.0, 0.4*c.width/c.markers), 2.0);
+	for (int y=0; y<c.height; y++)
+	{
+		for (int x=0; x<c.width; x++)
+		{
+			noise = noise*1664525u + 1013904223u;
+			int v = 40 + (noise >> 28);
+			for (int m=0; m<c.markers; m++)
+			{
+				double mx = (m+0.5)*c.width/c.markers, my = c.height/2.0 + ((m%3)-1)*radius/2;
+				if (hypot(x+0.5-mx, y+0.5-my) < radius) v = 200 + (noise >> 28);
+			}
+			uint8_t* p = &frame[((size_t)y*c.width+x)*3];
+			p[0] = p[1] = p[2] = v;
+		}
+	}
+}
+
+// the per-pixel references of the binary kernels, on 0/1 bytes
+static void scalarPack(const uint8_t* frame, int width, int height, int cut, vector<uint8_t> &mask)
+{
+	for (size_t i=0; i<(size_t)width*height; i++) mask[i] = frame[3*i] > cut;
+}
+
+static void scalarDilate(const vector<uint8_t> &in, int width, int height, vector<uint8_t> &out)
+{
+	for (int y=0; y<height; y++)
+	{
+		for (int x=0; x<width; x++)
+		{
+			uint8_t v = 0;
+			for (int dy=-1; dy<=1 && !v; dy++)
+			{
+				for (int dx=-1; dx<=1; dx++)
+				{
+					int u = x+dx, w = y+dy;
+					if (u >= 0 && u < width && w >= 0 && w < height && in[(size_t)w*width+u]) v = 1;
+				}
+			}
+			out[(size_t)y*width+x] = v;
+		}
+	}
+}
+
+static void scalarMedian(const vector<uint8_t> &in, int width, int height, vector<uint8_t> &out)
+{
+	for (int y=0; y<height; y++)
+	{
+		for (int x=0; x<width; x++)
+		{
+			int count = 0;
+			for (int dy=-1; dy<=1; dy++)
+			{
+				for (int dx=-1; dx<=1; dx++)
+				{
+					int u = x+dx, w = y+dy;
+					if (u >= 0 && u < width && w >= 0 && w < height) count += in[(size_t)w*width+u];
+				}
+			}
+			out[(size_t)y*width+x] = count > 4;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	vector<pair<int,int> > sizes;
+	for (int i=1; i<argc; i++)
+	{
+		int w, h;
+		if (sscanf(argv[i], "%dx%d", &w, &h) == 2 && w > 0 && h > 0) sizes.push_back(make_pair(w,h));
+	}
+	if (sizes.empty())
+	{
+		// gauge length strips of the tensile videos, and a full frame
+		sizes.push_back(make_pair(400,100));
+		sizes.push_back(make_pair(900,200));
+		sizes.push_back(make_pair(1600,300));
+		sizes.push_back(make_pair(1920,1080));
+	}
+	int markerCounts[] = {3, 24};
+
+	for (size_t s=0; s<sizes.size(); s++)
+	{
+		for (int k=0; k<2; k++)
+		{
+			Case c = {sizes[s].first, sizes[s].second, markerCounts[k]};
+			size_t n = (size_t)c.width*c.height;
+			vector<uint8_t> frame;
+			makeROI(c, frame);
+			ImageView view = interleavedView(&frame[0], c.width, c.height);
+
+			// the kernels that do not depend on the markers once
+			if (k == 0)
+			{
+				unsigned int hist[256];
+				bench("histogram", "word", c, n, [&]()
+				{
+					memset(hist, 0, sizeof(hist));
+					for (int y=0; y<c.height; y++) accumulateHistogram(&frame[(size_t)y*c.width*3], 3, c.width, hist);
+				});
+				bench("histogram", "scalar", c, n, [&]()
+				{
+					memset(hist, 0, sizeof(hist));
+					for (size_t i=0; i<n; i++) hist[frame[3*i]]++;
+				});
+
+				BinaryImage bits(c.width, c.height), dilated, filtered;
+				vector<uint8_t> mask(n), mask2(n);
+				bench("threshold", "word", c, n, [&]() { bits.pack(&frame[0], 3, (ptrdiff_t)c.width*3, 127); });
+				bench("threshold", "scalar", c, n, [&]() { scalarPack(&frame[0], c.width, c.height, 127, mask); });
+				bench("dilate3x3", "word", c, n/8.0, [&]() { bits.dilate(dilated, 3, 3); });
+				bench("dilate3x3", "scalar", c, n, [&]() { scalarDilate(mask, c.width, c.height, mask2); });
+				bench("median3x3", "word", c, n/8.0, [&]() { dilated.median(filtered, 3, 3); });
+				bench("median3x3", "scalar", c, n, [&]() { scalarMedian(mask2, c.width, c.height, mask); });
+
+#ifndef WITHOUT_CIMG
+				vector<float> unit(n*3), half((size_t)(c.width/2)*(c.height/2)*3);
+				vector<uint8_t> bytes(n*3);
+				bench("bytesToUnit", "scalar", c, n*3, [&]() { bytesToUnit(&frame[0], &unit[0], n*3); });
+				bench("unitToBytes", "scalar", c, n*3*sizeof(float), [&]() { unitToBytes(&unit[0], &bytes[0], n, true); });
+				// the work of resize() for one frame (resize itself also prints)
+				bench("stretch", "scalar", c, n*3*sizeof(float), [&]() { stretch(&unit[0], c.width, c.height, &half[0], c.width/2, c.height/2); });
+#endif
+			}
+
+			// labelling of the filtered image, one line of runs at a time
+			BinaryImage bits(c.width, c.height);
+			bits.pack(&frame[0], 3, (ptrdiff_t)c.width*3, 127);
+			Labelling labels;
+			vector<pair<int,int> > runs;
+			vector<int> selected;
+			bench("labelling", "word", c, n/8.0, [&]()
+			{
+				labels.reset(true, false);
+				for (int y=0; y<c.height; y++)
+				{
+					runs.clear();
+					findRuns(bits.line(y), bits.nbWords, c.width, runs);
+					labels.addLine(y, runs, &frame[(size_t)y*c.width*3], 3);
+				}
+				labels.resolve();
+				labels.select(1, c.markers, selected);
+			});
+
+			// the whole blob tracker, on one thread and on all of them, and the projection tracker
+			vector<Blob> blobs;
+			double level;
+			int threadCounts[] = {1, 0};
+			for (int t=0; t<2; t++)
+			{
+				BlobTracker BT;
+				BT.setOptions(-1, 3, 3, 10, c.markers);
+				BT.setThreads(threadCounts[t]);
+				BT.setROI(1, 1, c.width, c.height);
+				bench(t ? "blobTracker" : "blobTracker1", "word", c, n, [&]() { BT.track(view, blobs, &level); });
+			}
+
+			ProjectionTracker PT;
+			vector<ProfileMarker> markers;
+			PT.setOptions(c.markers, 5, 1, 20);
+			PT.setROI(1, 1, c.width, c.height);
+			bench("projection", "scalar", c, n, [&]() { PT.track(view, markers); });
+		}
+	}
+
+	return 0;
+}
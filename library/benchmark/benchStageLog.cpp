@@ -0,0 +1,178 @@
+/***************************************************
+Benchmark and check of the stage log reader (StageLog.h).
+
+A synthetic log in the format of the tensile stage (the
+header of the bundled stage_*.txt, a line of '=', the
+column names and rows of "value \t" every 0.1 s) is written
+with known values: the displacement and the force of a row
+follow from its number.  Every 1000th row has an empty
+displacement field ("99.9 \t\t5 \t") and every 1001st a
+force field of spaces, which must be read as NaN and not as
+the value of the next column.  The open (header and row
+count), the read of two of the four columns, the time index
+and the interpolation at every video frame (25 fps) are
+timed and printed as one JSON object per log size, with
+the number of wrong values; the run fails (exit code 2)
+when there is one.  The log is written to -output.
+
+usage: benchStageLog [-threads n] [-output file] [rows ...]
+
+build: g++ -O2 benchStageLog.cpp ../dataAPI/StageLog.cpp ../dataAPI/MappedFile.cpp ../dataAPI/Numbers.cpp ../trackerAPI/WorkerPool.cpp -pthread -o benchStageLog
+**************************************************/
+
+#include "../dataAPI/StageLog.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <vector>
+using namespace std;
+
+static double now()
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool emptyDisplacement(long i)
+{
+	return i%1000 == 999;
+}
+
+static bool blankForce(long i)
+{
+	return i%1001 == 1000;
+}
+
+static double displacement(long i)
+{
+	return 0.001*i;
+}
+
+static double force(long i)
+{
+	return 5 + 0.25*(i%400);
+}
+
+static int writeLog(const char* path, long nbRows)
+{
+	FILE* f = fopen(path, "wb");
+	if (!f) return -3;
+	fprintf(f, "Project Title : exSitu_35Zr39Ti25Nb \r\nMaterial : 35Zr39Ti25Nb \r\nInformations :  \r\nType test : Tension / Compression \r\n");
+	fprintf(f, "==========================================\r\n");
+	fprintf(f, "Time (s) \tDisplacement (mm) \tForce (N) \tStress (MPa) \t\r\n");
+	for (long i=0; i<nbRows; i++)
+	{
+		fprintf(f, "%f \t", 0.1*i);
+		if (!emptyDisplacement(i)) fprintf(f, "%f ", displacement(i));
+		fprintf(f, "\t");
+		if (blankForce(i)) fprintf(f, "   \t");
+		else fprintf(f, "%f \t", force(i));
+		fprintf(f, "%f \t\r\n", 2*force(i));
+	}
+	fclose(f);
+	return 0;
+}
+
+static bool same(double a, double b)
+{
+	return isnan(b) ? isnan(a) : fabs(a-b) <= 1e-6;
+}
+
+// one log: returns false when the check fails
+static bool run(const char* path, long nbRows, int nbThreads)
+{
+	int err = writeLog(path, nbRows);
+	if (err)
+	{
+		fprintf(stderr, "cannot write %s\n", path);
+		return false;
+	}
+
+	StageLog log;
+	double start = now();
+	err = log.open(path, nbThreads);
+	double open = now()-start;
+
+	long wrong = 0;
+	double read = 0, index = 0, interpolate = 0;
+	if (!err)
+	{
+		vector<int> columns(2);
+		columns[0] = log.findColumn("Displacement (mm)");
+		columns[1] = log.findColumn("Force (N)");
+		vector<double> values;
+		start = now();
+		err = log.read(columns, values);
+		read = now()-start;
+
+		if (!err)
+		{
+			if (log.nbRows() != nbRows) wrong += labs(log.nbRows()-nbRows);
+			for (long i=0; i<nbRows && i<log.nbRows(); i++)
+			{
+				double nan = numeric_limits<double>::quiet_NaN();
+				wrong += !same(values[i], emptyDisplacement(i) ? nan : displacement(i));
+				wrong += !same(values[nbRows+i], blankForce(i) ? nan : force(i));
+			}
+
+			start = now();
+			err = log.buildIndex();
+			index = now()-start;
+		}
+
+		if (!err)
+		{
+			// the frames of a video over the whole test, between the samples
+			int nbFrames = (int)(0.1*(nbRows-1)*25);
+			vector<double> times(nbFrames), interpolated;
+			for (int j=0; j<nbFrames; j++) times[j] = j/25.0;
+			start = now();
+			err = log.interpolate(columns, &times[0], nbFrames, interpolated);
+			interpolate = now()-start;
+
+			for (int j=0; !err && j<nbFrames; j++)
+			{
+				long i = (long)floor(10*times[j]+1e-9);
+				double w = 10*times[j]-i;
+				if (i+1 >= nbRows || emptyDisplacement(i) || emptyDisplacement(i+1)) continue;
+				wrong += !same(interpolated[j], displacement(i) + w*(displacement(i+1)-displacement(i)));
+			}
+		}
+	}
+
+	bool ok = !err && wrong == 0;
+	printf("{\"benchmark\": \"stagelog\", \"rows\": %ld, \"open_ms\": %.3f, \"read_ms\": %.3f, \"index_ms\": %.3f, \"interpolate_ms\": %.3f, \"error\": %d, \"wrong\": %ld, \"ok\": %s}\n",
+		nbRows, 1e3*open, 1e3*read, 1e3*index, 1e3*interpolate, err, wrong, ok ? "true" : "false");
+	fflush(stdout);
+	log.close();
+	remove(path);
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	int nbThreads = 0;
+	const char* path = "stage_bench.txt";
+	vector<long> sizes;
+	for (int i=1; i<argc; i++)
+	{
+		if (!strcmp(argv[i], "-threads") && i+1 < argc) nbThreads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-output") && i+1 < argc) path = argv[++i];
+		else if (atol(argv[i]) > 1) sizes.push_back(atol(argv[i]));
+	}
+	if (sizes.empty())
+	{
+		// a tensile test of a few minutes, an hour and a long creep test
+		sizes.push_back(2000);
+		sizes.push_back(36000);
+		sizes.push_back(2000000);
+	}
+
+	bool ok = true;
+	for (size_t s=0; s<sizes.size(); s++) ok = run(path, sizes[s], nbThreads) && ok;
+	return ok ? 0 : 2;
+}
@@ -0,0 +1,154 @@
+/***************************************************
+Benchmark and check of the strain field (Strain.h).
+
+Grids of markers as videoTracker finds them (nx x ny
+markers 20 px apart, regular or jittered with a fixed seed)
+are triangulated and every frame of a uniform stretch is
+turned into element strains.  The triangles must cover the
+convex hull of the markers exactly (the area of the hull,
+by a monotone chain, against the sum of the triangle areas
+of triangulate without a minimum area; setReference then
+drops the slivers) and the strain of every element must be
+the one of the stretch.  The triangulation time, the time
+per frame and the largest errors are printed as one JSON
+object per grid; the run fails (exit code 2) when an error
+is above the tolerance.
+
+usage: benchStrain [-threads n] [NXxNY ...]
+
+build: g++ -O2 benchStrain.cpp ../trackerAPI/Strain.cpp ../trackerAPI/WorkerPool.cpp -pthread -o benchStrain
+**************************************************/
+
+#include "../trackerAPI/Strain.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+using namespace std;
+
+static double now()
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double cross(const pair<double,double> &o, const pair<double,double> &a, const pair<double,double> &b)
+{
+	return (a.first-o.first)*(b.second-o.second) - (a.second-o.second)*(b.first-o.first);
+}
+
+// area of the convex hull, Andrew's monotone chain
+static double hullArea(const vector<double> &x, const vector<double> &y)
+{
+	vector<pair<double,double> > p(x.size()), hull(2*x.size());
+	for (size_t i=0; i<x.size(); i++) p[i] = make_pair(x[i],y[i]);
+	sort(p.begin(), p.end());
+	int k = 0;
+	for (size_t i=0; i<p.size(); i++)
+	{
+		while (k >= 2 && cross(hull[k-2], hull[k-1], p[i]) <= 0) k--;
+		hull[k++] = p[i];
+	}
+	for (int i=(int)p.size()-2, lower=k+1; i>=0; i--)
+	{
+		while (k >= lower && cross(hull[k-2], hull[k-1], p[i]) <= 0) k--;
+		hull[k++] = p[i];
+	}
+	double area = 0;
+	for (int i=0; i+1<k; i++) area += hull[i].first*hull[i+1].second - hull[i+1].first*hull[i].second;
+	return 0.5*area;
+}
+
+// one grid: returns false when the check fails
+static bool run(int nx, int ny, double jitter, int nbThreads)
+{
+	const double pitch = 20;
+	const int nbFrames = 200;
+	int n = nx*ny;
+	vector<double> x(n), y(n);
+	srand(12345);
+	for (int i=0; i<n; i++)
+	{
+		x[i] = 100 + pitch*(i%nx) + jitter*(2.0*rand()/RAND_MAX - 1);
+		y[i] = 50 + pitch*(i/nx) + jitter*(2.0*rand()/RAND_MAX - 1);
+	}
+
+	// the triangles against the hull
+	vector<int> t;
+	double start = now();
+	triangulate(&x[0], &y[0], n, 0, t);
+	double triangulation = now()-start;
+	double covered = 0;
+	for (size_t e=0; e+2<t.size(); e+=3) covered += 0.5*((x[t[e+1]]-x[t[e]])*(y[t[e+2]]-y[t[e]]) - (x[t[e+2]]-x[t[e]])*(y[t[e+1]]-y[t[e]]));
+	double hull = hullArea(x, y);
+
+	StrainField SF;
+	int err = SF.setReference(&x[0], &y[0], n);
+
+	// frame f stretches by 0.1% per frame along x and shrinks half as much along y
+	vector<double> positions((size_t)2*n*nbFrames);
+	for (int f=0; f<nbFrames; f++)
+	{
+		double sx = 1 + 0.001*f, sy = 1 - 0.0005*f;
+		for (int i=0; i<n; i++)
+		{
+			positions[(size_t)2*n*f+i] = x[i]*sx;
+			positions[(size_t)2*n*f+n+i] = y[i]*sy;
+		}
+	}
+	int nbElements = SF.nbElements();
+	vector<float> strain((size_t)3*nbElements*nbFrames);
+	start = now();
+	if (!err) err = SF.compute(&positions[0], &positions[n], 2*n, nbFrames, &strain[0], nbThreads);
+	double compute = now()-start;
+
+	double strainError = 0;
+	for (int f=0; f<nbFrames; f++)
+	{
+		double sx = 1 + 0.001*f, sy = 1 - 0.0005*f;
+		double exx = 0.5*(sx*sx-1), eyy = 0.5*(sy*sy-1);
+		const float* s = &strain[(size_t)3*nbElements*f];
+		for (int e=0; e<nbElements; e++)
+		{
+			strainError = max(strainError, fabs(s[3*e]-exx));
+			strainError = max(strainError, fabs(s[3*e+1]-eyy));
+			strainError = max(strainError, fabs((double)s[3*e+2]));
+		}
+	}
+
+	bool ok = !err && fabs(covered-hull) <= 1e-9*hull && strainError <= 1e-5;
+	printf("{\"benchmark\": \"strain\", \"markers\": \"%dx%d\", \"jitter\": %g, \"elements\": %d, \"hull_area\": %.6f, \"triangle_area\": %.6f, \"max_strain_error\": %.3g, \"triangulate_ms\": %.3f, \"us_per_frame\": %.3f, \"ok\": %s}\n",
+		nx, ny, jitter, nbElements, hull, covered, strainError, 1e3*triangulation, 1e6*compute/nbFrames, ok ? "true" : "false");
+	fflush(stdout);
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	int nbThreads = 0;
+	vector<pair<int,int> > sizes;
+	for (int i=1; i<argc; i++)
+	{
+		int nx, ny;
+		if (!strcmp(argv[i], "-threads") && i+1 < argc) nbThreads = atoi(argv[++i]);
+		else if (sscanf(argv[i], "%dx%d", &nx, &ny) == 2 && nx > 1 && ny > 1) sizes.push_back(make_pair(nx,ny));
+	}
+	if (sizes.empty())
+	{
+		// a strip of markers along the gauge length, the usual grid and a dense one
+		sizes.push_back(make_pair(12,2));
+		sizes.push_back(make_pair(12,9));
+		sizes.push_back(make_pair(40,30));
+	}
+	double jitters[] = {0, 0.1, 2};
+
+	bool ok = true;
+	for (size_t s=0; s<sizes.size(); s++)
+	{
+		for (int j=0; j<3; j++) ok = run(sizes[s].first, sizes[s].second, jitters[j], nbThreads) && ok;
+	}
+	return ok ? 0 : 2;
+}
@@ -0,0 +1,331 @@
+/***************************************************
+End-to-end benchmark of the native tracking pipeline,
+checked against a vidExt_*.txt written by videoTracker
+(data/output/M-35Zr39Ti25Nb_Glb_11 has the reference runs
+of the bundled specimen at 1 s and 0.1 s intervals).
+
+The frames are listed as videoTracker lists them (every
+interval seconds from the first frame, up to exclude
+seconds before the end), decoded with FFGrabber and tracked
+as they are decoded: the blob tracker, the marker matcher
+(the identity of the blobs) and measureMarkers with the
+blobs forced on a horizontal line, which give the columns
+of the data file.  The wall time of every stage (open,
+decode, track, measure, compare) and the frames per second
+are printed as one JSON object, with the largest difference
+to the reference of each column.  The run fails (exit code
+2) when a difference is above the tolerance or when the
+frames or times do not match the reference.
+
+The ROI and the calibration are those selected in
+videoTracker, they are not saved with the results.  With a
+calibration of 0 it is fitted to the blob distances of the
+first row of the reference (the value is reported), which
+leaves the displacements to be checked.  The interval is
+the time step of the reference when it is not given (or 0).
+
+usage: benchTracking [-tolerance mm] [-threads n] [-output file] reference video xmin ymin width height calibration [interval [exclude [threshold [blobs [blobArea]]]]]
+
+build: g++ -O2 benchTracking.cpp ../trackerAPI/BlobTracker.cpp ../trackerAPI/Threshold.cpp ../trackerAPI/BinaryImage.cpp ../trackerAPI/Labelling.cpp ../trackerAPI/Prediction.cpp ../trackerAPI/WorkerPool.cpp ../trackerAPI/Markers.cpp ../dataAPI/Numbers.cpp ../dataAPI/MappedFile.cpp -lavbin -pthread -o benchTracking
+**************************************************/
+
+#include "../frameGrabAPI/FFGrab.cpp"
+#include "../trackerAPI/BlobTracker.h"
+#include "../trackerAPI/Markers.h"
+#include "../dataAPI/Numbers.h"
+
+#include <math.h>
+#include <chrono>
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// the header and the rows of a tab separated data file
+static int readReference(const char* path, vector<string> &header, vector<vector<double> > &rows)
+{
+	FILE* f = fopen(path, "rb");
+	if (!f) return -3;
+	string text;
+	char buffer[65536];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) text.append(buffer, n);
+	fclose(f);
+
+	size_t lineEnd = text.find('\n');
+	if (lineEnd == string::npos) return -4;
+	string first = text.substr(0, lineEnd);
+	for (size_t start=0; start<=first.size(); )
+	{
+		size_t tab = first.find('\t', start);
+		if (tab == string::npos) tab = first.size();
+		string name = first.substr(start, tab-start);
+		if (!name.empty() && name[name.size()-1] == '\r') name.erase(name.size()-1);
+		if (!name.empty()) header.push_back(name);
+		start = tab+1;
+	}
+
+	const char* p = text.c_str()+lineEnd+1;
+	const char* end = text.c_str()+text.size();
+	while (p < end)
+	{
+		const char* eol = (const char*)memchr(p, '\n', end-p);
+		if (!eol) eol = end;
+		vector<double> row;
+		double value;
+		for (const char* q = p; q < eol; )
+		{
+			const char* tab = (const char*)memchr(q, '\t', eol-q);
+			if (parseDouble(q, tab ? tab : eol, value)) row.push_back(value);
+			q = tab ? tab+1 : eol;
+		}
+		if (!row.empty())
+		{
+			if (row.size() != header.size()) return -4;
+			rows.push_back(row);
+		}
+		p = eol+1;
+	}
+	return rows.empty() ? -4 : 0;
+}
+
+struct Pipeline
+{
+	BlobTracker BT;
+	MarkerMatcher MM;
+	int nbBlobs;
+	double matchDistance;
+	// 0 until the first frame when it is fitted to the reference
+	double calibration;
+	const vector<double>* referenceDistances;
+
+	vector<Blob> blobs;
+	vector<double> detX, detY, refX, refY, y;
+	vector<int> assignment;
+
+	// one row of the data file per frame, as videoTracker writes it
+	vector<vector<double> > rows;
+	double trackSeconds, measureSeconds;
+	int error;
+};
+
+static void processFrame(void* user, const uint8_t* data, unsigned int /*nrBytes*/, int width, int height, double time, unsigned int /*frameNr*/)
+{
+	Pipeline* P = (Pipeline*)user;
+	if (P->error) return;
+
+	double start = now();
+	double level;
+	if (P->BT.track(interleavedView(data, width, height), P->blobs, &level))
+	{
+		P->error = -4;
+		return;
+	}
+	double tracked = now();
+	P->trackSeconds += tracked-start;
+
+	int n = P->nbBlobs;
+	P->detX.resize(P->blobs.size());
+	P->detY.resize(P->blobs.size());
+	for (size_t i=0; i<P->blobs.size(); i++)
+	{
+		P->detX[i] = P->blobs[i].centroidX;
+		P->detY[i] = P->blobs[i].centroidY;
+	}
+	if (P->rows.empty())
+	{
+		if ((int)P->blobs.size() != n)
+		{
+			FFprintf("%d blobs in the first frame instead of %d\n",(int)P->blobs.size(),n);
+			P->error = -4;
+			return;
+		}
+		P->MM.reset(&P->detX[0], &P->detY[0], n);
+	} else {
+		P->MM.match(P->detX.empty() ? NULL : &P->detX[0], P->detY.empty() ? NULL : &P->detY[0], (int)P->detX.size(), P->matchDistance, P->assignment);
+	}
+
+	// the blobs on a horizontal line, the offset of the ROI cancels out
+	int nbPairs = n*(n-1)/2;
+	if (P->rows.empty())
+	{
+		P->refX = P->MM.x;
+		P->refY.assign(n, 0);
+		P->y.assign(n, 0);
+		if (P->calibration <= 0)
+		{
+			vector<double> pixels(nbPairs);
+			measureMarkers(&P->refX[0], &P->refY[0], &P->refX[0], &P->refY[0], n, 1, NULL, &pixels[0], NULL);
+			double sum = 0;
+			int used = 0;
+			for (int k=0; k<nbPairs; k++)
+			{
+				if (pixels[k] > 0)
+				{
+					sum += (*P->referenceDistances)[k]/pixels[k];
+					used++;
+				}
+			}
+			P->calibration = used ? sum/used : 1;
+		}
+	}
+
+	// time, displacements and their mean, distances, distance changes and their mean
+	vector<double> row(1 + (n+1) + nbPairs + (nbPairs+1), 0);
+	row[0] = time;
+	double* displacement = &row[1];
+	double* distance = &row[n+2];
+	double* distanceChange = &row[n+2+nbPairs];
+	measureMarkers(&P->MM.x[0], &P->y[0], &P->refX[0], &P->refY[0], n, P->calibration, displacement, distance, distanceChange);
+	double sum = 0;
+	for (int i=0; i<n; i++) sum += displacement[i];
+	row[n+1] = sum/n;
+	sum = 0;
+	for (int k=0; k<nbPairs; k++) sum += distanceChange[k];
+	row.back() = nbPairs ? sum/nbPairs : 0;
+	P->rows.push_back(row);
+
+	P->measureSeconds += now()-tracked;
+}
+
+static void writeData(const char* path, const vector<string> &header, const vector<vector<double> > &rows)
+{
+	FILE* f = fopen(path, "w");
+	if (!f) return;
+	for (size_t c=0; c<header.size(); c++) fprintf(f, c+1<header.size() ? "%s\t" : "%s\n", header[c].c_str());
+	for (size_t r=0; r<rows.size(); r++)
+	{
+		for (size_t c=0; c<rows[r].size(); c++) fprintf(f, "%.8f\t", rows[r][c]);
+		fprintf(f, "\n");
+	}
+	fclose(f);
+}
+
+int main(int argc, char** argv)
+{
+	double tolerance = 1e-3;
+	int nbThreads = 0;
+	const char* output = NULL;
+	while (argc > 2 && argv[1][0] == '-')
+	{
+		if (!strcmp(argv[1],"-tolerance")) tolerance = atof(argv[2]);
+		else if (!strcmp(argv[1],"-threads")) nbThreads = atoi(argv[2]);
+		else if (!strcmp(argv[1],"-output")) output = argv[2];
+		else break;
+		argv[2] = argv[0];
+		argv += 2;
+		argc -= 2;
+	}
+
+	if (argc < 8)
+	{
+		FFprintf("usage: %s [-tolerance mm] [-threads n] [-output file] reference video xmin ymin width height calibration [interval [exclude [threshold [blobs [blobArea]]]]]\n",argv[0]);
+		return 1;
+	}
+	const char* reference = argv[1];
+	char* video = argv[2];
+	double roi[4] = {atof(argv[3]), atof(argv[4]), atof(argv[5]), atof(argv[6])};
+	double calibration = atof(argv[7]);
+	double exclude = argc > 9 ? atof(argv[9]) : 8;
+	double threshold = argc > 10 ? atof(argv[10]) : -1;
+	int nbBlobs = argc > 11 ? atoi(argv[11]) : 3;
+	int blobArea = argc > 12 ? atoi(argv[12]) : 200;
+
+	vector<string> header;
+	vector<vector<double> > expected;
+	if (readReference(reference, header, expected))
+	{
+		FFprintf("could not read %s\n",reference);
+		return 1;
+	}
+	int nbPairs = nbBlobs*(nbBlobs-1)/2;
+	if (nbBlobs < 1 || (int)header.size() != 1 + (nbBlobs+1) + nbPairs + (nbPairs+1))
+	{
+		FFprintf("%s does not have the columns of %d blobs\n",reference,nbBlobs);
+		return 1;
+	}
+	double interval = argc > 8 ? atof(argv[8]) : 0;
+	if (interval <= 0) interval = expected.size() > 1 ? expected[1][0]-expected[0][0] : 1;
+	if (interval <= 0)
+	{
+		FFprintf("invalid interval\n");
+		return 1;
+	}
+
+	Pipeline P;
+	P.nbBlobs = nbBlobs;
+	P.matchDistance = 20;
+	P.calibration = calibration;
+	vector<double> referenceDistances(expected[0].begin()+nbBlobs+2, expected[0].begin()+nbBlobs+2+nbPairs);
+	P.referenceDistances = &referenceDistances;
+	P.trackSeconds = P.measureSeconds = 0;
+	P.error = 0;
+	if (P.BT.setOptions(threshold, 3, 3, blobArea, nbBlobs) || P.BT.setThreads(nbThreads) || P.BT.setROI(roi[0], roi[1], roi[2], roi[3]))
+	{
+		FFprintf("invalid tracking options\n");
+		return 1;
+	}
+
+	// open: the frames to analyse, as videoTracker lists them
+	double start = now();
+	FFGrabber FFG;
+	int width, height, nrFramesCaptured, nrFramesTotal;
+	double rate, duration;
+	if (FFG.build(video,false,true,true) || FFG.getVideoInfo(0, &width, &height, &rate, &nrFramesCaptured, &nrFramesTotal, &duration) || rate <= 0)
+	{
+		FFprintf("could not open %s\n",video);
+		return 1;
+	}
+	double endFrame = duration*rate - exclude*rate;
+	vector<unsigned int> frames;
+	for (double f=1; f<=endFrame+1e-9; f+=interval*rate) frames.push_back((unsigned int)floor(f+0.5));
+	if (frames.empty())
+	{
+		FFprintf("no frames to analyse in %s\n",video);
+		return 1;
+	}
+	double openSeconds = now()-start;
+
+	// decode and track, every frame as it is decoded
+	start = now();
+	FFG.setFrames(&frames[0], frames.size());
+	FFG.setFrameCallback(processFrame, &P);
+	FFG.doCapture();
+	FFG.cleanUp();
+	double captureSeconds = now()-start;
+	double decodeSeconds = captureSeconds-P.trackSeconds-P.measureSeconds;
+
+	// compare with the reference, column by column; the times are those of the frame list
+	start = now();
+	vector<double> maxError(header.size(), 0);
+	bool timesMatch = true;
+	for (size_t r=0; r<P.rows.size(); r++) P.rows[r][0] = (frames[r]-1)/rate;
+	size_t nbRows = min(P.rows.size(), expected.size());
+	for (size_t r=0; r<nbRows; r++)
+	{
+		for (size_t c=0; c<header.size(); c++)
+		{
+			double e = fabs(P.rows[r][c]-expected[r][c]);
+			if (e > maxError[c]) maxError[c] = e;
+		}
+	}
+	if (maxError[0] > 0.5/rate) timesMatch = false;
+	double worst = 0;
+	for (size_t c=1; c<header.size(); c++) worst = max(worst, maxError[c]);
+	bool pass = !P.error && P.rows.size() == expected.size() && timesMatch && worst <= tolerance;
+	double compareSeconds = now()-start;
+
+	if (output) writeData(output, header, P.rows);
+
+	double pipelineSeconds = captureSeconds;
+	printf("{\"benchmark\": \"tracking\", \"video\": \"%s\", \"reference\": \"%s\", \"frames\": %d, \"expected_frames\": %d, \"calibration\": %.10g",
+		video, reference, (int)P.rows.size(), (int)expected.size(), P.calibration);
+	printf(", \"open_s\": %.6f, \"decode_s\": %.6f, \"track_s\": %.6f, \"measure_s\": %.6f, \"compare_s\": %.6f, \"fps\": %.3f",
+		openSeconds, decodeSeconds, P.trackSeconds, P.measureSeconds, compareSeconds, pipelineSeconds > 0 ? P.rows.size()/pipelineSeconds : 0.0);
+	printf(", \"max_error\": {");
+	for (size_t c=0; c<header.size(); c++) printf("%s\"%s\": %.8f", c ? ", " : "", header[c].c_str(), maxError[c]);
+	printf("}, \"tolerance_mm\": %g, \"pass\": %s}\n", tolerance, pass ? "true" : "false");
+
+	return pass ? 0 : 2;
+}
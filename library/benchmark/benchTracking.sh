@@ -0,0 +1,32 @@
+#!/bin/sh
+# Runs benchTracking on the bundled specimen against both reference runs (1 s and 0.1 s
+# intervals, the demo_videoTracker settings); the JSON results go to results.jsonl.
+# The video is not bundled, and the ROI and calibration are those selected in videoTracker
+# (a calibration of 0 fits it to the reference).
+#
+# usage: ./benchTracking.sh video xmin ymin width height [calibration [results]]
+# TOLERANCE (mm), THREADS, EXCLUDE, THRESHOLD and BLOBAREA override the settings.
+
+set -e
+cd "$(dirname "$0")"
+
+if [ $# -lt 5 ]; then
+	echo "usage: $0 video xmin ymin width height [calibration [results]]"
+	exit 1
+fi
+
+REFERENCES=../../data/output/M-35Zr39Ti25Nb_Glb_11
+RESULTS=${7:-results.jsonl}
+CALIBRATION=${6:-0}
+TOLERANCE=${TOLERANCE:-0.001}
+THREADS=${THREADS:-0}
+EXCLUDE=${EXCLUDE:-8}
+THRESHOLD=${THRESHOLD:--1}
+BLOBAREA=${BLOBAREA:-200}
+
+status=0
+for reference in "$REFERENCES/vidExt_M-35Zr39Ti25Nb_Glb_11.txt" "$REFERENCES/vidExt_M-35Zr39Ti25Nb_Glb_11_0pt1.txt"; do
+	# the interval is taken from the reference
+	./benchTracking -tolerance "$TOLERANCE" -threads "$THREADS" "$reference" "$1" "$2" "$3" "$4" "$5" "$CALIBRATION" 0 "$EXCLUDE" "$THRESHOLD" 3 "$BLOBAREA" >> "$RESULTS" || status=$?
+done
+exit $status
@@ -0,0 +1,145 @@
+/***************************************************
+Synthetic tensile test videos for the benchmarks.
+
+A grey specimen across the middle of the frame carries a
+row of bright round markers along the gauge length.  The
+specimen is pulled at a constant rate: every marker moves
+away from the centre in proportion to its distance to it,
+up to the final strain, while the whole specimen drifts by
+a few pixels.  The background and the specimen have a
+fixed texture and every frame gets a little sensor noise,
+so the encoders have something realistic to compress and
+the threshold has something to reject.  The frames are
+encoded with VideoRecorderMPG (FFGrab.h) at 25 frames per
+second.
+
+The true centroid of every marker (1-based, as the blob
+tracker reports them) is written next to the video, in
+output.txt: one line per frame with the time and the x y of
+each marker.
+
+usage: makeTestVideo output width height nbFrames [codec [gop [markers [strain]]]]
+codec is the name of an ffmpeg encoder (mpeg1video, mpeg2video, mpeg4, libx264...),
+mpeg2video by default; gop is the distance between keyframes, 12 by default.
+
+build: g++ -O2 makeTestVideo.cpp -I<CImg> -lavformat -lavcodec -lswscale -lavutil -pthread -o makeTestVideo
+**************************************************/
+
+#include "../frameGrabAPI/FFGrab.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// only declared by FFGrab.h
+void display_format(AVPixelFormat p)
+{
+}
+
+// fixed texture, the same in every frame
+static float texture(int x, int y)
+{
+	uint32_t h = (uint32_t)x*374761393u + (uint32_t)y*668265263u;
+	h = (h ^ (h >> 13))*1274126177u;
+	return ((h ^ (h >> 16)) & 0xFFFF)/65535.0f - 0.5f;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 5)
+	{
+		printf("usage: %s output width height nbFrames [codec [gop [markers [strain]]]]\n",argv[0]);
+		return 1;
+	}
+
+	const char* output = argv[1];
+	int W = atoi(argv[2]), H = atoi(argv[3]), nbFrames = atoi(argv[4]);
+	const char* codecName = argc > 5 ? argv[5] : "mpeg2video";
+	int gop = argc > 6 ? atoi(argv[6]) : 12;
+	int nbMarkers = argc > 7 ? atoi(argv[7]) : 3;
+	double finalStrain = argc > 8 ? atof(argv[8]) : 0.2;
+	if (W < 16 || H < 16 || nbFrames < 1 || gop < 1 || nbMarkers < 1)
+	{
+		printf("invalid size, number of frames, gop or markers\n");
+		return 1;
+	}
+
+	avcodec_register_all();
+	AVCodec* codec = avcodec_find_encoder_by_name(codecName);
+	if (!codec)
+	{
+		printf("no %s encoder\n",codecName);
+		return 1;
+	}
+
+	string truthPath = string(output) + ".txt";
+	FILE* truth = fopen(truthPath.c_str(), "w");
+	if (!truth)
+	{
+		printf("could not write %s\n",truthPath.c_str());
+		return 1;
+	}
+
+	VideoRecorderMPG<float> recorder(output, W, H, codec->id, gop);
+
+	// the markers are spread over the middle 60% of the width, the specimen is a third of the height
+	double radius = max(H/40.0, 3.0);
+	double centre = (W-1)/2.0;
+	int top = H/3, bottom = 2*H/3;
+	vector<double> x0(nbMarkers), y0(nbMarkers);
+	for (int m=0; m<nbMarkers; m++)
+	{
+		x0[m] = nbMarkers > 1 ? 0.2*W + 0.6*W*m/(nbMarkers-1) : centre;
+		y0[m] = (H-1)/2.0 + ((m%2) ? 0.25 : -0.25)*radius;
+	}
+
+	vector<float> frame((size_t)W*H*3);
+	vector<double> x(nbMarkers), y(nbMarkers);
+	uint32_t noise = 12345;
+	for (int f=0; f<nbFrames; f++)
+	{
+		double t = f/25.0;
+		double strain = finalStrain*f/max(nbFrames-1,1);
+		double drift = 2.0*sin(2*M_PI*f/max(nbFrames,2));
+		for (int m=0; m<nbMarkers; m++)
+		{
+			x[m] = centre + (x0[m]-centre)*(1+strain) + drift;
+			y[m] = y0[m];
+		}
+
+		for (int py=0; py<H; py++)
+		{
+			bool specimen = py >= top && py < bottom;
+			for (int px=0; px<W; px++)
+			{
+				float v = specimen ? 0.40f + 0.06f*texture(px-(int)floor(drift),py) : 0.15f + 0.04f*texture(px,py);
+				// coverage of the nearest marker, anti-aliased over one pixel
+				for (int m=0; m<nbMarkers; m++)
+				{
+					double d = hypot(px-x[m], py-y[m]);
+					if (d < radius+0.5)
+					{
+						float c = (float)min(radius+0.5-d, 1.0);
+						v = v*(1-c) + 0.85f*c;
+						break;
+					}
+				}
+				noise = noise*1664525u + 1013904223u;
+				v += ((noise >> 24)/255.0f - 0.5f)*0.02f;
+
+				float* p = &frame[((size_t)py*W + px)*3];
+				p[0] = p[1] = p[2] = v;
+			}
+		}
+		recorder.addFrame(&frame[0]);
+
+		fprintf(truth, "%.8f", t);
+		for (int m=0; m<nbMarkers; m++) fprintf(truth, "\t%.8f\t%.8f", x[m]+1, y[m]+1);
+		fprintf(truth, "\n");
+	}
+	recorder.finalize_video();
+	fclose(truth);
+
+	printf("%s: %dx%d, %d frames, %s, gop %d\n",output,W,H,recorder.nb_recorded_frames,codecName,gop);
+	return 0;
+}
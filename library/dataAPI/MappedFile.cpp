@@ -0,0 +1,95 @@
+/***************************************************
+Read-only memory-mapped files, see MappedFile.h.
+**************************************************/
+
+#include "MappedFile.h"
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	data = NULL;
+	length = 0;
+	mtime = 0;
+	opened = false;
+#ifdef _WIN32
+	file = mapping = NULL;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+int MappedFile::open(const char* path)
+{
+	close();
+	if (!path) return -1;
+
+	struct stat st;
+	if (stat(path, &st) != 0) return -3;
+	length = st.st_size;
+	mtime = st.st_mtime;
+
+	// an empty file cannot be mapped but is still a file
+	if (length == 0)
+	{
+		opened = true;
+		return 0;
+	}
+
+#ifdef _WIN32
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = NULL;
+		return -3;
+	}
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping) data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, length);
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return -3;
+	void* p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (p != MAP_FAILED)
+	{
+		data = (const char*)p;
+		// the file is parsed front to back
+		madvise(p, length, MADV_SEQUENTIAL);
+	}
+#endif
+	if (!data)
+	{
+		close();
+		return -3;
+	}
+	opened = true;
+
+	return 0;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	file = mapping = NULL;
+#else
+	if (data) munmap((void*)data, length);
+#endif
+	data = NULL;
+	length = 0;
+	mtime = 0;
+	opened = false;
+}
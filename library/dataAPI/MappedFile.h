@@ -0,0 +1,45 @@
+/***************************************************
+This is the header file for read-only memory-mapped
+files.
+
+The whole file is mapped at once and the pages are only
+read when they are touched, so opening a log of millions of
+rows costs nothing until it is parsed, and the parse never
+copies the file into a buffer.
+**************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// -3 when the file cannot be opened or mapped
+	int open(const char* path);
+	void close();
+
+	bool isOpen() const { return data != NULL || (opened && length == 0); }
+	const char* begin() const { return data; }
+	const char* end() const { return data+length; }
+	size_t size() const { return length; }
+	// seconds since 1970 of the last modification when the file was opened
+	int64_t modified() const { return mtime; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const char* data;
+	size_t length;
+	int64_t mtime;
+	bool opened;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#endif
+};
@@ -0,0 +1,190 @@
+/***************************************************
+Number parsing, see Numbers.h.
+**************************************************/
+
+#include "Numbers.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static bool slowParse(const char* &p, const char* end, double &value)
+{
+	// strtod would skip a tab or a line end and read the next field
+	if (p < end && isspace((unsigned char)*p)) return false;
+
+	char buffer[128];
+	size_t n = end-p < 127 ? end-p : 127;
+	memcpy(buffer, p, n);
+	buffer[n] = 0;
+
+	char* stop;
+	value = strtod(buffer, &stop);
+	if (stop == buffer) return false;
+	p += stop-buffer;
+	return true;
+}
+
+bool parseDouble(const char* &p, const char* end, double &value)
+{
+	while (p < end && *p == ' ') p++;
+	const char* s = p;
+	if (s == end) return false;
+
+	bool negative = *s == '-';
+	if (*s == '-' || *s == '+') s++;
+
+	uint64_t mantissa = 0;
+	int digits = 0, exponent = 0;
+	bool any = false;
+	for (; s < end && isDigit(*s); s++)
+	{
+		any = true;
+		// leading zeros are not significant
+		if (mantissa == 0 && *s == '0') continue;
+		if (digits < 19) {mantissa = 10*mantissa + (*s-'0'); digits++;}
+		else exponent++;
+	}
+	if (s < end && *s == '.')
+	{
+		for (s++; s < end && isDigit(*s); s++)
+		{
+			any = true;
+			if (mantissa == 0 && *s == '0') {exponent--; continue;}
+			if (digits < 19) {mantissa = 10*mantissa + (*s-'0'); digits++; exponent--;}
+		}
+	}
+	// nan, inf, hexadecimal and the like
+	if (!any) return slowParse(p, end, value);
+
+	if (s < end && (*s == 'e' || *s == 'E'))
+	{
+		const char* e = s+1;
+		bool negativeExponent = e < end && *e == '-';
+		if (e < end && (*e == '-' || *e == '+')) e++;
+		if (e < end && isDigit(*e))
+		{
+			int x = 0;
+			for (; e < end && isDigit(*e); e++) if (x < 100000) x = 10*x + (*e-'0');
+			exponent += negativeExponent ? -x : x;
+			s = e;
+		}
+	}
+
+	if (mantissa > ((uint64_t)1 << 53) || exponent < -22 || exponent > 22 || digits >= 19) return slowParse(p, end, value);
+
+	double v = (double)mantissa;
+	v = exponent < 0 ? v/powersOfTen[-exponent] : v*powersOfTen[exponent];
+	value = negative ? -v : v;
+	p = s;
+	return true;
+}
+
+// the digits of m with a decimal point before the last decimals of them
+static int writeFixed(long long m, int decimals, char* out)
+{
+	char digits[24];
+	int n = 0;
+	bool negative = m < 0;
+	unsigned long long u = negative ? 0-(unsigned long long)m : (unsigned long long)m;
+	do
+	{
+		digits[n++] = (char)('0' + u%10);
+		u /= 10;
+	} while (u);
+	while (n <= decimals) digits[n++] = '0';
+
+	int length = 0;
+	if (negative) out[length++] = '-';
+	for (int i=n-1; i>=0; i--)
+	{
+		out[length++] = digits[i];
+		if (i == decimals && i > 0) out[length++] = '.';
+	}
+	out[length] = 0;
+	return length;
+}
+
+// the integer m with m/10^d == value, if there is one
+static bool fixedDecimals(double value, int d, long long &m)
+{
+	long long nearest = (long long)floor(value*powersOfTen[d]+0.5);
+	for (long long k=nearest-1; k<=nearest+1; k++)
+	{
+		if ((double)k/powersOfTen[d] == value)
+		{
+			m = k;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool roundTrips(double value, int digits, char* out)
+{
+	int n = sprintf(out, "%.*g", digits, value);
+	const char* p = out;
+	double back;
+	return parseDouble(p, out+n, back) && back == value;
+}
+
+int formatShortest(double value, char* out)
+{
+	if (!(value == value) || value-value != 0) return sprintf(out, "%g", value);
+	if (value == 0) return sprintf(out, signbit(value) ? "-0" : "0");
+
+	// fewest decimals d such that m/10^d is value: with m <= 2^53 and d <= 22 this is
+	// one correctly rounded division, which is what reading the digits back gives.
+	// If d decimals work so do d+1 (10m), so the smallest d is found by bisection.
+	int dMax = -1;
+	while (dMax < 22 && fabs(value)*powersOfTen[dMax+1] < 9007199254740992.0) dMax++;
+	long long m;
+	if (dMax >= 0 && fixedDecimals(value, dMax, m))
+	{
+		int lo = 0, hi = dMax;
+		while (lo < hi)
+		{
+			int d = (lo+hi)/2;
+			long long k;
+			if (fixedDecimals(value, d, k))
+			{
+				hi = d;
+				m = k;
+			} else {
+				lo = d+1;
+			}
+		}
+		return writeFixed(m, hi, out);
+	}
+
+	// computed values mostly need 16 or 17 digits, try those first
+	if (!roundTrips(value, 16, out)) return sprintf(out, "%.17g", value);
+	char buffer[32];
+	if (!roundTrips(value, 15, buffer)) return (int)strlen(out);
+
+	int lo = 1, hi = 15;
+	strcpy(out, buffer);
+	while (lo < hi)
+	{
+		int digits = (lo+hi)/2;
+		if (roundTrips(value, digits, buffer))
+		{
+			hi = digits;
+			strcpy(out, buffer);
+		} else {
+			lo = digits+1;
+		}
+	}
+	return (int)strlen(out);
+}
@@ -0,0 +1,31 @@
+/***************************************************
+This is the header file for the number parsing of the
+data files.
+
+parseDouble reads a decimal number without going through
+strtod for the usual case: the digits are accumulated in a
+64 bit integer and, when it holds at most 2^53 and the
+decimal exponent is within +-22, the result is the single
+correctly rounded product (or quotient) of two exact
+doubles.  Anything else (more digits, large exponents,
+nan, inf) falls back to strtod, so the result is always
+the one strtod would give.
+
+formatShortest writes the fewest digits that read back as
+the same double.  Numbers below 2^53 are written in fixed
+point with the fewest decimals d for which an integer m
+gives m/10^d == value exactly (the same fast path as the
+parser, so no printf is involved); the others with the
+fewest significant digits of %g that round trip, found by
+a binary search.
+**************************************************/
+
+#pragma once
+
+// parses the number at p, after any spaces (but no other white space,
+// so an empty field is not a number), and moves p past it;
+// false (p unchanged) when there is no number before end
+bool parseDouble(const char* &p, const char* end, double &value);
+
+// writes value at out (32 bytes are enough), returns the number of characters
+int formatShortest(double value, char* out);
@@ -0,0 +1,417 @@
+/***************************************************
+Binary result store, see ResultStore.h.
+
+  file header  "VTRESULT", uint32 version, uint32 0
+  chunk        "CHNK", uint32 columns, uint64 rows, uint64 chunk size
+               per column: uint8 type, uint8 encoding,
+                           uint16 name length, uint32 0, uint64 data size
+               the names, padded to 8 bytes
+               the data of each column, padded to 8 bytes
+**************************************************/
+
+#include "ResultStore.h"
+#include "Numbers.h"
+
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+using namespace std;
+
+static const char fileMagic[8] = {'V','T','R','E','S','U','L','T'};
+static const char chunkMagic[4] = {'C','H','N','K'};
+static const uint32_t version = 1;
+static const size_t fileHeaderSize = 16, chunkHeaderSize = 24, columnHeaderSize = 16;
+
+static size_t padded(size_t n)
+{
+	return (n+7) & ~(size_t)7;
+}
+
+template <class T> static void put(vector<uint8_t> &buffer, T value)
+{
+	size_t at = buffer.size();
+	buffer.resize(at+sizeof(T));
+	memcpy(&buffer[at], &value, sizeof(T));
+}
+
+template <class T> static T get(const uint8_t* p)
+{
+	T value;
+	memcpy(&value, p, sizeof(T));
+	return value;
+}
+
+static void putVarint(vector<uint8_t> &buffer, uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		buffer.push_back((uint8_t)(v | 0x80));
+		v >>= 7;
+	}
+	buffer.push_back((uint8_t)v);
+}
+
+// zigzag varints of the differences of the bit patterns
+static void encodeDelta(vector<uint8_t> &buffer, const double* values, size_t rows, ColumnType type)
+{
+	if (type == COLUMN_FLOAT64)
+	{
+		uint64_t last = 0;
+		for (size_t i=0; i<rows; i++)
+		{
+			uint64_t bits;
+			memcpy(&bits, &values[i], 8);
+			int64_t d = (int64_t)(bits-last);
+			putVarint(buffer, ((uint64_t)d << 1) ^ (uint64_t)(d >> 63));
+			last = bits;
+		}
+	} else {
+		uint32_t last = 0;
+		for (size_t i=0; i<rows; i++)
+		{
+			float f = (float)values[i];
+			uint32_t bits;
+			memcpy(&bits, &f, 4);
+			int32_t d = (int32_t)(bits-last);
+			putVarint(buffer, ((uint32_t)d << 1) ^ (uint32_t)(d >> 31));
+			last = bits;
+		}
+	}
+}
+
+static bool decodeDelta(const uint8_t* p, size_t size, size_t rows, ColumnType type, double* values)
+{
+	const uint8_t* end = p+size;
+	uint64_t last = 0;
+	for (size_t i=0; i<rows; i++)
+	{
+		uint64_t v = 0;
+		int shift = 0;
+		for (;;)
+		{
+			if (p >= end || shift > 63) return false;
+			uint8_t byte = *p++;
+			v |= (uint64_t)(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) break;
+			shift += 7;
+		}
+		uint64_t d = (v >> 1) ^ (0-(v & 1));
+		if (type == COLUMN_FLOAT64)
+		{
+			last += d;
+			memcpy(&values[i], &last, 8);
+		} else {
+			uint32_t bits = (uint32_t)last + (uint32_t)d;
+			float f;
+			memcpy(&f, &bits, 4);
+			values[i] = f;
+			last = bits;
+		}
+	}
+	return true;
+}
+
+static bool sameColumns(const vector<ColumnInfo> &a, const vector<ColumnInfo> &b)
+{
+	if (a.size() != b.size()) return false;
+	for (size_t i=0; i<a.size(); i++)
+	{
+		if (a[i].name != b[i].name || a[i].type != b[i].type || a[i].encoding != b[i].encoding) return false;
+	}
+	return true;
+}
+
+ResultWriter::ResultWriter()
+{
+	file = NULL;
+}
+
+ResultWriter::~ResultWriter()
+{
+	close();
+}
+
+int ResultWriter::open(const char* path, const vector<ColumnInfo> &columns)
+{
+	close();
+	if (!path || columns.empty()) return -1;
+	for (size_t i=0; i<columns.size(); i++)
+	{
+		if (columns[i].name.size() > 0xffff || (unsigned)columns[i].type > COLUMN_FLOAT32 || (unsigned)columns[i].encoding > ENCODING_DELTA) return -1;
+	}
+
+	struct stat st;
+	if (stat(path, &st) == 0 && st.st_size > 0)
+	{
+		ResultReader reader;
+		int err = reader.open(path);
+		if (err) return err;
+		if (reader.nbRows() > 0 && !sameColumns(reader.getColumns(), columns)) return -7;
+		size_t valid = reader.validSize();
+		reader.close();
+
+		// drop a chunk cut short, if any, and append after the last complete one
+		file = fopen(path, "r+b");
+		if (!file) return -3;
+#ifdef _WIN32
+		bool truncated = _chsize_s(_fileno(file), valid) == 0;
+#else
+		bool truncated = ftruncate(fileno(file), valid) == 0;
+#endif
+		if (!truncated || fseek(file, 0, SEEK_END) != 0)
+		{
+			close();
+			return -3;
+		}
+	} else {
+		file = fopen(path, "wb");
+		if (!file) return -3;
+
+		buffer.clear();
+		buffer.insert(buffer.end(), fileMagic, fileMagic+8);
+		put<uint32_t>(buffer, version);
+		put<uint32_t>(buffer, 0);
+		if (fwrite(&buffer[0], 1, buffer.size(), file) != buffer.size())
+		{
+			close();
+			return -3;
+		}
+	}
+	this->columns = columns;
+
+	return 0;
+}
+
+int ResultWriter::append(const double* values, size_t rows)
+{
+	if (!file) return -2;
+	if (!values && rows > 0) return -1;
+	if (rows == 0) return 0;
+
+	size_t nbColumns = columns.size();
+	size_t namesSize = 0;
+	for (size_t c=0; c<nbColumns; c++) namesSize += columns[c].name.size();
+	size_t dataStart = chunkHeaderSize + nbColumns*columnHeaderSize + padded(namesSize);
+
+	// the data first, the sizes of the encoded columns are then known
+	buffer.assign(dataStart,0);
+	vector<size_t> sizes(nbColumns);
+	for (size_t c=0; c<nbColumns; c++)
+	{
+		const double* column = values + c*rows;
+		size_t start = buffer.size();
+		if (columns[c].encoding == ENCODING_DELTA)
+		{
+			encodeDelta(buffer, column, rows, columns[c].type);
+		} else if (columns[c].type == COLUMN_FLOAT64) {
+			buffer.resize(start+8*rows);
+			memcpy(&buffer[start], column, 8*rows);
+		} else {
+			buffer.resize(start+4*rows);
+			for (size_t i=0; i<rows; i++)
+			{
+				float f = (float)column[i];
+				memcpy(&buffer[start+4*i], &f, 4);
+			}
+		}
+		sizes[c] = buffer.size()-start;
+		buffer.resize(padded(buffer.size()),0);
+	}
+
+	vector<uint8_t> header;
+	header.insert(header.end(), chunkMagic, chunkMagic+4);
+	put<uint32_t>(header, (uint32_t)nbColumns);
+	put<uint64_t>(header, rows);
+	put<uint64_t>(header, buffer.size());
+	for (size_t c=0; c<nbColumns; c++)
+	{
+		put<uint8_t>(header, (uint8_t)columns[c].type);
+		put<uint8_t>(header, (uint8_t)columns[c].encoding);
+		put<uint16_t>(header, (uint16_t)columns[c].name.size());
+		put<uint32_t>(header, 0);
+		put<uint64_t>(header, sizes[c]);
+	}
+	for (size_t c=0; c<nbColumns; c++) header.insert(header.end(), columns[c].name.begin(), columns[c].name.end());
+	memcpy(&buffer[0], &header[0], header.size());
+
+	// a single write, flushed, so that a crash loses at most this chunk
+	if (fwrite(&buffer[0], 1, buffer.size(), file) != buffer.size() || fflush(file) != 0) return -3;
+
+	return 0;
+}
+
+void ResultWriter::close()
+{
+	if (file) fclose(file);
+	file = NULL;
+	columns.clear();
+}
+
+ResultReader::ResultReader()
+{
+	rowCount = validEnd = 0;
+}
+
+int ResultReader::open(const char* path)
+{
+	close();
+
+	int err = file.open(path);
+	if (err) return err;
+
+	const uint8_t* base = (const uint8_t*)file.begin();
+	size_t size = file.size();
+	if (size < fileHeaderSize || memcmp(base, fileMagic, 8) || get<uint32_t>(base+8) != version)
+	{
+		close();
+		return -4;
+	}
+
+	// every complete chunk, up to the first one cut short
+	size_t at = fileHeaderSize;
+	validEnd = at;
+	while (size-at >= chunkHeaderSize)
+	{
+		const uint8_t* p = base+at;
+		if (memcmp(p, chunkMagic, 4)) break;
+		uint32_t nbColumns = get<uint32_t>(p+4);
+		uint64_t rows = get<uint64_t>(p+8);
+		uint64_t chunkSize = get<uint64_t>(p+16);
+		// the column headers, then the names, within the chunk (and a value takes a byte at least)
+		if (nbColumns == 0 || chunkSize > size-at || chunkSize < chunkHeaderSize + (uint64_t)nbColumns*columnHeaderSize || rows > chunkSize) break;
+
+		vector<ColumnInfo> chunkColumns(nbColumns);
+		Chunk chunk;
+		chunk.rows = rows;
+		size_t names = chunkHeaderSize + nbColumns*columnHeaderSize;
+		size_t namesSize = 0;
+		bool valid = true;
+		for (uint32_t c=0; c<nbColumns; c++) namesSize += get<uint16_t>(p+chunkHeaderSize+c*columnHeaderSize+2);
+		size_t data = names + padded(namesSize);
+		if (data > chunkSize) break;
+		for (uint32_t c=0; c<nbColumns && valid; c++)
+		{
+			const uint8_t* h = p+chunkHeaderSize+c*columnHeaderSize;
+			uint8_t type = h[0], encoding = h[1];
+			uint16_t nameLength = get<uint16_t>(h+2);
+			uint64_t dataSize = get<uint64_t>(h+8);
+			if (type > COLUMN_FLOAT32 || encoding > ENCODING_DELTA || data > chunkSize || dataSize > chunkSize-data) {valid = false; break;}
+			if (encoding == ENCODING_RAW && dataSize != rows*(type == COLUMN_FLOAT64 ? 8 : 4)) {valid = false; break;}
+
+			chunkColumns[c].name.assign((const char*)p+names, nameLength);
+			chunkColumns[c].type = (ColumnType)type;
+			chunkColumns[c].encoding = (ColumnEncoding)encoding;
+			names += nameLength;
+			chunk.data.push_back(p+data);
+			chunk.size.push_back(dataSize);
+			data += padded(dataSize);
+		}
+		if (!valid) break;
+		if (chunks.empty()) columns = chunkColumns;
+		else if (!sameColumns(columns, chunkColumns)) break;
+
+		chunks.push_back(chunk);
+		rowCount += rows;
+		at += chunkSize;
+		validEnd = at;
+	}
+
+	return 0;
+}
+
+void ResultReader::close()
+{
+	file.close();
+	columns.clear();
+	chunks.clear();
+	rowCount = validEnd = 0;
+}
+
+int ResultReader::findColumn(const string &name) const
+{
+	for (size_t i=0; i<columns.size(); i++)
+	{
+		if (columns[i].name == name) return i;
+	}
+	return -5;
+}
+
+int ResultReader::read(int column, double* values) const
+{
+	if (!isOpen()) return -2;
+	if (column < 0 || column >= (int)columns.size()) return -5;
+	if (!values && rowCount > 0) return -1;
+
+	const ColumnInfo &info = columns[column];
+	for (size_t k=0; k<chunks.size(); k++)
+	{
+		const Chunk &chunk = chunks[k];
+		const uint8_t* data = chunk.data[column];
+		if (info.encoding == ENCODING_DELTA)
+		{
+			if (!decodeDelta(data, chunk.size[column], chunk.rows, info.type, values)) return -4;
+		} else if (info.type == COLUMN_FLOAT64) {
+			memcpy(values, data, 8*chunk.rows);
+		} else {
+			for (size_t i=0; i<chunk.rows; i++) values[i] = get<float>(data+4*i);
+		}
+		values += chunk.rows;
+	}
+
+	return 0;
+}
+
+int ResultReader::exportText(const char* path, const vector<int> &indices) const
+{
+	if (!isOpen()) return -2;
+
+	vector<int> selected(indices);
+	if (selected.empty())
+	{
+		for (size_t c=0; c<columns.size(); c++) selected.push_back(c);
+	}
+	size_t nbColumns = selected.size();
+	vector<double> values(nbColumns*rowCount);
+	for (size_t c=0; c<nbColumns; c++)
+	{
+		int err = read(selected[c], &values[c*rowCount]);
+		if (err) return err;
+	}
+
+	FILE* out = fopen(path, "wb");
+	if (!out) return -3;
+
+	string text;
+	for (size_t c=0; c<nbColumns; c++)
+	{
+		text += columns[selected[c]].name;
+		text += c+1 < nbColumns ? '\t' : '\n';
+	}
+
+	// as videoTracker: every value followed by a tab
+	bool ok = true;
+	char number[40];
+	for (size_t i=0; i<rowCount && ok; i++)
+	{
+		for (size_t c=0; c<nbColumns; c++)
+		{
+			int n = formatShortest(values[c*rowCount+i], number);
+			number[n] = '\t';
+			text.append(number, n+1);
+		}
+		text += '\n';
+		if (text.size() > (1 << 20))
+		{
+			ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+			text.clear();
+		}
+	}
+	if (ok) ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+	if (fclose(out) != 0) ok = false;
+
+	return ok ? 0 : -3;
+}
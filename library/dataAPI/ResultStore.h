@@ -0,0 +1,100 @@
+/***************************************************
+This is the header file for the binary result store, the
+columnar counterpart of the vidExt_*.txt files.
+
+A store is a file header followed by chunks.  Every chunk
+describes its columns (name, type, encoding) and holds the
+values of each column contiguously, 8 byte aligned, so a
+chunk is appended with a single write and a reader never
+parses text.  Columns are float64 or float32, stored raw or
+delta encoded: the difference of the bit patterns of
+consecutive values (as integers, so it is lossless) is
+zigzag varint coded.  That takes a byte per value for
+constant columns (settings) but six or seven for columns
+that vary, even by a constant step (time), where raw is
+as small and faster.
+
+All the chunks of a store have the same columns.  A chunk
+cut short by a crash is ignored by the reader and replaced
+by the next append.  Values are little endian.
+
+The reader maps the file (see MappedFile.h) and decodes
+only the columns that are asked for.  exportText writes
+the same tab separated layout as videoTracker, with the
+shortest digits that read back exactly (see Numbers.h).
+**************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+enum ColumnType {COLUMN_FLOAT64=0, COLUMN_FLOAT32=1};
+enum ColumnEncoding {ENCODING_RAW=0, ENCODING_DELTA=1};
+
+struct ColumnInfo
+{
+	std::string name;
+	ColumnType type;
+	ColumnEncoding encoding;
+};
+
+class ResultWriter
+{
+public:
+	ResultWriter();
+	~ResultWriter();
+
+	// appends to an existing store with the same columns, creates it otherwise;
+	// -3 when the file cannot be written, -4 when it is not a store, -7 when the columns differ
+	int open(const char* path, const std::vector<ColumnInfo> &columns);
+	// one chunk of rows values per column, column after column (as a Matlab matrix)
+	int append(const double* values, size_t rows);
+	void close();
+
+private:
+	FILE* file;
+	std::vector<ColumnInfo> columns;
+	std::vector<uint8_t> buffer;
+};
+
+class ResultReader
+{
+public:
+	ResultReader();
+
+	// -3 when the file cannot be read, -4 when it is not a store
+	int open(const char* path);
+	void close();
+	bool isOpen() const { return file.isOpen(); }
+
+	const std::vector<ColumnInfo>& getColumns() const { return columns; }
+	size_t nbRows() const { return rowCount; }
+	// end of the last complete chunk
+	size_t validSize() const { return validEnd; }
+	int findColumn(const std::string &name) const;
+
+	// the nbRows() values of a column
+	int read(int column, double* values) const;
+
+	// the columns (all if empty) as tab separated text
+	int exportText(const char* path, const std::vector<int> &indices) const;
+
+private:
+	struct Chunk
+	{
+		size_t rows;
+		// start and size of the data of each column
+		std::vector<const uint8_t*> data;
+		std::vector<size_t> size;
+	};
+
+	MappedFile file;
+	std::vector<ColumnInfo> columns;
+	std::vector<Chunk> chunks;
+	size_t rowCount, validEnd;
+};
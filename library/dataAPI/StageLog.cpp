@@ -0,0 +1,303 @@
+/***************************************************
+Stage log reader, see StageLog.h.
+**************************************************/
+
+#include "StageLog.h"
+#include "Numbers.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+using namespace std;
+
+static const double NaN = numeric_limits<double>::quiet_NaN();
+
+static string trim(const char* begin, const char* end)
+{
+	while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r')) begin++;
+	while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+	return string(begin, end);
+}
+
+// end of the line starting at p, without the '\r' of Windows files
+static const char* lineEnd(const char* p, const char* end, const char* &next)
+{
+	const char* eol = (const char*)memchr(p, '\n', end-p);
+	next = eol ? eol+1 : end;
+	if (!eol) eol = end;
+	if (eol > p && eol[-1] == '\r') eol--;
+	return eol;
+}
+
+StageLog::StageLog()
+{
+	dataStart = NULL;
+	rowCount = 0;
+	timeStart = timeStep = 0;
+	evenlySpaced = false;
+}
+
+int StageLog::open(const char* path, int nbThreads)
+{
+	close();
+	if (nbThreads < 0) return -1;
+	pool.setThreads(nbThreads);
+
+	int err = file.open(path);
+	if (err) return err;
+
+	// header lines up to the line of '='
+	const char* p = file.begin();
+	const char* end = file.end();
+	bool separator = false;
+	while (p < end && !separator)
+	{
+		const char* next;
+		const char* eol = lineEnd(p, end, next);
+		if (eol-p >= 3 && !strncmp(p, "===", 3))
+		{
+			separator = true;
+		} else {
+			const char* colon = (const char*)memchr(p, ':', eol-p);
+			if (colon) header.push_back(make_pair(trim(p, colon), trim(colon+1, eol)));
+		}
+		p = next;
+	}
+	if (!separator || p >= end)
+	{
+		close();
+		return -4;
+	}
+
+	// column names
+	const char* next;
+	const char* eol = lineEnd(p, end, next);
+	while (p < eol)
+	{
+		const char* tab = (const char*)memchr(p, '\t', eol-p);
+		if (!tab) tab = eol;
+		string name = trim(p, tab);
+		if (!name.empty()) columns.push_back(name);
+		p = tab < eol ? tab+1 : eol;
+	}
+	if (columns.empty())
+	{
+		close();
+		return -4;
+	}
+	dataStart = next;
+	findRows();
+
+	return 0;
+}
+
+void StageLog::close()
+{
+	file.close();
+	header.clear();
+	columns.clear();
+	dataStart = NULL;
+	chunkStart.clear();
+	chunkRows.clear();
+	rowCount = 0;
+	time.clear();
+	evenlySpaced = false;
+	cachedIndices.clear();
+	cachedValues.clear();
+}
+
+// one chunk of whole lines per thread, and the number of (non-empty) rows of each
+void StageLog::findRows()
+{
+	const char* end = file.end();
+	size_t size = end-dataStart;
+	// not worth a thread below a megabyte, and the threads are only started above
+	int nbChunks = (int)min(size >> 20, (size_t)1024);
+	nbChunks = nbChunks > 1 ? min(nbChunks,pool.size()) : 1;
+
+	chunkStart.resize(nbChunks+1);
+	chunkStart[0] = dataStart;
+	for (int c=1; c<nbChunks; c++)
+	{
+		const char* p = max(dataStart + size*c/nbChunks, chunkStart[c-1]);
+		const char* eol = p < end ? (const char*)memchr(p, '\n', end-p) : NULL;
+		chunkStart[c] = eol ? eol+1 : end;
+	}
+	chunkStart[nbChunks] = end;
+
+	chunkRows.assign(nbChunks,0);
+	pool.run(nbChunks, [&](int c)
+	{
+		size_t rows = 0;
+		const char* p = chunkStart[c];
+		const char* chunkEnd = chunkStart[c+1];
+		while (p < chunkEnd)
+		{
+			const char* next;
+			const char* eol = lineEnd(p, chunkEnd, next);
+			if (eol > p) rows++;
+			p = next;
+		}
+		chunkRows[c] = rows;
+	});
+
+	rowCount = 0;
+	for (int c=0; c<nbChunks; c++) rowCount += chunkRows[c];
+}
+
+int StageLog::findColumn(const string &name) const
+{
+	for (size_t i=0; i<columns.size(); i++)
+	{
+		if (columns[i] == name) return i;
+	}
+	return -5;
+}
+
+int StageLog::read(const vector<int> &indices, vector<double> &values)
+{
+	if (!isOpen()) return -2;
+
+	int maxIndex = -1;
+	for (size_t k=0; k<indices.size(); k++)
+	{
+		if (indices[k] < 0 || indices[k] >= (int)columns.size()) return -5;
+		maxIndex = max(maxIndex,indices[k]);
+	}
+	// output slot of every field of a row, -1 for the fields that are skipped
+	vector<int> slot(maxIndex+1,-1);
+	for (size_t k=0; k<indices.size(); k++) slot[indices[k]] = k;
+
+	values.assign(rowCount*indices.size(),NaN);
+	if (indices.empty()) return 0;
+
+	int nbChunks = chunkRows.size();
+	vector<size_t> firstRow(nbChunks,0);
+	for (int c=1; c<nbChunks; c++) firstRow[c] = firstRow[c-1]+chunkRows[c-1];
+
+	double* out = &values[0];
+	size_t nbRows = rowCount;
+	pool.run(nbChunks, [&](int c)
+	{
+		size_t row = firstRow[c];
+		const char* p = chunkStart[c];
+		const char* chunkEnd = chunkStart[c+1];
+		while (p < chunkEnd)
+		{
+			const char* next;
+			const char* eol = lineEnd(p, chunkEnd, next);
+			if (eol == p)
+			{
+				p = next;
+				continue;
+			}
+
+			const char* q = p;
+			for (int field=0; field<=maxIndex; field++)
+			{
+				// the number must end before the next tab, an empty field stays NaN
+				const char* tab = (const char*)memchr(q, '\t', eol-q);
+				double v;
+				const char* number = q;
+				if (slot[field] >= 0 && parseDouble(number, tab ? tab : eol, v)) out[slot[field]*nbRows+row] = v;
+
+				if (!tab) break;
+				q = tab+1;
+			}
+			row++;
+			p = next;
+		}
+	});
+
+	return 0;
+}
+
+int StageLog::buildIndex()
+{
+	if (!isOpen()) return -2;
+	if (!time.empty()) return 0;
+
+	int column = -5;
+	for (size_t i=0; i<columns.size() && column < 0; i++)
+	{
+		if (!columns[i].compare(0, 4, "Time")) column = i;
+	}
+	if (column < 0) return column;
+
+	vector<double> t;
+	int err = read(vector<int>(1,column), t);
+	if (err) return err;
+	if (t.empty()) return -6;
+
+	for (size_t i=1; i<t.size(); i++)
+	{
+		if (!(t[i] > t[i-1])) return -6;
+	}
+
+	// evenly spaced samples are found directly
+	size_t n = t.size();
+	timeStart = t[0];
+	timeStep = n > 1 ? (t[n-1]-t[0])/(n-1) : 0;
+	evenlySpaced = n > 1;
+	for (size_t i=0; i<n && evenlySpaced; i++) evenlySpaced = fabs(t[i]-(timeStart+i*timeStep)) <= 1e-3*timeStep;
+	time.swap(t);
+
+	return 0;
+}
+
+int StageLog::findRow(double t) const
+{
+	int n = time.size();
+	if (n == 0 || !(t >= time[0])) return -1;
+
+	if (evenlySpaced)
+	{
+		double r = floor((t-timeStart)/timeStep);
+		int i = r < n ? (int)r : n-1;
+		// the samples are within a fraction of a step of the grid
+		while (i > 0 && time[i] > t) i--;
+		while (i+1 < n && time[i+1] <= t) i++;
+		return i;
+	}
+
+	return (int)(upper_bound(time.begin(), time.end(), t) - time.begin()) - 1;
+}
+
+int StageLog::interpolate(const vector<int> &indices, const double* times, int n, vector<double> &values)
+{
+	if (n < 0 || (n > 0 && !times)) return -1;
+
+	int err = buildIndex();
+	if (err) return err;
+
+	if (indices != cachedIndices || cachedValues.empty())
+	{
+		err = read(indices, cachedValues);
+		if (err) return err;
+		cachedIndices = indices;
+	}
+
+	size_t nbRows = time.size(), k = indices.size();
+	values.assign((size_t)n*k,NaN);
+	for (int j=0; j<n; j++)
+	{
+		double t = times[j];
+		if (!(t >= time[0] && t <= time[nbRows-1])) continue;
+
+		int i = findRow(t);
+		if (i == (int)nbRows-1)
+		{
+			for (size_t c=0; c<k; c++) values[c*n+j] = cachedValues[c*nbRows+i];
+			continue;
+		}
+		double w = (t-time[i])/(time[i+1]-time[i]);
+		for (size_t c=0; c<k; c++)
+		{
+			const double* column = &cachedValues[c*nbRows];
+			values[c*n+j] = column[i] + w*(column[i+1]-column[i]);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,82 @@
+/***************************************************
+This is the header file for the stage log reader.
+
+The tensile stage writes stage_*.txt: a header of
+"Key : value" lines, a line of '=', a line of column names
+and then one row of tab separated numbers per sample
+(every 0.1 s).
+
+The log is memory-mapped (see MappedFile.h).  Opening it
+only reads the header; the rows are found by splitting the
+data into one chunk per thread at line ends, counting the
+lines of each chunk and then parsing the requested columns
+of every chunk straight into its part of the output, so the
+columns that are not asked for are skipped with a memchr
+and never parsed.  The chunks run on a WorkerPool (see
+../trackerAPI/WorkerPool.h), whose threads are kept from
+one call to the next.
+
+The time column is read once and indexed: lookups and
+interpolations at arbitrary times are O(1) when the
+samples are evenly spaced (the usual case) and a binary
+search, O(log n), otherwise.
+**************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "../trackerAPI/WorkerPool.h"
+
+class StageLog
+{
+public:
+	StageLog();
+
+	// -3 when the file cannot be read, -4 when it is not a stage log
+	int open(const char* path, int nbThreads = 0);
+	void close();
+	bool isOpen() const { return file.isOpen(); }
+
+	const std::vector<std::pair<std::string,std::string> >& getHeader() const { return header; }
+	const std::vector<std::string>& getColumns() const { return columns; }
+	int nbRows() const { return (int)rowCount; }
+	// index of the column, -5 when there is none
+	int findColumn(const std::string &name) const;
+
+	// the rows x indices.size() values of the columns, column after column;
+	// NaN for missing or unreadable values
+	int read(const std::vector<int> &indices, std::vector<double> &values);
+
+	// the time column (the first one whose name starts with "Time"), -5 if there is none,
+	// -6 if the time does not increase
+	int buildIndex();
+	const std::vector<double>& getTime() const { return time; }
+	// row i such that time[i] <= t < time[i+1], -1 before the first sample
+	int findRow(double t) const;
+	// linear interpolation of the columns at the times, NaN outside of the log
+	int interpolate(const std::vector<int> &indices, const double* times, int n, std::vector<double> &values);
+
+private:
+	void findRows();
+
+	MappedFile file;
+	// the threads of the chunks, kept between the calls
+	WorkerPool pool;
+	std::vector<std::pair<std::string,std::string> > header;
+	std::vector<std::string> columns;
+	// the data rows: one chunk per thread, its start and its number of rows
+	const char* dataStart;
+	std::vector<const char*> chunkStart;
+	std::vector<size_t> chunkRows;
+	size_t rowCount;
+
+	std::vector<double> time;
+	double timeStart, timeStep;
+	bool evenlySpaced;
+	// columns already read for interpolate
+	std::vector<int> cachedIndices;
+	std::vector<double> cachedValues;
+};
@@ -0,0 +1,138 @@
+/***************************************************
+Synchronisation of two time series, see Sync.h.
+**************************************************/
+
+#include "Sync.h"
+#include "../trackerAPI/FFT.h"
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// linear interpolation of increasing samples on t0, t0+step, ...; the last value is held after the end
+static void resample(const double* t, const double* v, int n, double step, vector<double> &out)
+{
+	int m = (int)floor((t[n-1]-t[0])/step)+1;
+	out.resize(m);
+	int j = 0;
+	for (int i=0; i<m; i++)
+	{
+		double ti = t[0]+i*step;
+		while (j+1 < n && t[j+1] <= ti) j++;
+		out[i] = j+1 < n ? v[j] + (ti-t[j])/(t[j+1]-t[j])*(v[j+1]-v[j]) : v[n-1];
+	}
+}
+
+// zero mean, unit variance (a constant signal stays 0)
+static void standardise(vector<double> &v)
+{
+	double mean = 0, var = 0;
+	for (size_t i=0; i<v.size(); i++) mean += v[i];
+	mean /= v.size();
+	for (size_t i=0; i<v.size(); i++) var += (v[i]-mean)*(v[i]-mean);
+	double scale = var > 0 ? 1/sqrt(var/v.size()) : 0;
+	for (size_t i=0; i<v.size(); i++) v[i] = (v[i]-mean)*scale;
+}
+
+// correlation coefficient of a[i] and b[i+lag] over the overlap
+static double coefficient(const vector<double> &a, const vector<double> &b, int lag)
+{
+	int i0 = max(0,-lag), i1 = min((int)a.size(),(int)b.size()-lag);
+	int n = i1-i0;
+	if (n < 2) return 0;
+
+	double sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+	for (int i=i0; i<i1; i++)
+	{
+		double x = a[i], y = b[i+lag];
+		sa += x; sb += y;
+		saa += x*x; sbb += y*y; sab += x*y;
+	}
+	double va = saa-sa*sa/n, vb = sbb-sb*sb/n;
+	return va > 0 && vb > 0 ? (sab-sa*sb/n)/sqrt(va*vb) : 0;
+}
+
+int synchronise(const double* tA, const double* a, int nA, const double* tB, const double* b, int nB,
+	double step, double maxOffset, bool rate, double* offset, double* score)
+{
+	if (!tA || !a || !tB || !b || !offset || nA < 3 || nB < 3) return -1;
+	for (int i=1; i<nA; i++) if (!(tA[i] > tA[i-1])) return -1;
+	for (int i=1; i<nB; i++) if (!(tB[i] > tB[i-1])) return -1;
+
+	if (step <= 0) step = max((tA[nA-1]-tA[0])/(nA-1),(tB[nB-1]-tB[0])/(nB-1));
+
+	vector<double> x, y;
+	resample(tA, a, nA, step, x);
+	resample(tB, b, nB, step, y);
+	if (rate)
+	{
+		for (size_t i=0; i+1<x.size(); i++) x[i] = x[i+1]-x[i];
+		for (size_t i=0; i+1<y.size(); i++) y[i] = y[i+1]-y[i];
+		x.pop_back();
+		y.pop_back();
+	}
+	int n = x.size(), m = y.size();
+	if (n < 3 || m < 3) return -1;
+	standardise(x);
+	standardise(y);
+
+	// lags where the signals overlap enough, and within maxOffset
+	int minOverlap = max(min(n,m)/2,3);
+	int lag0 = -(n-minOverlap), lag1 = m-minOverlap;
+	double origin = (tB[0]-tA[0])/step;
+	if (maxOffset > 0)
+	{
+		lag0 = max(lag0,(int)ceil(-maxOffset/step-origin));
+		lag1 = min(lag1,(int)floor(maxOffset/step-origin));
+	}
+	if (lag1 < lag0) return -1;
+
+	// cross products of every lag: c[lag] = sum x[i] y[i+lag]
+	int size = nextPowerOfTwo(n+m);
+	FFTPlan plan(size);
+	vector<Complex> fx(size), fy(size);
+	for (int i=0; i<n; i++) fx[i] = Complex((float)x[i],0);
+	for (int i=0; i<m; i++) fy[i] = Complex((float)y[i],0);
+	plan.forward(&fx[0]);
+	plan.forward(&fy[0]);
+	for (int k=0; k<size; k++) fx[k] = conj(fx[k])*fy[k];
+	plan.inverse(&fx[0]);
+
+	// overlap sums from prefix sums
+	vector<double> px(n+1,0), pxx(n+1,0), py(m+1,0), pyy(m+1,0);
+	for (int i=0; i<n; i++) {px[i+1] = px[i]+x[i]; pxx[i+1] = pxx[i]+x[i]*x[i];}
+	for (int i=0; i<m; i++) {py[i+1] = py[i]+y[i]; pyy[i+1] = pyy[i]+y[i]*y[i];}
+
+	int best = lag0;
+	double bestScore = -2;
+	for (int lag=lag0; lag<=lag1; lag++)
+	{
+		int i0 = max(0,-lag), i1 = min(n,m-lag), count = i1-i0;
+		double sa = px[i1]-px[i0], saa = pxx[i1]-pxx[i0];
+		double sb = py[i1+lag]-py[i0+lag], sbb = pyy[i1+lag]-pyy[i0+lag];
+		double sab = fx[(lag+size)%size].real();
+		double va = saa-sa*sa/count, vb = sbb-sb*sb/count;
+		double r = va > 0 && vb > 0 ? (sab-sa*sb/count)/sqrt(va*vb) : 0;
+		if (r > bestScore)
+		{
+			bestScore = r;
+			best = lag;
+		}
+	}
+
+	// exact coefficients around the peak, and the top of the parabola through them
+	double r0 = coefficient(x, y, best);
+	double shift = 0;
+	if (best > lag0 && best < lag1)
+	{
+		double rm = coefficient(x, y, best-1), rp = coefficient(x, y, best+1);
+		double curvature = rm-2*r0+rp;
+		if (curvature < 0) shift = max(-0.5,min(0.5,0.5*(rm-rp)/curvature));
+	}
+
+	*offset = (origin+best+shift)*step;
+	if (score) *score = r0;
+
+	return 0;
+}
@@ -0,0 +1,31 @@
+/***************************************************
+This is the header file for the synchronisation of two
+time series, the displacement measured on the video and
+the displacement (or force) logged by the stage, which are
+started at different moments.
+
+Both signals are resampled on grids of the same step and
+compared at every lag by their correlation coefficient
+over the samples that overlap, so that the units, the
+scale and the offset of the two signals do not matter
+(the video measures mm between blobs, the stage um of the
+crosshead).  The cross products of all lags come from one
+FFT (see trackerAPI/FFT.h) and the sums over the overlaps
+from prefix sums.  The best lag is then refined with the
+exact coefficients of its neighbours, computed directly in
+double precision, and a parabola through them gives the
+offset to a fraction of a step.
+
+With rate, the signals are differenced first: a constant
+rate test is then a step at the start of the loading and
+another at the failure, which are sharper than the kinks
+of the displacement itself.
+**************************************************/
+
+#pragma once
+
+// offset such that a(t) matches b(t + offset); score is the correlation coefficient at the
+// offset (1 = perfect match).  step <= 0 uses the larger mean sample interval of the two signals,
+// maxOffset <= 0 searches all the offsets where the signals overlap by half the shorter one.
+int synchronise(const double* tA, const double* a, int nA, const double* tB, const double* b, int nB,
+	double step, double maxOffset, bool rate, double* offset, double* score);
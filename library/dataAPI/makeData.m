@@ -0,0 +1,24 @@
+function makeData
+% function makeData
+% makeData compiles mexStageLog, the reader of the stage_*.txt logs of
+% the tensile stage, which also synchronises them with the video
+% measurements (see syncStageLog.m), and mexResultStore, the binary
+% counterpart of the vidExt_*.txt files written by videoTracker with the
+% 'binary' option.  Any C++ compiler that mex is configured with will do
+% (type mex -setup at the matlab prompt if needed).
+
+sources = {'StageLog.cpp', 'Numbers.cpp', 'MappedFile.cpp', 'Sync.cpp', 'ResultStore.cpp', '../trackerAPI/FFT.cpp', '../trackerAPI/WorkerPool.cpp'};
+mexFiles = {'mexStageLog.cpp', 'mexResultStore.cpp'};
+
+currentdir = pwd;
+cd(fileparts(mfilename('fullpath')));
+try
+    for i = 1:numel(mexFiles)
+        disp(['Running: mex -O ' mexFiles{i} ' ' sprintf('%s ',sources{:})]);
+        mex('-O', mexFiles{i}, sources{:});
+    end
+catch
+    cd(currentdir);
+    rethrow(lasterror);
+end
+cd(currentdir);
@@ -0,0 +1,160 @@
+/***************************************************
+This is the matlab interface code to the binary result
+store.  It just wraps the functions of ResultStore.h and
+does some error conversion.
+
+  mexResultStore('write', path, names, values, types, delta)
+      names      1xC cell of the column names
+      values     RxC double, appended as one chunk (the store is
+                 created if needed)
+      types      optional, 'double' or 'single', or a cell of them per
+                 column (default 'double')
+      delta      optional, 1xC logical, delta encode the columns
+                 (default false)
+  [values, names] = mexResultStore('read', path, columns)
+      columns    optional, a name, a cell of names or 1-based indices
+                 (default all)
+  mexResultStore('export', path, textPath, columns)
+      writes the columns as tab separated text, as vidExt_*.txt
+**************************************************/
+
+#include "mex.h"
+#include "ResultStore.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+const char* message(int err)
+{
+	switch (err)
+	{
+		case 0: return "";
+		case -1: return "Invalid parameters";
+		case -2: return "The store is not open";
+		case -3: return "Cannot read or write the file";
+		case -4: return "Not a result store, or a damaged one";
+		case -5: return "Unknown column";
+		case -7: return "The columns differ from those of the store";
+		default: return "Unknown error";
+	}
+}
+
+string getString(const mxArray* arg)
+{
+	char* s = mxArrayToString(arg);
+	string value(s ? s : "");
+	mxFree(s);
+	return value;
+}
+
+// column names or 1-based indices to 0-based indices, all columns if there is no argument
+int columnIndices(const ResultReader &reader, const mxArray* arg, vector<int> &indices)
+{
+	indices.clear();
+	if (!arg)
+	{
+		for (size_t i=0; i<reader.getColumns().size(); i++) indices.push_back(i);
+	} else if (mxIsChar(arg)) {
+		int i = reader.findColumn(getString(arg));
+		if (i < 0) return i;
+		indices.push_back(i);
+	} else if (mxIsCell(arg)) {
+		for (size_t k=0; k<mxGetNumberOfElements(arg); k++)
+		{
+			const mxArray* cell = mxGetCell(arg,k);
+			if (!cell || !mxIsChar(cell)) return -1;
+			int i = reader.findColumn(getString(cell));
+			if (i < 0) return i;
+			indices.push_back(i);
+		}
+	} else if (mxIsDouble(arg)) {
+		double* index = mxGetPr(arg);
+		for (size_t k=0; k<mxGetNumberOfElements(arg); k++)
+		{
+			int i = (int)index[k]-1;
+			if (i < 0 || i >= (int)reader.getColumns().size()) return -5;
+			indices.push_back(i);
+		}
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (nrhs < 1 || !mxIsChar(prhs[0])) mexErrMsgTxt("First parameter must be the command (a string)");
+
+	char cmd[100];
+	mxGetString(prhs[0],cmd,100);
+
+	if (!strcmp("write",cmd))
+	{
+		if (nrhs < 4 || !mxIsChar(prhs[1]) || !mxIsCell(prhs[2]) || !mxIsDouble(prhs[3])) mexErrMsgTxt("write: parameters must be the path, the column names and the values");
+		if (nlhs > 0) mexErrMsgTxt("write: there are no outputs");
+
+		size_t nbColumns = mxGetNumberOfElements(prhs[2]);
+		if (mxGetN(prhs[3]) != nbColumns && !mxIsEmpty(prhs[3])) mexErrMsgTxt("write: there must be a column of values per name");
+
+		vector<ColumnInfo> columns(nbColumns);
+		for (size_t c=0; c<nbColumns; c++)
+		{
+			const mxArray* name = mxGetCell(prhs[2],c);
+			if (!name || !mxIsChar(name)) mexErrMsgTxt("write: the names must be strings");
+			columns[c].name = getString(name);
+
+			const mxArray* type = NULL;
+			if (nrhs >= 5 && mxIsChar(prhs[4])) type = prhs[4];
+			else if (nrhs >= 5 && mxIsCell(prhs[4]) && c < mxGetNumberOfElements(prhs[4])) type = mxGetCell(prhs[4],c);
+			columns[c].type = type && getString(type) == "single" ? COLUMN_FLOAT32 : COLUMN_FLOAT64;
+
+			bool delta = nrhs >= 6 && c < mxGetNumberOfElements(prhs[5]) && (mxIsLogical(prhs[5]) ? mxGetLogicals(prhs[5])[c] : mxGetPr(prhs[5])[c] != 0);
+			columns[c].encoding = delta ? ENCODING_DELTA : ENCODING_RAW;
+		}
+
+		ResultWriter writer;
+		string path = getString(prhs[1]);
+		const char* errmsg = message(writer.open(path.c_str(), columns));
+		if (!strcmp("",errmsg)) errmsg = message(writer.append(mxGetPr(prhs[3]), mxIsEmpty(prhs[3]) ? 0 : mxGetM(prhs[3])));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+	} else if (!strcmp("read",cmd)) {
+		if (nrhs < 2 || !mxIsChar(prhs[1])) mexErrMsgTxt("read: second parameter must be the path");
+		if (nlhs > 2) mexErrMsgTxt("read: there are only 2 output values: values, names");
+
+		ResultReader reader;
+		vector<int> indices;
+		string path = getString(prhs[1]);
+		const char* errmsg = message(reader.open(path.c_str()));
+		if (!strcmp("",errmsg)) errmsg = message(columnIndices(reader, nrhs >= 3 ? prhs[2] : NULL, indices));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		size_t nbRows = reader.nbRows();
+		plhs[0] = mxCreateDoubleMatrix(nbRows,indices.size(),mxREAL);
+		double* values = mxGetPr(plhs[0]);
+		for (size_t c=0; c<indices.size(); c++)
+		{
+			errmsg = message(reader.read(indices[c], values + c*nbRows));
+			if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+		}
+		if (nlhs >= 2)
+		{
+			plhs[1] = mxCreateCellMatrix(1,indices.size());
+			for (size_t c=0; c<indices.size(); c++) mxSetCell(plhs[1],c,mxCreateString(reader.getColumns()[indices[c]].name.c_str()));
+		}
+	} else if (!strcmp("export",cmd)) {
+		if (nrhs < 3 || !mxIsChar(prhs[1]) || !mxIsChar(prhs[2])) mexErrMsgTxt("export: parameters must be the path of the store and of the text file");
+		if (nlhs > 0) mexErrMsgTxt("export: there are no outputs");
+
+		ResultReader reader;
+		vector<int> indices;
+		string path = getString(prhs[1]), textPath = getString(prhs[2]);
+		const char* errmsg = message(reader.open(path.c_str()));
+		if (!strcmp("",errmsg)) errmsg = message(columnIndices(reader, nrhs >= 4 ? prhs[3] : NULL, indices));
+		if (!strcmp("",errmsg)) errmsg = message(reader.exportText(textPath.c_str(), indices));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+	} else {
+		mexErrMsgTxt("Unknown command");
+	}
+}
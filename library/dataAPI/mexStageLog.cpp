@@ -0,0 +1,167 @@
+/***************************************************
+This is the matlab interface code to the stage log
+reader.  It just wraps the functions of StageLog.h and
+does some error conversion.
+
+  [columns, header, rows] = mexStageLog('open', path, threads)
+      columns    1xC cell of the column names
+      header     Hx2 cell of the {key value} lines of the header
+      rows       number of rows
+      threads    optional, 0 (default) for one per core
+  values = mexStageLog('read', columns)
+      columns    a column name, a cell of names or 1-based indices
+      values     rows x numel(columns)
+  values = mexStageLog('interpolate', times, columns)
+      values     numel(times) x numel(columns), linearly interpolated
+                 at the times (in the units of the Time column), NaN
+                 outside of the log
+  [offset, score] = mexStageLog('synchronise', times, signal, column, step, maxOffset, rate)
+      times, signal  the video measurement to align with the column
+      offset     the time of the log matching a time of the video is
+                 times + offset, to a fraction of a sample
+      score      correlation coefficient at the offset (1 = perfect)
+      step, maxOffset, rate  optional, see Sync.h (default 0, 0, false)
+  mexStageLog('close')
+**************************************************/
+
+#include "mex.h"
+#include "StageLog.h"
+#include "Sync.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+StageLog SL;
+vector<double> values;
+
+const char* message(int err)
+{
+	switch (err)
+	{
+		case 0: return "";
+		case -1: return "Invalid parameters";
+		case -2: return "No log, call open first";
+		case -3: return "Cannot read the file";
+		case -4: return "Not a stage log (no header separator or column names)";
+		case -5: return "Unknown column";
+		case -6: return "The Time column does not increase";
+		default: return "Unknown error";
+	}
+}
+
+// column names or 1-based indices to 0-based indices
+int columnIndices(const mxArray* arg, vector<int> &indices)
+{
+	indices.clear();
+	if (mxIsChar(arg))
+	{
+		char* name = mxArrayToString(arg);
+		int i = SL.findColumn(name);
+		mxFree(name);
+		if (i < 0) return i;
+		indices.push_back(i);
+	} else if (mxIsCell(arg)) {
+		for (size_t k=0; k<mxGetNumberOfElements(arg); k++)
+		{
+			const mxArray* cell = mxGetCell(arg,k);
+			if (!cell || !mxIsChar(cell)) return -1;
+			char* name = mxArrayToString(cell);
+			int i = SL.findColumn(name);
+			mxFree(name);
+			if (i < 0) return i;
+			indices.push_back(i);
+		}
+	} else if (mxIsDouble(arg)) {
+		double* index = mxGetPr(arg);
+		for (size_t k=0; k<mxGetNumberOfElements(arg); k++) indices.push_back((int)index[k]-1);
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (nrhs < 1 || !mxIsChar(prhs[0])) mexErrMsgTxt("First parameter must be the command (a string)");
+
+	char cmd[100];
+	mxGetString(prhs[0],cmd,100);
+
+	if (!strcmp("open",cmd))
+	{
+		if (nrhs < 2 || !mxIsChar(prhs[1])) mexErrMsgTxt("open: second parameter must be the path of the log");
+		if (nlhs > 3) mexErrMsgTxt("open: there are only 3 output values: columns, header, rows");
+
+		char* path = mxArrayToString(prhs[1]);
+		int nbThreads = nrhs >= 3 ? (int)mxGetScalar(prhs[2]) : 0;
+		const char* errmsg = message(SL.open(path, nbThreads));
+		mxFree(path);
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		const vector<string> &columns = SL.getColumns();
+		plhs[0] = mxCreateCellMatrix(1,columns.size());
+		for (size_t i=0; i<columns.size(); i++) mxSetCell(plhs[0],i,mxCreateString(columns[i].c_str()));
+		if (nlhs >= 2)
+		{
+			const vector<pair<string,string> > &header = SL.getHeader();
+			int n = header.size();
+			plhs[1] = mxCreateCellMatrix(n,2);
+			for (int i=0; i<n; i++)
+			{
+				mxSetCell(plhs[1],i,mxCreateString(header[i].first.c_str()));
+				mxSetCell(plhs[1],i+n,mxCreateString(header[i].second.c_str()));
+			}
+		}
+		if (nlhs >= 3) plhs[2] = mxCreateDoubleScalar(SL.nbRows());
+	} else if (!strcmp("read",cmd)) {
+		if (nrhs < 2) mexErrMsgTxt("read: second parameter must be the columns");
+		if (nlhs > 1) mexErrMsgTxt("read: there is only 1 output value: values");
+
+		vector<int> indices;
+		const char* errmsg = message(SL.isOpen() ? columnIndices(prhs[1], indices) : -2);
+		if (!strcmp("",errmsg)) errmsg = message(SL.read(indices, values));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		plhs[0] = mxCreateDoubleMatrix(SL.nbRows(),indices.size(),mxREAL);
+		if (!values.empty()) memcpy(mxGetPr(plhs[0]), &values[0], values.size()*sizeof(double));
+	} else if (!strcmp("interpolate",cmd)) {
+		if (nrhs < 3 || !mxIsDouble(prhs[1])) mexErrMsgTxt("interpolate: parameters must be the times and the columns");
+		if (nlhs > 1) mexErrMsgTxt("interpolate: there is only 1 output value: values");
+
+		vector<int> indices;
+		int n = mxGetNumberOfElements(prhs[1]);
+		const char* errmsg = message(SL.isOpen() ? columnIndices(prhs[2], indices) : -2);
+		if (!strcmp("",errmsg)) errmsg = message(SL.interpolate(indices, mxGetPr(prhs[1]), n, values));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		plhs[0] = mxCreateDoubleMatrix(n,indices.size(),mxREAL);
+		if (!values.empty()) memcpy(mxGetPr(plhs[0]), &values[0], values.size()*sizeof(double));
+	} else if (!strcmp("synchronise",cmd)) {
+		if (nrhs < 4 || !mxIsDouble(prhs[1]) || !mxIsDouble(prhs[2]) || mxGetNumberOfElements(prhs[1]) != mxGetNumberOfElements(prhs[2])) mexErrMsgTxt("synchronise: parameters must be the times, the signal and the column");
+		if (nlhs > 2) mexErrMsgTxt("synchronise: there are only 2 output values: offset, score");
+
+		vector<int> indices;
+		const char* errmsg = message(SL.isOpen() ? columnIndices(prhs[3], indices) : -2);
+		if (!strcmp("",errmsg) && indices.size() != 1) errmsg = message(-1);
+		if (!strcmp("",errmsg)) errmsg = message(SL.buildIndex());
+		if (!strcmp("",errmsg)) errmsg = message(SL.read(indices, values));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		double step = nrhs >= 5 ? mxGetScalar(prhs[4]) : 0;
+		double maxOffset = nrhs >= 6 ? mxGetScalar(prhs[5]) : 0;
+		bool rate = nrhs >= 7 && mxGetScalar(prhs[6]) != 0;
+		double offset, score;
+		const vector<double> &time = SL.getTime();
+		if (synchronise(mxGetPr(prhs[1]), mxGetPr(prhs[2]), mxGetNumberOfElements(prhs[1]), &time[0], &values[0], time.size(), step, maxOffset, rate, &offset, &score)) mexErrMsgTxt("synchronise: the signals do not overlap or the times do not increase");
+
+		plhs[0] = mxCreateDoubleScalar(offset);
+		if (nlhs >= 2) plhs[1] = mxCreateDoubleScalar(score);
+	} else if (!strcmp("close",cmd)) {
+		if (nlhs > 0) mexErrMsgTxt("close: there are no outputs");
+		SL.close();
+	} else {
+		mexErrMsgTxt("Unknown command");
+	}
+}
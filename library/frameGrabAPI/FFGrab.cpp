@@ -57,19 +57,580 @@ extern "C" {
 	};
 }
 
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <chrono>
 #include <vector>
 #include <map>
+#include <list>
+#include <set>
+#include <string>
 using namespace std;
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+// mex FFGrab.cpp ../dataAPI/MappedFile.cpp Keyframes.cpp -lavbin
+#include "../dataAPI/MappedFile.h"
+#include "Keyframes.h"
+
 map<unsigned int,double> keyframes;
 unsigned int startDecodingAt;
 
+// where the captures spend their time: the time and number of calls of every stage and
+// the work done, since the last reset.  The colour conversion to RGB24 is done by
+// avbin_decode_video, it is part of decode; convert is the cropping and channel
+// reduction of the frames for the frame store, stats the per-frame statistics.  With a trace file, every timed interval
+// is also kept and the file is rewritten at the end of each capture as Chrome trace
+// events (chrome://tracing or ui.perfetto.dev).
+enum Stage {STAGE_CAPTURE, STAGE_DEMUX, STAGE_DECODE, STAGE_CONVERT, STAGE_COPY, STAGE_CALLBACK, STAGE_SEEK, STAGE_STATS, NB_STAGES};
+const char* stageNames[NB_STAGES] = {"capture", "demux", "decode", "convert", "copy", "callback", "seek", "stats"};
+
+class CaptureStats
+{
+public:
+	CaptureStats()
+	{
+		tracePath = NULL;
+		traceStart = now();
+		reset();
+	}
+
+	void reset()
+	{
+		for (int s=0; s<NB_STAGES; s++)
+		{
+			seconds[s] = 0;
+			calls[s] = 0;
+		}
+		packetsRead = packetsDecoded = framesKept = bytesAllocated = 0;
+	}
+
+	static double now()
+	{
+		return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// the interval from start to now
+	void add(Stage stage, double start)
+	{
+		double end = now();
+		seconds[stage] += end-start;
+		calls[stage]++;
+		if (tracePath && events.size() < maxEvents)
+		{
+			Event e = {stage, start, end-start};
+			events.push_back(e);
+		}
+	}
+
+	// NULL to stop tracing, the events recorded so far are dropped
+	void setTrace(const char* path)
+	{
+		free(tracePath);
+		tracePath = path ? strdup(path) : NULL;
+		events.clear();
+		traceStart = now();
+	}
+	bool tracing() const { return tracePath != NULL; }
+
+	// -3 when the file cannot be written
+	int writeTrace() const
+	{
+		FILE* f = fopen(tracePath, "w");
+		if (!f) return -3;
+		fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+		for (size_t k=0; k<events.size(); k++)
+		{
+			fprintf(f, "{\"name\": \"%s\", \"cat\": \"FFGrab\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": 1}%s\n",
+				stageNames[events[k].stage], 1e6*(events[k].start-traceStart), 1e6*events[k].duration, k+1 < events.size() ? "," : "");
+		}
+		fprintf(f, "]}\n");
+		return fclose(f) ? -3 : 0;
+	}
+
+	double seconds[NB_STAGES];
+	size_t calls[NB_STAGES];
+	size_t packetsRead, packetsDecoded, framesKept, bytesAllocated;
+
+private:
+	struct Event
+	{
+		Stage stage;
+		double start, duration;
+	};
+	// about 24 MB of events, the rest of a longer trace is not recorded
+	static const size_t maxEvents = 1 << 20;
+
+	char* tracePath;
+	double traceStart;
+	vector<Event> events;
+};
+
+CaptureStats captureStats;
+
+// decoded video frames, kept across calls so that analysing the same video again
+// (with other tracking options) decodes every frame once
+struct FrameKey
+{
+	string filename;
+	time_t mtime;
+	off_t size;
+	unsigned int stream, frameNr;
+	// the output format: the frame size and bytes per pixel
+	int width, height, channels;
+
+	bool operator<(const FrameKey &k) const
+	{
+		if (filename != k.filename) return filename < k.filename;
+		if (mtime != k.mtime) return mtime < k.mtime;
+		if (size != k.size) return size < k.size;
+		if (stream != k.stream) return stream < k.stream;
+		if (frameNr != k.frameNr) return frameNr < k.frameNr;
+		if (width != k.width) return width < k.width;
+		if (height != k.height) return height < k.height;
+		return channels < k.channels;
+	}
+};
+
+class FrameCache
+{
+public:
+	FrameCache()
+	{
+		budget = 0;
+		used = 0;
+		hits = misses = evictions = 0;
+	}
+
+	// in bytes, 0 disables the cache; the least recently used frames are evicted above it
+	void setBudget(size_t budget)
+	{
+		this->budget = budget;
+		evict();
+		hits = misses = evictions = 0;
+	}
+	bool enabled() const { return budget > 0; }
+
+	// a copy of the frame (to be freed by the caller), false when it is not cached
+	bool get(const FrameKey &key, uint8_t** data, unsigned int* nrBytes, double* time)
+	{
+		map<FrameKey,list<Entry>::iterator>::iterator i = index.find(key);
+		if (i == index.end())
+		{
+			misses++;
+			return false;
+		}
+
+		uint8_t* tmp = (uint8_t*)malloc(i->second->data.size());
+		if (!tmp) return false;
+		captureStats.bytesAllocated += i->second->data.size();
+		memcpy(tmp, &i->second->data[0], i->second->data.size());
+
+		*data = tmp;
+		*nrBytes = i->second->data.size();
+		*time = i->second->time;
+		// most recently used first
+		entries.splice(entries.begin(), entries, i->second);
+		hits++;
+		return true;
+	}
+
+	void put(const FrameKey &key, const uint8_t* data, unsigned int nrBytes, double time)
+	{
+		if (nrBytes == 0 || nrBytes > budget || index.count(key)) return;
+
+		entries.push_front(Entry());
+		entries.front().key = key;
+		entries.front().data.assign(data, data+nrBytes);
+		captureStats.bytesAllocated += nrBytes;
+		entries.front().time = time;
+		index[key] = entries.begin();
+		used += nrBytes;
+		evict();
+	}
+
+	void getStats(double* hits, double* misses, double* nrFrames, double* bytes, double* evictions) const
+	{
+		*hits = this->hits;
+		*misses = this->misses;
+		*nrFrames = index.size();
+		*bytes = used;
+		*evictions = this->evictions;
+	}
+
+private:
+	struct Entry
+	{
+		FrameKey key;
+		vector<uint8_t> data;
+		double time;
+	};
+
+	void evict()
+	{
+		while (used > budget && !entries.empty())
+		{
+			used -= entries.back().data.size();
+			index.erase(entries.back().key);
+			entries.pop_back();
+			evictions++;
+		}
+	}
+
+	size_t budget, used;
+	size_t hits, misses, evictions;
+	list<Entry> entries;
+	map<FrameKey,list<Entry>::iterator> index;
+};
+
+FrameCache frameCache;
+
+// decoded frames of one video stream in a file, for videos too large to cache in memory:
+// a header, the frames one after the other (64 byte aligned) and a table of their number,
+// time and offset.  The frames may be cropped to a ROI and reduced to their first channel
+// (all the trackers use), or downscaled for a proxy.  A store is only used while the size
+// and modification time of the video match the ones it was written from.  Values are in the byte order of the
+// machine (little endian on all the platforms Matlab runs on).
+struct StoreHeader
+{
+	char magic[8];
+	uint32_t version;
+	// STORE_COMPLETE when it holds every frame of the video
+	uint32_t flags;
+	int64_t sourceSize, sourceMtime;
+	uint32_t width, height, channels;
+	// the ROI in the decoded frames (0-based), a zero width for the whole frame
+	int32_t roi[4];
+	uint32_t nrFrames;
+	// 0 until the store is completely written
+	uint64_t tableOffset;
+	// the frames are downscaled by scale
+	uint32_t scale;
+	// number of frames of the video, 0 while it is not known
+	uint32_t videoFrames;
+};
+
+struct StoreEntry
+{
+	uint32_t frameNr, nrBytes;
+	double time;
+	uint64_t offset;
+};
+
+enum {STORE_COMPLETE=1};
+
+class FrameStore
+{
+public:
+	FrameStore()
+	{
+		memset(&header, 0, sizeof(header));
+	}
+
+	// 0 when the store at path was written from the source with the same ROI, channels and
+	// scale, -3 when there is none or it is out of date, -4 when it is not a store
+	int open(const char* path, const struct stat &source, const int* roi, int channels, int scale)
+	{
+		close();
+		if (file.open(path)) return -3;
+
+		const StoreHeader* h = (const StoreHeader*)file.begin();
+		if (file.size() < sizeof(StoreHeader) || memcmp(h->magic, "VTFRAMES", 8) || h->version != 1 || !h->tableOffset || h->tableOffset + (uint64_t)h->nrFrames*sizeof(StoreEntry) > file.size())
+		{
+			close();
+			return -4;
+		}
+		if (h->sourceSize != (int64_t)source.st_size || h->sourceMtime != (int64_t)source.st_mtime || (int)h->channels != channels || memcmp(h->roi, roi, sizeof(h->roi)) || (int)h->scale != scale)
+		{
+			close();
+			return -3;
+		}
+
+		header = *h;
+		const StoreEntry* table = (const StoreEntry*)(file.begin() + h->tableOffset);
+		for (uint32_t k=0; k<h->nrFrames; k++)
+		{
+			if (table[k].offset + table[k].nrBytes > h->tableOffset)
+			{
+				close();
+				return -4;
+			}
+			entries[table[k].frameNr] = table[k];
+		}
+
+		return 0;
+	}
+
+	void close()
+	{
+		file.close();
+		memset(&header, 0, sizeof(header));
+		entries.clear();
+	}
+
+	bool isOpen() const { return file.isOpen(); }
+	bool complete() const { return isOpen() && (header.flags & STORE_COMPLETE); }
+	const StoreHeader& getHeader() const { return header; }
+	const map<unsigned int,StoreEntry>& getEntries() const { return entries; }
+	const uint8_t* frameData(const StoreEntry &e) const { return (const uint8_t*)file.begin() + e.offset; }
+
+	// replaces the store at path by one with its frames and the new ones (in the format and
+	// with the flags of the header); the new frames are given by number, sorted
+	int update(const char* path, const StoreHeader &format, const vector<StoreEntry> &frames, const vector<const uint8_t*> &data)
+	{
+		vector<StoreEntry> table;
+		vector<const uint8_t*> tableData;
+		map<unsigned int,StoreEntry>::const_iterator old = entries.begin();
+		for (size_t k=0; k<=frames.size(); k++)
+		{
+			for (; old != entries.end() && (k == frames.size() || old->first < frames[k].frameNr); old++)
+			{
+				table.push_back(old->second);
+				tableData.push_back(frameData(old->second));
+			}
+			if (k == frames.size()) break;
+			if (old != entries.end() && old->first == frames[k].frameNr) old++;
+			table.push_back(frames[k]);
+			tableData.push_back(data[k]);
+		}
+
+		string tmpPath = string(path) + ".tmp";
+		FILE* f = fopen(tmpPath.c_str(), "wb");
+		if (!f) return -3;
+
+		StoreHeader h = format;
+		memcpy(h.magic, "VTFRAMES", 8);
+		h.version = 1;
+		h.nrFrames = table.size();
+		h.tableOffset = 0;
+
+		static const uint8_t zeros[64] = {0};
+		uint64_t offset = sizeof(h);
+		bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+		for (size_t k=0; k<table.size() && ok; k++)
+		{
+			size_t pad = (64 - offset%64)%64;
+			ok = fwrite(zeros, 1, pad, f) == pad;
+			offset += pad;
+
+			ok = ok && fwrite(tableData[k], 1, table[k].nrBytes, f) == table[k].nrBytes;
+			table[k].offset = offset;
+			offset += table[k].nrBytes;
+		}
+		// the table last, and its offset once everything before is written
+		h.tableOffset = offset;
+		ok = ok && (table.empty() || fwrite(&table[0], sizeof(StoreEntry), table.size(), f) == table.size());
+		ok = ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, f) == 1;
+		ok = (fclose(f) == 0) && ok;
+
+		// the old store can't be replaced while it is mapped (on Windows)
+		close();
+		if (ok)
+		{
+			remove(path);
+			ok = rename(tmpPath.c_str(), path) == 0;
+		}
+		if (!ok)
+		{
+			remove(tmpPath.c_str());
+			return -3;
+		}
+		return 0;
+	}
+
+private:
+	MappedFile file;
+	StoreHeader header;
+	map<unsigned int,StoreEntry> entries;
+};
+
+// the statistics of every decoded video frame, computed by Grab while the frame is still in
+// the cache, whether it is kept or not.  One column of values per frame, in this order:
+//   mean       of each channel (3)
+//   variance   of each channel, normalized by the number of pixels (3)
+//   histogram  of each channel, one channel after the other (3 x histogramBins)
+//   thumbnail  the means of thumbWidth x thumbHeight blocks, RGB interleaved by rows as the
+//              frames (3 x thumbWidth x thumbHeight)
+//   sad        the sum of the absolute differences of the ROI with the previous frame decoded
+//              in the same capture, NaN for the first one (1)
+enum {STATS_MEAN = 1, STATS_VARIANCE = 2, STATS_HISTOGRAM = 4, STATS_THUMBNAIL = 8, STATS_SAD = 16};
+const char* statsNames[] = {"mean", "variance", "histogram", "thumbnail", "sad"};
+#define NB_STATS 5
+
+struct FrameStatsOptions
+{
+	// STATS_* flags, 0 for none
+	int which;
+	int histogramBins;
+	int thumbWidth, thumbHeight;
+	// as imcrop, the whole frame when the width or height is not positive
+	double roi[4];
+	// otherwise the frames are only decoded for their statistics
+	bool keepFrames;
+};
+
+class FrameStats
+{
+public:
+	FrameStats()
+	{
+		memset(&options, 0, sizeof(options));
+	}
+
+	void setOptions(const FrameStatsOptions &options)
+	{
+		this->options = options;
+		clear();
+	}
+
+	unsigned int nbValues() const
+	{
+		unsigned int n = 0;
+		if (options.which & STATS_MEAN) n += 3;
+		if (options.which & STATS_VARIANCE) n += 3;
+		if (options.which & STATS_HISTOGRAM) n += 3*options.histogramBins;
+		if (options.which & STATS_THUMBNAIL) n += 3*options.thumbWidth*options.thumbHeight;
+		if (options.which & STATS_SAD) n += 1;
+		return n;
+	}
+
+	void clear()
+	{
+		values.clear();
+		frameNrs.clear();
+		times.clear();
+		blockOfColumn.clear();
+		previous.clear();
+	}
+
+	void add(const uint8_t* data, int width, int height, unsigned int frameNr, double time)
+	{
+		int which = options.which;
+		int bins = options.histogramBins, tw = options.thumbWidth, th = options.thumbHeight;
+
+		uint64_t sums[3] = {0,0,0}, squares[3] = {0,0,0};
+		hist.assign(3*bins, 0);
+		blocks.assign(3*tw*th, 0);
+		if (which & STATS_THUMBNAIL && blockOfColumn.size() != (size_t)width)
+		{
+			blockOfColumn.resize(width);
+			for (int x=0; x<width; x++) blockOfColumn[x] = 3*(int)((int64_t)x*tw/width);
+		}
+
+		// one pass over the frame for all but the ROI difference
+		if (which & (STATS_MEAN|STATS_VARIANCE|STATS_HISTOGRAM|STATS_THUMBNAIL))
+		{
+			for (int y=0; y<height; y++)
+			{
+				const uint8_t* p = data + (size_t)y*width*3;
+				uint32_t rowSums[3] = {0,0,0};
+				uint64_t rowSquares[3] = {0,0,0};
+				uint64_t* block = &blocks[(size_t)3*tw*((int64_t)y*th/height)];
+				for (int x=0; x<width; x++, p+=3)
+				{
+					for (int c=0; c<3; c++)
+					{
+						unsigned int v = p[c];
+						rowSums[c] += v;
+						rowSquares[c] += v*v;
+						hist[c*bins + ((v*bins) >> 8)]++;
+					}
+					if (which & STATS_THUMBNAIL)
+					{
+						uint64_t* b = block + blockOfColumn[x];
+						b[0] += p[0];
+						b[1] += p[1];
+						b[2] += p[2];
+					}
+				}
+				for (int c=0; c<3; c++)
+				{
+					sums[c] += rowSums[c];
+					squares[c] += rowSquares[c];
+				}
+			}
+		}
+
+		double n = (double)width*height;
+		if (which & STATS_MEAN)
+		{
+			for (int c=0; c<3; c++) values.push_back(sums[c]/n);
+		}
+		if (which & STATS_VARIANCE)
+		{
+			for (int c=0; c<3; c++) values.push_back(squares[c]/n - (sums[c]/n)*(sums[c]/n));
+		}
+		if (which & STATS_HISTOGRAM)
+		{
+			for (int k=0; k<3*bins; k++) values.push_back(hist[k]);
+		}
+		if (which & STATS_THUMBNAIL)
+		{
+			for (int by=0; by<th; by++)
+			{
+				// the pixels of the block, from the same rounding as the loop above
+				int rows = (int)(((int64_t)(by+1)*height + th-1)/th - ((int64_t)by*height + th-1)/th);
+				for (int bx=0; bx<tw; bx++)
+				{
+					int columns = (int)(((int64_t)(bx+1)*width + tw-1)/tw - ((int64_t)bx*width + tw-1)/tw);
+					double count = max((double)rows*columns, 1.0);
+					for (int c=0; c<3; c++) values.push_back(blocks[3*(by*tw+bx)+c]/count);
+				}
+			}
+		}
+		if (which & STATS_SAD) values.push_back(sad(data, width, height));
+
+		frameNrs.push_back(frameNr);
+		times.push_back(time);
+	}
+
+	FrameStatsOptions options;
+	// nbValues() x number of frames
+	vector<float> values;
+	vector<unsigned int> frameNrs;
+	vector<double> times;
+
+private:
+	// the ROI clipped to the frame, as for the frame store
+	double sad(const uint8_t* data, int width, int height)
+	{
+		int x0 = 0, y0 = 0, w = width, h = height;
+		if (options.roi[2] > 0 && options.roi[3] > 0)
+		{
+			x0 = min(max((int)floor(options.roi[0]+0.5),1),width)-1;
+			y0 = min(max((int)floor(options.roi[1]+0.5),1),height)-1;
+			w = min((int)floor(options.roi[2]+0.5),width-x0);
+			h = min((int)floor(options.roi[3]+0.5),height-y0);
+		}
+
+		size_t lineBytes = (size_t)w*3;
+		bool first = previous.size() != lineBytes*h;
+		previous.resize(lineBytes*h);
+		uint64_t total = 0;
+		for (int y=0; y<h; y++)
+		{
+			const uint8_t* line = data + ((size_t)(y+y0)*width + x0)*3;
+			uint8_t* last = &previous[y*lineBytes];
+			uint32_t rowTotal = 0;
+			for (size_t i=0; i<lineBytes; i++) rowTotal += abs((int)line[i] - (int)last[i]);
+			total += rowTotal;
+			memcpy(last, line, lineBytes);
+		}
+		return first ? NAN : (double)total;
+	}
+
+	vector<uint32_t> hist;
+	vector<uint64_t> blocks;
+	vector<int> blockOfColumn;
+	// the ROI of the last frame
+	vector<uint8_t> previous;
+};
+
 class Grabber
 {
 public:
@@ -87,6 +648,11 @@ public:
 		this->info = info;
 		this->trySeeking = trySeeking;
 		this->start_time = start_time>0?start_time:0;
+		dropped = false;
+		lastTime = -HUGE_VAL;
+		stats = NULL;
+		pending = NULL;
+		persistent = false;
 	};
 
 	~Grabber()
@@ -94,6 +660,67 @@ public:
 		// clean up any remaining memory...
 		if (DEBUG) FFprintf("freeing frame data...\n");
 		for (vector<uint8_t*>::iterator i=frames.begin();i != frames.end(); i++) free(*i);
+		free(pending);
+	}
+
+	void dropPending()
+	{
+		free(pending);
+		pending = NULL;
+	}
+
+	// a capture that goes on from the last one starts with its pending frame, true when it was kept
+	bool servePending()
+	{
+		if (!pending || done) return false;
+
+		if (stats)
+		{
+			double start = CaptureStats::now();
+			stats->add(pending, info.video.width, info.video.height, pendingNr, pendingTime);
+			captureStats.add(STAGE_STATS, start);
+		}
+
+		bool keep;
+		if (stopTime)
+		{
+			// still past the stop time, it waits for the next capture
+			done = stopTime <= pendingTime;
+			if (done)
+			{
+				pendingStop = stopTime;
+				return false;
+			}
+			keep = startTime <= pendingTime;
+		} else {
+			keep = find(frameNrs.begin(), frameNrs.end(), pendingNr) != frameNrs.end();
+			done = keep && pendingNr >= *max_element(frameNrs.begin(), frameNrs.end());
+		}
+
+		uint8_t* videobuf = pending;
+		pending = NULL;
+		if (!keep || (stats && !stats->options.keepFrames))
+		{
+			free(videobuf);
+			return false;
+		}
+		frames.push_back(videobuf);
+		frameBytes.push_back(bytesPerWORD);
+		frameTimes.push_back(pendingTime);
+		frameIndex.push_back(pendingNr);
+		captureStats.framesKept++;
+		return true;
+	}
+
+	// before the next capture of the same session
+	void clearFrames()
+	{
+		for (vector<uint8_t*>::iterator i=frames.begin();i != frames.end(); i++) free(*i);
+		frames.clear();
+		frameBytes.clear();
+		frameTimes.clear();
+		frameIndex.clear();
+		done = false;
 	}
 
 	AVbinStream* stream;
@@ -103,12 +730,28 @@ public:
 	vector<uint8_t*> frames;
 	vector<unsigned int> frameBytes;
 	vector<double> frameTimes;
+	// number of every captured video frame
+	vector<unsigned int> frameIndex;
 
 	vector<unsigned int> frameNrs;
 
 	unsigned int frameNr;
 	unsigned int packetNr;
 	bool done;
+	// a packet was read but not decoded after done, the decoder can't go on from there
+	bool dropped;
+	// time stamp of the last packet read
+	double lastTime;
+	// of the decoded video frames, NULL for none
+	FrameStats* stats;
+	// the video frame decoded past the stop time of the last capture (NULL for none), with its
+	// time, number and that stop time: the next capture can go on from it without a rewind
+	uint8_t* pending;
+	double pendingTime, pendingStop;
+	unsigned int pendingNr;
+	// the session goes on after the capture (see FFGrabber::setPersistent): the packet that ends
+	// it is decoded too, otherwise it is dropped
+	bool persistent;
 	bool isAudio;
 	bool trySeeking;
 
@@ -118,7 +761,11 @@ public:
 
 	int Grab(AVbinPacket* packet)
 	{
-		if (done) return 0;
+		if (done)
+		{
+			dropped = true;
+			return 0;
+		}
 		if (!packet->data) return 1;
 
 		frameNr++;
@@ -127,6 +774,7 @@ public:
 		int offset=0, len=0;
 		double timestamp = (packet->timestamp-start_time)/1000.0/1000.0;
 		if (DEBUG) FFprintf("time %lld %lld %lf\n",packet->timestamp,start_time,timestamp);
+		lastTime = timestamp;
 
 		// either no frames are specified (capture all), or we have time specified
 		if (stopTime)
@@ -163,6 +811,7 @@ public:
 			int uint8_tsread;
 			uint8_t* audiodata = audiobuf;
 			if (DEBUG) FFprintf("avbin_decode_audio\n");
+			double start = CaptureStats::now();
 			while ((uint8_tsread = avbin_decode_audio(stream, packet->data, packet->size, audiodata, &uint8_tsout)) > 0)
 			{
 				packet->data += uint8_tsread;
@@ -171,6 +820,8 @@ public:
 				uint8_tsleft -= uint8_tsout;
 				uint8_tsout = uint8_tsleft;
 			}
+			captureStats.add(STAGE_DECODE, start);
+			captureStats.packetsDecoded++;
 
 			int nrBytes = audiodata-audiobuf;
 			len = min(len,nrBytes);
@@ -178,21 +829,25 @@ public:
 
 			uint8_t* tmp = (uint8_t*)malloc(len);
 			if (!tmp) return 2;
+			captureStats.bytesAllocated += len;
 
+			start = CaptureStats::now();
 			memcpy(tmp,audiobuf+offset,len);
+			captureStats.add(STAGE_COPY, start);
 
 			frames.push_back(tmp);
 			frameBytes.push_back(len);
 			frameTimes.push_back(timestamp);
+			captureStats.framesKept++;
 
 		} else {
 			bool skip = false;
+			unsigned int lastFrameNr = 0;
 			if (frameNrs.size() > 0)
 			{
 				//frames are being specified
 				// check to see if the frame is in our list
 				bool foundNr = false;
-				unsigned int lastFrameNr = 0;
 				for (int i=0;i<frameNrs.size();i++)
 				{
 					if (frameNrs.at(i) == frameNr) foundNr = true;
@@ -205,14 +860,20 @@ public:
 					skip = true;
 				}
 			}
-			if ((trySeeking && skip && packetNr < startDecodingAt && packetNr != 1) || done ) return 0;
+			// the packet that ends the capture is still decoded, so that a persistent session can go on from the next one
+			if ((trySeeking && skip && packetNr < startDecodingAt && packetNr != 1) || (done && !persistent)) return 0;
 
 			if (DEBUG) FFprintf("allocate frame %d\n",frames.size());
 			uint8_t* videobuf = (uint8_t*)malloc(bytesPerWORD);
 			if (!videobuf) return 2;
+			captureStats.bytesAllocated += bytesPerWORD;
 			if (DEBUG) FFprintf("avbin_decode_video\n");
 
-			if (avbin_decode_video(stream, packet->data, packet->size,videobuf)<=0)
+			double start = CaptureStats::now();
+			int decoded = avbin_decode_video(stream, packet->data, packet->size,videobuf);
+			captureStats.add(STAGE_DECODE, start);
+			captureStats.packetsDecoded++;
+			if (decoded<=0)
 			{
 				if (DEBUG) FFprintf("avbin_decode_video FAILED!!!\n");
 				// silently ignore decode errors
@@ -226,7 +887,23 @@ public:
 				keyframes[packetNr] = timestamp;
 			}
 
-			if (skip || len==0)
+			if (stats)
+			{
+				start = CaptureStats::now();
+				stats->add(videobuf, info.video.width, info.video.height, frameNr, timestamp);
+				captureStats.add(STAGE_STATS, start);
+			}
+
+			if (done && stopTime)
+			{
+				dropPending();
+				pending = videobuf;
+				pendingTime = timestamp;
+				pendingStop = stopTime;
+				pendingNr = frameNr;
+				return 0;
+			}
+			if (skip || len==0 || done || (stats && !stats->options.keepFrames))
 			{
 				free(videobuf);
 				return 0;
@@ -234,6 +911,11 @@ public:
 			frames.push_back(videobuf);
 			frameBytes.push_back(min(len,bytesPerWORD));
 			frameTimes.push_back(timestamp);
+			frameIndex.push_back(frameNr);
+			captureStats.framesKept++;
+
+			// no need to read past the last frame asked for
+			if (frameNrs.size() > 0 && frameNr >= lastFrameNr) done = true;
 		}
 
 		return 0;
@@ -242,6 +924,76 @@ public:
 
 typedef map<int,Grabber*> streammap;
 
+// the frames of a video stream as the packets give them, without decoding: in presentation
+// order, the time stamp, whether it is a keyframe and the byte offset of the packet in the
+// file (-1 when the container does not give it)
+struct ProbeIndex
+{
+	vector<double> times;
+	vector<bool> keyframes;
+	vector<int64_t> offsets;
+};
+
+// called with every video frame as soon as it is decoded, the frame is freed afterwards
+typedef void (*FrameCallback)(void* user, const uint8_t* data, unsigned int nrBytes, int width, int height, double time, unsigned int frameNr);
+
+// the mean of every scale x scale block of an RGB24 frame, those of the last row and column
+// over the pixels left; dst is (width+scale-1)/scale x (height+scale-1)/scale
+static void downscale(const uint8_t* src, int width, int height, int scale, uint8_t* dst)
+{
+	int w = (width+scale-1)/scale, h = (height+scale-1)/scale;
+	vector<uint32_t> sums((size_t)w*3);
+	for (int by=0; by<h; by++)
+	{
+		fill(sums.begin(), sums.end(), 0);
+		int y0 = by*scale, y1 = min(y0+scale,height);
+		for (int y=y0; y<y1; y++)
+		{
+			const uint8_t* p = src + (size_t)y*width*3;
+			for (int x=0; x<width; x++, p+=3)
+			{
+				uint32_t* s = &sums[(x/scale)*3];
+				s[0] += p[0];
+				s[1] += p[1];
+				s[2] += p[2];
+			}
+		}
+		uint8_t* out = dst + (size_t)by*w*3;
+		for (int bx=0; bx<w; bx++)
+		{
+			uint32_t count = (min((bx+1)*scale,width) - bx*scale)*(y1-y0);
+			for (int c=0; c<3; c++) out[3*bx+c] = (sums[3*bx+c] + count/2)/count;
+		}
+	}
+}
+
+// the frames of a proxy as they are decoded, downscaled
+struct ProxyFrames
+{
+	int scale;
+	vector<StoreEntry> entries;
+	vector<const uint8_t*> data;
+};
+
+static void addProxyFrame(void* user, const uint8_t* data, unsigned int /*nrBytes*/, int width, int height, double time, unsigned int frameNr)
+{
+	ProxyFrames* P = (ProxyFrames*)user;
+	StoreEntry e;
+	e.frameNr = frameNr;
+	e.nrBytes = ((width+P->scale-1)/P->scale)*((height+P->scale-1)/P->scale)*3;
+	e.time = time;
+	e.offset = 0;
+
+	uint8_t* dst = (uint8_t*)malloc(e.nrBytes);
+	if (!dst) return;
+	captureStats.bytesAllocated += e.nrBytes;
+	double start = CaptureStats::now();
+	downscale(data, width, height, P->scale, dst);
+	captureStats.add(STAGE_CONVERT, start);
+	P->entries.push_back(e);
+	P->data.push_back(dst);
+}
+
 class FFGrabber
 {
 public:
@@ -255,19 +1007,69 @@ public:
 	void getCaptureInfo(int* nrVideo, int* nrAudio);
 	// data must be freed by caller
 	int getVideoFrame(unsigned int id, unsigned int frameNr, uint8_t** data, unsigned int* nrBytes, double* time);
+	// a frame of the last capture that was read from the frame store: data points into the mapping
+	// of the store and is valid until the next capture, -2 when the frame was decoded
+	int getStoredFrame(unsigned int id, unsigned int frameNr, const uint8_t** data, unsigned int* nrBytes, double* time);
 	// data must be freed by caller
 	int getAudioFrame(unsigned int id, unsigned int frameNr, uint8_t** data, unsigned int* nrBytes, double* time);
 	void setFrames(unsigned int* frameNrs, int nrFrames);
 	void setTime(double startTime, double stopTime);
+	// follow a file that is still being written: at the end of the file doCapture waits for it to
+	// grow, checking every interval seconds, and stops after timeout seconds without new data
+	void setFollow(double timeout, double interval);
+	void setFrameCallback(FrameCallback callback, void* user);
+	// scans the packets of a video stream (once per file, the index is kept until the file
+	// changes); getVideoInfo then gives the exact number of frames
+	int probe(unsigned int id, const ProbeIndex** index);
+	// the number (from 1, in presentation order) of the frame shown at time, 0 before the
+	// first frame; a binary search of the probe index
+	int frameAtTime(unsigned int id, double time, unsigned int* frameNr);
+	// keep the decoded frames of the first video stream in a file (see FrameStore), optionally
+	// cropped to roi (xmin ymin width height, as imcrop) and reduced to their first channel;
+	// NULL to stop
+	void setFrameStore(const char* path, const double* roi, bool firstChannel);
+	// the statistics of every frame decoded by the next captures (see FrameStats), NULL to stop;
+	// the frames asked for are then always decoded, the cache and the frame store are not used
+	int setFrameStats(const FrameStatsOptions* options);
+	// of the last capture, until the next one
+	int getFrameStats(unsigned int id, const FrameStats** stats);
+	// a copy of frames of the first video stream downscaled by scale (see downscale), kept next
+	// to the video in <filename>.<scale>.proxy (a FrameStore, by the frame numbers of the video)
+	// for the next calls: only the frames it does not hold yet, and not past the end of the video
+	// once it is known, are decoded; nrFrames 0 for all of them.
+	// Pixel x of the proxy is (x-0.5)*scale+0.5 in the frames, from 1 as imcrop.
+	int buildProxy(int scale, const unsigned int* frameNrs, int nrFrames);
+	// the proxy of the last buildProxy
+	const FrameStore& getProxy() const { return proxy; }
+	// every frame of the video through callback, once (as the keyframe detector of
+	// Keyframes.h needs); the frame statistics are not computed, so that the frames are not
+	// freed before the callback sees them
+	int scanFrames(FrameCallback callback, void* user);
 	void disableVideo();
 	void disableAudio();
+	// a persistent session keeps the file and the decoders open after cleanUp: building the same
+	// unchanged file again reuses them and a capture that starts after the last one goes on from there
+	void setPersistent(bool persistent);
 	void cleanUp(); // must be called at the end, in order to render anything afterward.
+	void close(); // closes the file, also of a persistent session
 
 #ifdef MATLAB_MEX_FILE
 	void setMatlabCommand(char * matlabCommand);
 	void runMatlabCommand(Grabber* G);
 #endif
 private:
+	void runFrameCallback(Grabber* G);
+	bool waitForData();
+	bool canResume();
+	void rewind();
+	FrameKey frameKey(unsigned int id, unsigned int frameNr);
+	void storeFormat(StoreHeader &format);
+	bool readStore();
+	void writeStore();
+	void findStartDecoding(unsigned int minFrame);
+	int readPacket(AVbinPacket* packet);
+	void endCapture(double start);
+
 	streammap streams;
 	vector<Grabber*> videos;
 	vector<Grabber*> audios;
@@ -283,6 +1085,34 @@ private:
 	char* filename;
 	struct stat filestat;
 
+	bool persistent, videoDisabled, audioDisabled;
+	// a capture was done since the file was opened, it read to the end of the file,
+	// it seeked (the frame numbers are no longer counted from the start)
+	bool captured, atEnd, seeked;
+
+	double followTimeout, followInterval;
+	off_t followSize;
+	FrameCallback frameCallback;
+	void* frameCallbackUser;
+
+	char* storePath;
+	double storeRoi[4];
+	bool storeFirstChannel;
+	FrameStore store;
+	// the frames of the last capture of the first video stream are in the format of the store
+	bool storeUsed;
+	StoreHeader storedFormat;
+	// the frames of the last capture when it was read from the store (NULL in the Grabber)
+	vector<StoreEntry> storedFrames;
+
+	// by video stream id
+	map<unsigned int,ProbeIndex> probes;
+
+	FrameStatsOptions statsOptions;
+	// by video stream id, kept after cleanUp
+	vector<FrameStats> frameStats;
+
+	FrameStore proxy;
 
 #ifdef MATLAB_MEX_FILE
 	char* matlabCommand;
@@ -297,6 +1127,18 @@ FFGrabber::FFGrabber()
 	tryseeking = true;
 	file = NULL;
 	filename = NULL;
+	persistent = false;
+	videoDisabled = audioDisabled = false;
+	captured = atEnd = seeked = false;
+	followTimeout = 0;
+	followInterval = 0.5;
+	followSize = 0;
+	frameCallback = NULL;
+	frameCallbackUser = NULL;
+	storePath = NULL;
+	storeFirstChannel = false;
+	storeUsed = false;
+	memset(&statsOptions, 0, sizeof(statsOptions));
 
 	if (DEBUG) FFprintf("avbin_init\n");
  	if (avbin_init()) FFprintf("avbin_init init failed!!!\n");
@@ -304,10 +1146,34 @@ FFGrabber::FFGrabber()
 	av_log_set_level(AV_LOG_QUIET);
 }
 
+void FFGrabber::setPersistent(bool persistent)
+{
+	this->persistent = persistent;
+}
+
 void FFGrabber::cleanUp()
 {
 	if (!file) return; // nothing to cleanup.
 
+	if (!persistent)
+	{
+		close();
+		return;
+	}
+
+	for (streammap::iterator i = streams.begin(); i != streams.end(); i++) i->second->clearFrames();
+	storedFrames.clear();
+
+#ifdef MATLAB_MEX_FILE
+	if (matlabCommand) free(matlabCommand);
+	matlabCommand = NULL;
+#endif
+}
+
+void FFGrabber::close()
+{
+	if (!file) return;
+
 	for (streammap::iterator i = streams.begin(); i != streams.end(); i++)
 	{
 		avbin_close_stream(i->second->stream);
@@ -320,6 +1186,7 @@ void FFGrabber::cleanUp()
 
  	avbin_close_file(file);
  	file = NULL;
+	storedFrames.clear();
 
 #ifdef MATLAB_MEX_FILE
 	if (matlabCommand) free(matlabCommand);
@@ -338,12 +1205,21 @@ int FFGrabber::getVideoInfo(unsigned int id, int* width, int* height, double* ra
 
 	*width  = CB->info.video.width;
 	*height = CB->info.video.height;
+	if (id == 0 && storeUsed)
+	{
+		*width = storedFormat.width;
+		*height = storedFormat.height;
+	}
 	*rate = CB->rate;
 	*nrFramesCaptured = CB->frames.size();
 	*nrFramesTotal = CB->frameNr;
 
 	*totalDuration = fileinfo.duration/1000.0/1000.0;
+	// the duration read when the file was opened is out of date when following it
+	if (followTimeout > 0 && !CB->frameTimes.empty()) *totalDuration = max(*totalDuration, CB->frameTimes.back());
 	if (stopForced) *nrFramesTotal = (int)(-(*rate)*(*totalDuration));
+	map<unsigned int,ProbeIndex>::const_iterator p = probes.find(id);
+	if (p != probes.end()) *nrFramesTotal = p->second.times.size();
 
 	return 0;
 }
@@ -377,125 +1253,588 @@ void FFGrabber::getCaptureInfo(int* nrVideo, int* nrAudio)
 	*nrAudio = audios.size();
 }
 
-// data must be freed by caller
-int FFGrabber::getVideoFrame(unsigned int id, unsigned int frameNr, uint8_t** data, unsigned int* nrBytes, double* time)
+// data must be freed by caller
+int FFGrabber::getVideoFrame(unsigned int id, unsigned int frameNr, uint8_t** data, unsigned int* nrBytes, double* time)
+{
+	if (DEBUG) FFprintf("getting Video frame %d\n",frameNr);
+
+	if (!data || !nrBytes) return -1;
+
+	if (id >= videos.size()) return -2;
+	Grabber* CB = videos[id];
+	if (!CB) return -1;
+	// nothing decoded, and no frames from the cache either
+	if (CB->frameNr == 0 && CB->frames.empty()) return -2;
+	if (frameNr < 0 || frameNr >= CB->frames.size()) return -2;
+
+	uint8_t* tmp = CB->frames[frameNr];
+	// a frame of the store is copied out of the mapping
+	if (!tmp && id == 0 && frameNr < storedFrames.size())
+	{
+		tmp = (uint8_t*)malloc(storedFrames[frameNr].nrBytes);
+		if (!tmp) return -2;
+		memcpy(tmp, store.frameData(storedFrames[frameNr]), storedFrames[frameNr].nrBytes);
+	}
+	if (!tmp) return -2;
+
+	*nrBytes = CB->frameBytes[frameNr];
+	*time = CB->frameTimes[frameNr];
+
+	*data = tmp;
+	CB->frames[frameNr] = NULL;
+
+	return 0;
+}
+
+int FFGrabber::getStoredFrame(unsigned int id, unsigned int frameNr, const uint8_t** data, unsigned int* nrBytes, double* time)
+{
+	if (!data || !nrBytes || !time) return -1;
+	if (id >= videos.size() || id != 0 || frameNr >= storedFrames.size()) return -2;
+
+	*data = store.frameData(storedFrames[frameNr]);
+	*nrBytes = storedFrames[frameNr].nrBytes;
+	*time = storedFrames[frameNr].time;
+
+	return 0;
+}
+
+// data must be freed by caller
+int FFGrabber::getAudioFrame(unsigned int id, unsigned int frameNr, uint8_t** data, unsigned int* nrBytes, double* time)
+{
+	if (!data || !nrBytes) return -1;
+
+	if (id >= audios.size()) return -2;
+	Grabber* CB = audios[id];
+	if (!CB) return -1;
+	if (CB->frameNr == 0) return -2;
+	if (frameNr < 0 || frameNr >= CB->frames.size()) return -2;
+
+	uint8_t* tmp = CB->frames[frameNr];
+	if (!tmp) return -2;
+
+	*nrBytes = CB->frameBytes[frameNr];
+	*time = CB->frameTimes[frameNr];
+
+	*data = tmp;
+	CB->frames[frameNr] = NULL;
+
+	return 0;
+}
+
+void FFGrabber::setFrames(unsigned int* frameNrs, int nrFrames)
+{
+	if (!frameNrs) return;
+
+	unsigned int minFrame=nrFrames>0?frameNrs[0]:0;
+
+	this->frameNrs.clear();
+	for (int i=0; i<nrFrames; i++) this->frameNrs.push_back(frameNrs[i]);
+
+	for (int j=0; j < videos.size(); j++)
+	{
+		Grabber* CB = videos.at(j);
+		if (CB)
+		{
+			CB->clearFrames();
+			CB->frameNrs.clear();
+			for (int i=0; i<nrFrames; i++)
+			{
+				CB->frameNrs.push_back(frameNrs[i]);
+				minFrame=frameNrs[i]<minFrame?frameNrs[i]:minFrame;
+			}
+			CB->startTime = 0;
+			CB->stopTime = 0;
+		}
+	}
+	startTime = 0;
+	stopTime = 0;
+
+	for (int j=0; j < audios.size(); j++)
+	{
+		Grabber* CB = audios.at(j);
+		if (CB)
+		{
+			CB->clearFrames();
+			CB->startTime = 0;
+			CB->stopTime = 0;
+		}
+	}
+
+	if (tryseeking && nrFrames > 0) findStartDecoding(minFrame);
+
+
+	// the meaning of frames doesn't make much sense for audio...
+}
+
+// the last keyframe known before minFrame
+void FFGrabber::findStartDecoding(unsigned int minFrame)
+{
+	startDecodingAt = 0;
+	for (map<unsigned int,double>::const_iterator it=keyframes.begin();it != keyframes.end();it++)
+	{
+		if (it->first <= minFrame && it->first > startDecodingAt) startDecodingAt = it->first;
+		if (DEBUG) FFprintf("%d %d\n",it->first,startDecodingAt);
+	}
+}
+
+
+void FFGrabber::setTime(double startTime, double stopTime)
+{
+	this->startTime = startTime;
+	this->stopTime = stopTime;
+	frameNrs.clear();
+
+	for (int i=0; i < videos.size(); i++)
+	{
+		Grabber* CB = videos.at(i);
+		if (CB)
+		{
+			CB->clearFrames();
+			CB->frameNrs.clear();
+			CB->startTime = startTime;
+			CB->stopTime = stopTime;
+		}
+	}
+
+	for (int i=0; i < audios.size(); i++)
+	{
+		Grabber* CB = audios.at(i);
+		if (CB)
+		{
+			CB->clearFrames();
+			CB->frameNrs.clear();
+			CB->startTime = startTime;
+			CB->stopTime = stopTime;
+		}
+	}
+}
+
+FrameKey FFGrabber::frameKey(unsigned int id, unsigned int frameNr)
+{
+	FrameKey key;
+	key.filename = filename;
+	key.mtime = filestat.st_mtime;
+	key.size = filestat.st_size;
+	key.stream = id;
+	key.frameNr = frameNr;
+	key.width = videos[id]->info.video.width;
+	key.height = videos[id]->info.video.height;
+	key.channels = 3;
+	return key;
+}
+
+// true when everything the next capture asks for is after the packets read so far
+bool FFGrabber::canResume()
+{
+	if (atEnd) return false;
+
+	for (streammap::iterator i = streams.begin(); i != streams.end(); i++)
+	{
+		Grabber* G = i->second;
+		// nothing left to decode in this stream
+		if (G->done) continue;
+		// the audio is not kept past the stop time, and the packets read after seeking are not counted
+		if (G->dropped || G->isAudio || seeked) return false;
+
+		if (G->stopTime)
+		{
+			// the pending frame is the first one from the last stop time on
+			if (G->pending ? G->startTime < G->pendingStop : !(G->startTime > G->lastTime)) return false;
+		} else {
+			// all the frames, or frames before the pending one or the last one read
+			if (G->frameNrs.empty()) return false;
+			unsigned int next = G->pending ? G->pendingNr : G->frameNr+1;
+			for (size_t k=0; k<G->frameNrs.size(); k++)
+			{
+				if (G->frameNrs[k] < next) return false;
+			}
+		}
+	}
+	return true;
+}
+
+// back to the state right after build
+void FFGrabber::rewind()
+{
+	if (DEBUG) FFprintf("rewind\n");
+	double start = CaptureStats::now();
+	avbin_seek_file(file, 0);
+	captureStats.add(STAGE_SEEK, start);
+
+	for (streammap::iterator i = streams.begin(); i != streams.end(); i++)
+	{
+		Grabber* G = i->second;
+		G->frameNr = 0;
+		G->packetNr = 0;
+		G->dropped = false;
+		G->lastTime = -HUGE_VAL;
+		G->dropPending();
+	}
+	atEnd = false;
+	seeked = false;
+}
+
+void FFGrabber::setFrameStore(const char* path, const double* roi, bool firstChannel)
+{
+	free(storePath);
+	storePath = path ? strdup(path) : NULL;
+	for (int i=0; i<4; i++) storeRoi[i] = roi ? roi[i] : 0;
+	storeFirstChannel = firstChannel;
+	// the frames served from the store point into its mapping
+	storedFrames.clear();
+	store.close();
+}
+
+// the format of the frames in the store, with the ROI clipped to the frame
+void FFGrabber::storeFormat(StoreHeader &format)
+{
+	memset(&format, 0, sizeof(format));
+	format.sourceSize = filestat.st_size;
+	format.sourceMtime = filestat.st_mtime;
+
+	int width = videos[0]->info.video.width, height = videos[0]->info.video.height;
+	format.width = width;
+	format.height = height;
+	format.channels = storeFirstChannel ? 1 : 3;
+	format.scale = 1;
+	if (storeRoi[2] > 0 && storeRoi[3] > 0)
+	{
+		int x0 = min(max((int)floor(storeRoi[0]+0.5),1),width)-1, y0 = min(max((int)floor(storeRoi[1]+0.5),1),height)-1;
+		format.roi[0] = x0;
+		format.roi[1] = y0;
+		format.roi[2] = format.width = min((int)floor(storeRoi[2]+0.5),width-x0);
+		format.roi[3] = format.height = min((int)floor(storeRoi[3]+0.5),height-y0);
+	}
+}
+
+// the capture copied from the store when it holds all of it
+bool FFGrabber::readStore()
 {
-	if (DEBUG) FFprintf("getting Video frame %d\n",frameNr);
+	// opened whatever the streams, writeStore adds to the frames it holds
+	storedFrames.clear();
+	if (store.open(storePath, filestat, storedFormat.roi, storedFormat.channels, storedFormat.scale)) return false;
+	// the other streams would still have to be decoded
+	if (streams.size() != 1) return false;
+
+	Grabber* G = videos[0];
+	const map<unsigned int,StoreEntry> &entries = store.getEntries();
+	vector<StoreEntry> frames;
+	if (!G->frameNrs.empty())
+	{
+		set<unsigned int> frameNrs(G->frameNrs.begin(), G->frameNrs.end());
+		for (set<unsigned int>::iterator f = frameNrs.begin(); f != frameNrs.end(); f++)
+		{
+			map<unsigned int,StoreEntry>::const_iterator e = entries.find(*f);
+			if (e == entries.end()) return false;
+			frames.push_back(e->second);
+		}
+	} else if (store.complete()) {
+		for (map<unsigned int,StoreEntry>::const_iterator e = entries.begin(); e != entries.end(); e++)
+		{
+			if (!G->stopTime || (e->second.time >= G->startTime && e->second.time < G->stopTime)) frames.push_back(e->second);
+		}
+	} else {
+		return false;
+	}
 
-	if (!data || !nrBytes) return -1;
+	// the frames stay in the mapping until the next capture, getStoredFrame gives them
+	storedFrames = frames;
+	for (size_t k=0; k<frames.size(); k++)
+	{
+		G->frames.push_back(NULL);
+		G->frameBytes.push_back(frames[k].nrBytes);
+		G->frameTimes.push_back(frames[k].time);
+		G->frameIndex.push_back(frames[k].frameNr);
+		captureStats.framesKept++;
+	}
+	G->done = true;
+	return true;
+}
 
-	if (id >= videos.size()) return -2;
-	Grabber* CB = videos[id];
-	if (!CB) return -1;
-	if (CB->frameNr == 0) return -2;
-	if (frameNr < 0 || frameNr >= CB->frames.size()) return -2;
+// the frames just decoded in the format of the store, which gets the new ones
+void FFGrabber::writeStore()
+{
+	Grabber* G = videos[0];
+	const StoreHeader &format = storedFormat;
+	int width = G->info.video.width;
+	size_t nrBytes = (size_t)format.width*format.height*format.channels;
+
+	vector<StoreEntry> frames;
+	vector<const uint8_t*> data;
+	const map<unsigned int,StoreEntry> &entries = store.getEntries();
+	for (size_t k=0; k<G->frames.size(); k++)
+	{
+		uint8_t* src = G->frames[k];
+		if (!src) continue;
+
+		uint8_t* dst = (uint8_t*)malloc(nrBytes);
+		if (!dst) continue;
+		captureStats.bytesAllocated += nrBytes;
+		double start = CaptureStats::now();
+		for (unsigned int y=0; y<format.height; y++)
+		{
+			const uint8_t* line = src + ((size_t)(y+format.roi[1])*width + format.roi[0])*3;
+			uint8_t* out = dst + (size_t)y*format.width*format.channels;
+			if (format.channels == 3)
+			{
+				memcpy(out, line, format.width*3);
+			} else {
+				for (unsigned int x=0; x<format.width; x++) out[x] = line[3*x];
+			}
+		}
+		captureStats.add(STAGE_CONVERT, start);
+		free(src);
+		G->frames[k] = dst;
+		G->frameBytes[k] = nrBytes;
 
-	uint8_t* tmp = CB->frames[frameNr];
-	if (!tmp) return -2;
+		if (!entries.count(G->frameIndex[k]))
+		{
+			StoreEntry e;
+			e.frameNr = G->frameIndex[k];
+			e.nrBytes = nrBytes;
+			e.time = G->frameTimes[k];
+			e.offset = 0;
+			frames.push_back(e);
+			data.push_back(dst);
+		}
+	}
 
-	*nrBytes = CB->frameBytes[frameNr];
-	*time = CB->frameTimes[frameNr];
+	// the frame numbers are not counted from the start of the file after seeking
+	if (seeked) return;
+	StoreHeader h = format;
+	// every frame was read
+	bool complete = G->frameNrs.empty() && !G->stopTime && atEnd && !G->dropped;
+	h.flags = store.complete() || complete ? STORE_COMPLETE : 0;
+	if (frames.empty() && h.flags == (store.complete() ? STORE_COMPLETE : 0)) return;
 
-	*data = tmp;
-	CB->frames[frameNr] = NULL;
+	storedFrames.clear();
+	if (store.update(storePath, h, frames, data)) FFprintf("could not write the frame store %s\n",storePath);
+}
 
+int FFGrabber::setFrameStats(const FrameStatsOptions* options)
+{
+	if (!options)
+	{
+		statsOptions.which = 0;
+		return 0;
+	}
+	if (options->which < 0 || options->which >= (1 << NB_STATS) || options->histogramBins < 1 || options->histogramBins > 256 || options->thumbWidth < 1 || options->thumbHeight < 1) return -1;
+	statsOptions = *options;
 	return 0;
 }
 
-// data must be freed by caller
-int FFGrabber::getAudioFrame(unsigned int id, unsigned int frameNr, uint8_t** data, unsigned int* nrBytes, double* time)
+int FFGrabber::getFrameStats(unsigned int id, const FrameStats** stats)
 {
-	if (!data || !nrBytes) return -1;
-
-	if (id >= audios.size()) return -2;
-	Grabber* CB = audios[id];
-	if (!CB) return -1;
-	if (CB->frameNr == 0) return -2;
-	if (frameNr < 0 || frameNr >= CB->frames.size()) return -2;
-
-	uint8_t* tmp = CB->frames[frameNr];
-	if (!tmp) return -2;
+	if (id >= frameStats.size()) return -2;
+	*stats = &frameStats[id];
+	return 0;
+}
 
-	*nrBytes = CB->frameBytes[frameNr];
-	*time = CB->frameTimes[frameNr];
+int FFGrabber::scanFrames(FrameCallback callback, void* user)
+{
+	if (!file || videos.empty()) return -2;
+
+	FrameCallback lastCallback = frameCallback;
+	void* lastUser = frameCallbackUser;
+	int which = statsOptions.which;
+	statsOptions.which = 0;
+	setTime(0,0);
+	setFrameCallback(callback, user);
+	int err = doCapture();
+	setFrameCallback(lastCallback, lastUser);
+	statsOptions.which = which;
+	return err;
+}
 
-	*data = tmp;
-	CB->frames[frameNr] = NULL;
+int FFGrabber::buildProxy(int scale, const unsigned int* frameNrs, int nrFrames)
+{
+	if (!file || videos.empty()) return -2;
+	if (scale < 1 || nrFrames < 0) return -1;
+
+	Grabber* G = videos[0];
+	// one proxy per scale, so that asking for another one does not replace it
+	char suffix[32];
+	sprintf(suffix, ".%d.proxy", scale);
+	string path = string(filename) + suffix;
+	int roi[4] = {0,0,0,0};
+	proxy.open(path.c_str(), filestat, roi, 3, scale);
+
+	// the frames past the end of the video are not missing, they don't exist
+	unsigned int videoFrames = proxy.isOpen() ? proxy.getHeader().videoFrames : 0;
+	vector<unsigned int> missing;
+	const map<unsigned int,StoreEntry> &entries = proxy.getEntries();
+	for (int i=0; i<nrFrames; i++)
+	{
+		if (!entries.count(frameNrs[i]) && !proxy.complete() && (videoFrames == 0 || frameNrs[i] <= videoFrames)) missing.push_back(frameNrs[i]);
+	}
+	sort(missing.begin(), missing.end());
+	missing.erase(unique(missing.begin(), missing.end()), missing.end());
+	if (nrFrames > 0 ? missing.empty() : proxy.complete()) return 0;
+
+	// the frames only go through the callback
+	FrameCallback callback = frameCallback;
+	void* user = frameCallbackUser;
+	int which = statsOptions.which;
+	statsOptions.which = 0;
+	if (missing.empty())
+	{
+		setTime(0,0);
+	} else {
+		setFrames(&missing[0], missing.size());
+	}
+	ProxyFrames P;
+	P.scale = scale;
+	setFrameCallback(addProxyFrame, &P);
+	int err = doCapture();
+	setFrameCallback(callback, user);
+	statsOptions.which = which;
+
+	// the frame numbers are not counted from the start of the file after seeking
+	if (!err && !seeked)
+	{
+		StoreHeader h;
+		memset(&h, 0, sizeof(h));
+		h.sourceSize = filestat.st_size;
+		h.sourceMtime = filestat.st_mtime;
+		h.width = (G->info.video.width+scale-1)/scale;
+		h.height = (G->info.video.height+scale-1)/scale;
+		h.channels = 3;
+		h.scale = scale;
+		bool complete = nrFrames == 0 && atEnd && !G->dropped;
+		h.flags = proxy.complete() || complete ? STORE_COMPLETE : 0;
+		// the capture went through the whole video when it ran out of packets
+		h.videoFrames = atEnd ? G->frameNr : videoFrames;
+		err = proxy.update(path.c_str(), h, P.entries, P.data);
+	}
+	for (size_t k=0; k<P.data.size(); k++) free((void*)P.data[k]);
 
-	return 0;
+	// not written after seeking when there was none
+	if (proxy.open(path.c_str(), filestat, roi, 3, scale) && !err) err = -3;
+	return err;
 }
 
-void FFGrabber::setFrames(unsigned int* frameNrs, int nrFrames)
+int FFGrabber::probe(unsigned int id, const ProbeIndex** index)
 {
-	if (!frameNrs) return;
+	if (!file || id >= videos.size()) return -2;
+	map<unsigned int,ProbeIndex>::iterator known = probes.find(id);
+	if (known != probes.end())
+	{
+		*index = &known->second;
+		return 0;
+	}
 
-	unsigned int minFrame=nrFrames>0?frameNrs[0]:0;
+	Grabber* G = videos[id];
+	int streamIndex = -1;
+	for (streammap::iterator i = streams.begin(); i != streams.end(); i++)
+	{
+		if (i->second == G) streamIndex = i->first;
+	}
 
-	this->frameNrs.clear();
-	for (int i=0; i<nrFrames; i++) this->frameNrs.push_back(frameNrs[i]);
+	// a file of its own, so that the position of a persistent session does not move
+	AVbinFile* probeFile = avbin_open_filename(filename);
+	if (!probeFile) return -4;
+	AVRational timeBase = probeFile->context->streams[streamIndex]->time_base;
 
-	for (int j=0; j < videos.size(); j++)
+	struct Packet
 	{
-		Grabber* CB = videos.at(j);
-		if (CB)
-		{
-			CB->frames.clear();
-			CB->frameNrs.clear();
-			for (int i=0; i<nrFrames; i++)
-			{
-				CB->frameNrs.push_back(frameNrs[i]);
-				minFrame=frameNrs[i]<minFrame?frameNrs[i]:minFrame;
-			}
-			CB->frameNr = 0;
-			CB->packetNr = 0;
-		}
+		double time;
+		bool key;
+		int64_t offset;
+		bool operator<(const Packet &p) const { return time < p.time; }
+	};
+	vector<Packet> packets;
+	AVbinPacket packet;
+	packet.structure_size = sizeof(packet);
+	double start = CaptureStats::now();
+	while (!avbin_read(probeFile, &packet))
+	{
+		captureStats.packetsRead++;
+		if (packet.stream_index != streamIndex) continue;
+
+		// the AVbin time stamp is the decoding one, the presentation one is in the packet
+		const AVPacket* raw = probeFile->packet;
+		Packet p;
+		p.time = (packet.timestamp-G->start_time)/1000.0/1000.0;
+		if (raw && raw->pts != AV_NOPTS_VALUE && timeBase.den) p.time = raw->pts*(double)timeBase.num/timeBase.den - G->start_time/1000.0/1000.0;
+		p.key = raw && (raw->flags & AV_PKT_FLAG_KEY);
+		p.offset = raw ? raw->pos : -1;
+		packets.push_back(p);
+
+		// the captures can start decoding at the last keyframe before the first frame asked for
+		if (p.key && !keyframes.count(packets.size())) keyframes[packets.size()] = p.time;
 	}
+	avbin_close_file(probeFile);
+	captureStats.add(STAGE_DEMUX, start);
 
-	if (tryseeking && nrFrames > 0)
+	stable_sort(packets.begin(), packets.end());
+	ProbeIndex &probed = probes[id];
+	for (size_t k=0; k<packets.size(); k++)
 	{
-		startDecodingAt = 0;
-		for (map<unsigned int,double>::const_iterator it=keyframes.begin();it != keyframes.end();it++)
-		{
-			if (it->first <= minFrame && it->first > startDecodingAt) startDecodingAt = it->first;
-			if (DEBUG) FFprintf("%d %d\n",it->first,startDecodingAt);
-		}
+		probed.times.push_back(packets[k].time);
+		probed.keyframes.push_back(packets[k].key);
+		probed.offsets.push_back(packets[k].offset);
 	}
+	*index = &probed;
+	return 0;
+}
 
+int FFGrabber::frameAtTime(unsigned int id, double time, unsigned int* frameNr)
+{
+	const ProbeIndex* index;
+	int err = probe(id, &index);
+	if (err) return err;
+	// the time stamps are in microseconds
+	*frameNr = upper_bound(index->times.begin(), index->times.end(), time+0.5e-6) - index->times.begin();
+	return 0;
+}
 
-	// the meaning of frames doesn't make much sense for audio...
+void FFGrabber::setFollow(double timeout, double interval)
+{
+	followTimeout = timeout > 0 ? timeout : 0;
+	followInterval = interval > 0 ? interval : 0.5;
 }
 
+void FFGrabber::setFrameCallback(FrameCallback callback, void* user)
+{
+	frameCallback = callback;
+	frameCallbackUser = user;
+}
 
-void FFGrabber::setTime(double startTime, double stopTime)
+void FFGrabber::runFrameCallback(Grabber* G)
 {
-	this->startTime = startTime;
-	this->stopTime = stopTime;
-	frameNrs.clear();
+	if (!frameCallback || G->frames.size() == 0) return;
 
-	for (int i=0; i < videos.size(); i++)
-	{
-		Grabber* CB = videos.at(i);
-		if (CB)
-		{
-			CB->frames.clear();
-			CB->frameNrs.clear();
-			CB->frameNr = 0;
-			CB->packetNr = 0;
-			CB->startTime = startTime;
-			CB->stopTime = stopTime;
-		}
-	}
+	vector<uint8_t*>::iterator lastframe = --(G->frames.end());
+	if (*lastframe == NULL) return;
 
-	for (int i=0; i < audios.size(); i++)
+	// the number of the frame decoded, not its place in the capture: frames that are
+	// dropped or fail to decode, and the captures before this one, are counted too
+	double start = CaptureStats::now();
+	frameCallback(frameCallbackUser, *lastframe, G->frameBytes.back(), G->info.video.width, G->info.video.height, G->frameTimes.back(), G->frameIndex.back());
+	captureStats.add(STAGE_CALLBACK, start);
+
+	free(*lastframe);
+	*lastframe = NULL;
+}
+
+// true when the file has grown, false after followTimeout seconds without new data
+bool FFGrabber::waitForData()
+{
+	double waited = 0;
+	for (;;)
 	{
-		Grabber* CB = audios.at(i);
-		if (CB)
+		struct stat fstat;
+		if (stat(filename,&fstat) == 0 && fstat.st_size > followSize)
 		{
-			CB->frames.clear();
-			CB->frameNrs.clear();
-			CB->startTime = startTime;
-			CB->stopTime = stopTime;
+			followSize = fstat.st_size;
+			// the demuxer stopped at the old end of the file, let it read on
+			if (file->context->pb) file->context->pb->eof_reached = 0;
+			return true;
 		}
+		if (waited >= followTimeout) return false;
+
+		usleep((useconds_t)(followInterval*1000*1000));
+		waited += followInterval;
 	}
 }
 
@@ -537,29 +1876,42 @@ void FFGrabber::runMatlabCommand(Grabber* G)
 		mxGetPr(prhs[3])[0] = G->frameNrs.size()==0?G->frameTimes.size():G->frameNrs[G->frameTimes.size()-1];
 		mxGetPr(prhs[4])[0] = G->frameTimes.back();
 
+		double start = CaptureStats::now();
 		memcpy(mxGetPr(prhs[0]),*lastframe,dims[0]);
+		captureStats.add(STAGE_COPY, start);
 
 		//free the frame memory
 		free(*lastframe);
 		*lastframe = NULL;
 
 		//call Matlab
+		start = CaptureStats::now();
 		ExitCode = mexCallMATLAB(0,plhs,5,prhs,matlabCommand);
+		captureStats.add(STAGE_CALLBACK, start);
 	}
 }
 #endif
 
 int FFGrabber::build(char* filename, bool disableVideo, bool disableAudio, bool tryseeking)
 {
-	if (DEBUG) FFprintf("avbin_open_filename\n");
- 	file = avbin_open_filename(filename);
- 	if (!file) return -4;
-
 	//detect if the file has changed
 	struct stat fstat;
 	stat(filename,&fstat);
 
-	if (!this->filename || strcmp(this->filename,filename)!=0 || filestat.st_mtime != fstat.st_mtime)
+	bool changed = !this->filename || strcmp(this->filename,filename)!=0 || filestat.st_mtime != fstat.st_mtime || filestat.st_size != fstat.st_size;
+
+	if (file)
+	{
+		// the session goes on with the same decoders
+		if (persistent && !changed && videoDisabled == disableVideo && audioDisabled == disableAudio && this->tryseeking == tryseeking) return 0;
+		close();
+	}
+
+	if (DEBUG) FFprintf("avbin_open_filename\n");
+ 	file = avbin_open_filename(filename);
+ 	if (!file) return -4;
+
+	if (changed)
 	{
 		free(this->filename);
 		this->filename=strdup(filename);
@@ -567,7 +1919,9 @@ int FFGrabber::build(char* filename, bool disableVideo, bool disableAudio, bool
 
 		keyframes.clear();
 		startDecodingAt = 0xFFFFFFFF;
+		probes.clear();
 	}
+	followSize = fstat.st_size;
 
 	fileinfo.structure_size = sizeof(fileinfo);
 
@@ -617,57 +1971,215 @@ int FFGrabber::build(char* filename, bool disableVideo, bool disableAudio, bool
 		}
 	}
 	this->tryseeking = tryseeking;
+	videoDisabled = disableVideo;
+	audioDisabled = disableAudio;
 	stopForced = false;
+	captured = atEnd = seeked = false;
 
 	return 0;
 }
 
+// the next packet of the file, 0 when there is one
+int FFGrabber::readPacket(AVbinPacket* packet)
+{
+	double start = CaptureStats::now();
+	int err = avbin_read(file, packet);
+	captureStats.add(STAGE_DEMUX, start);
+	if (!err) captureStats.packetsRead++;
+	return err;
+}
+
 int FFGrabber::doCapture()
 {
 	AVbinPacket packet;
 	packet.structure_size = sizeof(packet);
 	streammap::iterator tmp;
 	int needseek=1;
+	double captureStart = CaptureStats::now();
+
+	// every frame asked for is decoded for its statistics
+	bool useStats = statsOptions.which != 0;
+	frameStats.assign(useStats ? videos.size() : 0, FrameStats());
+	for (unsigned int id=0; id<videos.size(); id++)
+	{
+		if (useStats) frameStats[id].setOptions(statsOptions);
+		videos[id]->stats = useStats ? &frameStats[id] : NULL;
+	}
 
-	bool allDone = false;
-	while (!avbin_read(file, &packet))
+	// the first video stream from its frame store, or into it
+	bool useStore = storePath && !videos.empty() && followTimeout == 0 && !frameCallback && !useStats;
+#ifdef MATLAB_MEX_FILE
+	useStore = useStore && !matlabCommand;
+#endif
+	storeUsed = useStore;
+	storedFrames.clear();
+	if (useStore)
 	{
-		if ((tmp = streams.find(packet.stream_index)) != streams.end())
+		storeFormat(storedFormat);
+		if (readStore())
 		{
-			Grabber* G = tmp->second;
-			G->Grab(&packet);
+			stopForced = true;
+			endCapture(captureStart);
+			return 0;
+		}
+	}
 
-			if (G->done)
+	// the frames asked for that are cached are not decoded again (only when they are returned,
+	// the frames passed to a command or callback are not kept)
+	bool useCache = frameCache.enabled() && followTimeout == 0 && !frameCallback && !useStats;
+#ifdef MATLAB_MEX_FILE
+	useCache = useCache && !matlabCommand;
+#endif
+	vector<vector<unsigned int> > requested(videos.size());
+	vector<set<unsigned int> > cached(videos.size());
+	if (useCache)
+	{
+		unsigned int minFrame = 0xFFFFFFFF;
+		for (unsigned int id=0; id<videos.size(); id++)
+		{
+			Grabber* G = videos[id];
+			if (G->frameNrs.empty()) continue;
+
+			// the frames come out in the order of the file, once each
+			set<unsigned int> frameNrs(G->frameNrs.begin(), G->frameNrs.end());
+			requested[id] = G->frameNrs;
+			G->frameNrs.clear();
+			for (set<unsigned int>::iterator f = frameNrs.begin(); f != frameNrs.end(); f++)
 			{
-				allDone = true;
-				for (streammap::iterator i = streams.begin(); i != streams.end() && allDone; i++)
+				uint8_t* data;
+				unsigned int nrBytes;
+				double time;
+				double start = CaptureStats::now();
+				bool hit = frameCache.get(frameKey(id,*f), &data, &nrBytes, &time);
+				captureStats.add(STAGE_COPY, start);
+				if (hit)
 				{
-					allDone = allDone && i->second->done;
+					cached[id].insert(*f);
+					G->frames.push_back(data);
+					G->frameBytes.push_back(nrBytes);
+					G->frameTimes.push_back(time);
+					G->frameIndex.push_back(*f);
+					captureStats.framesKept++;
+				} else {
+					G->frameNrs.push_back(*f);
+					minFrame = min(minFrame,*f);
 				}
 			}
+			G->done = G->frameNrs.empty();
+		}
+		if (tryseeking && minFrame != 0xFFFFFFFF) findStartDecoding(minFrame);
+	}
 
+	// a persistent session reads on from where the last capture stopped when it can
+	if (captured)
+	{
+		if (canResume())
+		{
+			needseek = 0;
+			for (streammap::iterator i = streams.begin(); i != streams.end(); i++)
+			{
+				Grabber* G = i->second;
+				if (!G->servePending()) continue;
 #ifdef MATLAB_MEX_FILE
-			if (!G->isAudio) runMatlabCommand(G);
+				runMatlabCommand(G);
 #endif
+				runFrameCallback(G);
+			}
+		} else {
+			rewind();
 		}
+	}
+	captured = true;
+	stopForced = false;
+	for (streammap::iterator i = streams.begin(); i != streams.end(); i++) i->second->persistent = persistent;
 
-		if (tryseeking && needseek)
+	bool allDone = true;
+	for (streammap::iterator i = streams.begin(); i != streams.end() && allDone; i++) allDone = i->second->done;
+	do
+	{
+		while (!allDone && !readPacket(&packet))
 		{
-			if (stopTime && startTime > 0) {
-				if (DEBUG) FFprintf("try seeking to %lf\n",startTime);
-				av_seek_frame(file->context, -1, (AVbinTimestamp)(startTime*1000*1000), AVSEEK_FLAG_BACKWARD);
+			if ((tmp = streams.find(packet.stream_index)) != streams.end())
+			{
+				Grabber* G = tmp->second;
+				G->Grab(&packet);
+
+				if (G->done)
+				{
+					allDone = true;
+					for (streammap::iterator i = streams.begin(); i != streams.end() && allDone; i++)
+					{
+						allDone = allDone && i->second->done;
+					}
+				}
+
+#ifdef MATLAB_MEX_FILE
+				if (!G->isAudio) runMatlabCommand(G);
+#endif
+				if (!G->isAudio) runFrameCallback(G);
+			}
+
+			if (tryseeking && needseek)
+			{
+				if (stopTime && startTime > 0) {
+					if (DEBUG) FFprintf("try seeking to %lf\n",startTime);
+					double start = CaptureStats::now();
+					av_seek_frame(file->context, -1, (AVbinTimestamp)(startTime*1000*1000), AVSEEK_FLAG_BACKWARD);
+					captureStats.add(STAGE_SEEK, start);
+					seeked = true;
+				}
+				needseek = 0;
+			}
+
+			if (allDone)
+			{
+				if (DEBUG) FFprintf("stopForced\n");
+				stopForced = true;
+				break;
 			}
-			needseek = 0;
 		}
+		// in follow mode the end of the file is only where the writer is at
+	} while (!allDone && followTimeout > 0 && waitForData());
+	atEnd = !allDone;
+	stopForced = stopForced || allDone;
+
+	// the decoded frames go to the cache and in order among the cached ones
+	for (unsigned int id=0; id<requested.size(); id++)
+	{
+		if (requested[id].empty()) continue;
+		Grabber* G = videos[id];
 
-		if (allDone)
+		map<unsigned int,size_t> order;
+		for (size_t k=0; k<G->frameIndex.size(); k++)
 		{
-			if (DEBUG) FFprintf("stopForced\n");
-			stopForced = true;
-			break;
+			if (!cached[id].count(G->frameIndex[k]) && G->frames[k])
+			{
+				double start = CaptureStats::now();
+				frameCache.put(frameKey(id,G->frameIndex[k]), G->frames[k], G->frameBytes[k], G->frameTimes[k]);
+				captureStats.add(STAGE_COPY, start);
+			}
+			order[G->frameIndex[k]] = k;
+		}
+
+		vector<uint8_t*> frames;
+		vector<unsigned int> frameBytes, frameIndex;
+		vector<double> frameTimes;
+		for (map<unsigned int,size_t>::iterator k = order.begin(); k != order.end(); k++)
+		{
+			frames.push_back(G->frames[k->second]);
+			frameBytes.push_back(G->frameBytes[k->second]);
+			frameTimes.push_back(G->frameTimes[k->second]);
+			frameIndex.push_back(k->first);
 		}
+		G->frames.swap(frames);
+		G->frameBytes.swap(frameBytes);
+		G->frameTimes.swap(frameTimes);
+		G->frameIndex.swap(frameIndex);
+		G->frameNrs = requested[id];
 	}
 
+	if (useStore) writeStore();
+
 #ifdef MATLAB_MEX_FILE
 	if (prhs[0])
 	{
@@ -680,9 +2192,16 @@ int FFGrabber::doCapture()
 	prhs[0] = NULL;
 #endif
 
+	endCapture(captureStart);
 	return 0;
 }
 
+void FFGrabber::endCapture(double start)
+{
+	captureStats.add(STAGE_CAPTURE, start);
+	if (captureStats.tracing() && captureStats.writeTrace()) FFprintf("could not write the trace file\n");
+}
+
 #ifdef MATLAB_MEX_FILE
 FFGrabber FFG;
 
@@ -693,6 +2212,7 @@ char* message(int err)
 		case 0: return "";
 		case -1: return "Unable to initialize";
 		case -2: return "Invalid interface";
+		case -3: return "Unable to write the proxy file";
 		case -4: return "Unable to open file";
 		case -5: return "AVbin version 8 or greater is required!";
 		default: return "Unknown error";
@@ -773,18 +2293,27 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 		unsigned int id = (unsigned int)mxGetScalar(prhs[1]);
 		unsigned int frameNr = (unsigned int)mxGetScalar(prhs[2]);
 		uint8_t* data;
+		const uint8_t* stored;
 		unsigned int nrBytes;
 		double time;
 		mwSize dims[2];
 		dims[1]=1;
-		char* errmsg =  message(FFG.getVideoFrame(id, frameNr, &data, &nrBytes, &time));
+		// the frames read from the frame store are copied once, straight out of its mapping
+		bool isStored = FFG.getStoredFrame(id, frameNr, &stored, &nrBytes, &time) == 0;
+		if (!isStored)
+		{
+			char* errmsg =  message(FFG.getVideoFrame(id, frameNr, &data, &nrBytes, &time));
 
-		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+			if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+			stored = data;
+		}
 
 		dims[0] = nrBytes;
 		plhs[0] = mxCreateNumericArray(2, dims, mxUINT8_CLASS, mxREAL); // empty 2d matrix
-		memcpy(mxGetPr(plhs[0]),data,nrBytes);
-		free(data);
+		double start = CaptureStats::now();
+		memcpy(mxGetPr(plhs[0]),stored,nrBytes);
+		captureStats.add(STAGE_COPY, start);
+		if (!isStored) free(data);
 		if (nlhs >= 2) {plhs[1] = mxCreateDoubleMatrix(1,1,mxREAL); mxGetPr(plhs[1])[0] = time; }
 	} else if (!strcmp("getAudioFrame",cmd)) {
 		if (nrhs < 3 || !mxIsNumeric(prhs[1]) || !mxIsNumeric(prhs[2])) mexErrMsgTxt("getAudioFrame: second parameter must be the audio stream id (as a number) and third parameter must be the frame number");
@@ -874,6 +2403,11 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 		if (nlhs > 0) mexErrMsgTxt("setTime: has no outputs");
 
 		FFG.setTime(mxGetScalar(prhs[1]), mxGetScalar(prhs[2]));
+	} else if (!strcmp("setFollow",cmd)) {
+		if (nrhs < 2 || !mxIsDouble(prhs[1])) mexErrMsgTxt("setFollow: the timeout is required (as a double, 0 to stop following)");
+		if (nlhs > 0) mexErrMsgTxt("setFollow: has no outputs");
+
+		FFG.setFollow(mxGetScalar(prhs[1]), nrhs >= 3 ? mxGetScalar(prhs[2]) : 0.5);
 	} else if (!strcmp("setMatlabCommand",cmd)) {
 		if (nrhs < 2 || !mxIsChar(prhs[1])) mexErrMsgTxt("setMatlabCommand: the command must be passed as a string");
 		if (nlhs > 0) mexErrMsgTxt("setMatlabCommand: has no outputs");
@@ -887,9 +2421,243 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 			free(matlabCommand);
 		} else FFG.setMatlabCommand(matlabCommand);
 
+	} else if (!strcmp("setPersistent",cmd)) {
+		if (nrhs < 2 || !mxIsNumeric(prhs[1])) mexErrMsgTxt("setPersistent: the second parameter must be true or false (as a number)");
+		if (nlhs > 0) mexErrMsgTxt("setPersistent: has no outputs");
+
+		FFG.setPersistent(mxGetScalar(prhs[1]) != 0);
+		if (mxGetScalar(prhs[1]) == 0) FFG.close();
+	} else if (!strcmp("setCache",cmd)) {
+		if (nrhs < 2 || !mxIsNumeric(prhs[1])) mexErrMsgTxt("setCache: the second parameter must be the memory budget in megabytes (0 to disable the cache)");
+		if (nlhs > 0) mexErrMsgTxt("setCache: has no outputs");
+
+		double megabytes = mxGetScalar(prhs[1]);
+		frameCache.setBudget(megabytes > 0 ? (size_t)(megabytes*1024*1024) : 0);
+	} else if (!strcmp("getCacheStats",cmd)) {
+		if (nlhs > 5) mexErrMsgTxt("getCacheStats: there are only 5 output values: hits, misses, nrFrames, bytes, evictions");
+
+		double hits, misses, nrFrames, bytes, evictions;
+		frameCache.getStats(&hits, &misses, &nrFrames, &bytes, &evictions);
+
+		if (nlhs >= 1) {plhs[0] = mxCreateDoubleMatrix(1,1,mxREAL); mxGetPr(plhs[0])[0] = hits; }
+		if (nlhs >= 2) {plhs[1] = mxCreateDoubleMatrix(1,1,mxREAL); mxGetPr(plhs[1])[0] = misses; }
+		if (nlhs >= 3) {plhs[2] = mxCreateDoubleMatrix(1,1,mxREAL); mxGetPr(plhs[2])[0] = nrFrames; }
+		if (nlhs >= 4) {plhs[3] = mxCreateDoubleMatrix(1,1,mxREAL); mxGetPr(plhs[3])[0] = bytes; }
+		if (nlhs >= 5) {plhs[4] = mxCreateDoubleMatrix(1,1,mxREAL); mxGetPr(plhs[4])[0] = evictions; }
+	} else if (!strcmp("probe",cmd)) {
+		if (nrhs < 2 || !mxIsNumeric(prhs[1])) mexErrMsgTxt("probe: second parameter must be the video stream id (as a number)");
+		if (nlhs > 4) mexErrMsgTxt("probe: there are only 4 output values: nrFrames, times, keyframes, offsets");
+
+		const ProbeIndex* index;
+		char* errmsg = message(FFG.probe((unsigned int)mxGetScalar(prhs[1]), &index));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		size_t n = index->times.size();
+		plhs[0] = mxCreateDoubleScalar(n);
+		if (nlhs >= 2)
+		{
+			plhs[1] = mxCreateDoubleMatrix(n,1,mxREAL);
+			if (n) memcpy(mxGetPr(plhs[1]), &index->times[0], n*sizeof(double));
+		}
+		if (nlhs >= 3)
+		{
+			plhs[2] = mxCreateLogicalMatrix(n,1);
+			for (size_t k=0; k<n; k++) mxGetLogicals(plhs[2])[k] = index->keyframes[k];
+		}
+		if (nlhs >= 4)
+		{
+			plhs[3] = mxCreateDoubleMatrix(n,1,mxREAL);
+			for (size_t k=0; k<n; k++) mxGetPr(plhs[3])[k] = index->offsets[k];
+		}
+	} else if (!strcmp("frameAtTime",cmd)) {
+		if (nrhs < 3 || !mxIsNumeric(prhs[1]) || !mxIsDouble(prhs[2])) mexErrMsgTxt("frameAtTime: parameters must be the video stream id (as a number) and the times (as doubles)");
+		if (nlhs > 1) mexErrMsgTxt("frameAtTime: there is only 1 output value: frameNrs");
+
+		unsigned int id = (unsigned int)mxGetScalar(prhs[1]);
+		size_t n = mxGetNumberOfElements(prhs[2]);
+		plhs[0] = mxCreateDoubleMatrix(mxGetM(prhs[2]),mxGetN(prhs[2]),mxREAL);
+		for (size_t k=0; k<n; k++)
+		{
+			unsigned int frameNr;
+			char* errmsg = message(FFG.frameAtTime(id, mxGetPr(prhs[2])[k], &frameNr));
+			if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+			mxGetPr(plhs[0])[k] = frameNr;
+		}
+	} else if (!strcmp("extractKeyframes",cmd)) {
+		if (nrhs < 4 || !mxIsNumeric(prhs[1]) || !mxIsNumeric(prhs[2]) || !mxIsNumeric(prhs[3])) mexErrMsgTxt("extractKeyframes: parameters must be the threshold, the window (in frames) and the step (in pixels), as numbers");
+		if (nlhs > 1) mexErrMsgTxt("extractKeyframes: there is only 1 output value: indices");
+
+		KeyframeDetector detector;
+		if (detector.setOptions(mxGetScalar(prhs[1]), (int)mxGetScalar(prhs[2]), (int)mxGetScalar(prhs[3]))) mexErrMsgTxt("extractKeyframes: the threshold must be positive, the window at least 2 frames and the step at least 1 pixel");
+
+		// all the frames, once, through the detector
+		char* errmsg = message(FFG.scanFrames(keyframeCallback, &detector));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		const vector<unsigned int>& indices = detector.getKeyframes();
+		plhs[0] = mxCreateDoubleMatrix(1,indices.size(),mxREAL);
+		for (size_t k=0; k<indices.size(); k++) mxGetPr(plhs[0])[k] = indices[k];
+	} else if (!strcmp("getStats",cmd)) {
+		if (nlhs > 1) mexErrMsgTxt("getStats: there is only 1 output value: stats");
+
+		// <stage>Seconds and <stage>Calls for every stage, then the counters
+		vector<string> names;
+		vector<double> values;
+		for (int k=0; k<NB_STAGES; k++)
+		{
+			names.push_back(string(stageNames[k]) + "Seconds");
+			values.push_back(captureStats.seconds[k]);
+			names.push_back(string(stageNames[k]) + "Calls");
+			values.push_back(captureStats.calls[k]);
+		}
+		const char* counters[] = {"packetsRead", "packetsDecoded", "framesKept", "bytesAllocated"};
+		size_t counts[] = {captureStats.packetsRead, captureStats.packetsDecoded, captureStats.framesKept, captureStats.bytesAllocated};
+		for (int k=0; k<4; k++)
+		{
+			names.push_back(counters[k]);
+			values.push_back(counts[k]);
+		}
+
+		vector<const char*> fields;
+		for (size_t k=0; k<names.size(); k++) fields.push_back(names[k].c_str());
+		plhs[0] = mxCreateStructMatrix(1, 1, fields.size(), &fields[0]);
+		for (size_t k=0; k<names.size(); k++) mxSetField(plhs[0], 0, fields[k], mxCreateDoubleScalar(values[k]));
+	} else if (!strcmp("resetStats",cmd)) {
+		if (nlhs > 0) mexErrMsgTxt("resetStats: has no outputs");
+		captureStats.reset();
+	} else if (!strcmp("setTrace",cmd)) {
+		if (nrhs < 2 || !mxIsChar(prhs[1])) mexErrMsgTxt("setTrace: the trace filename is required (as a string, empty to stop tracing)");
+		if (nlhs > 0) mexErrMsgTxt("setTrace: has no outputs");
+
+		int pathlen = mxGetN(prhs[1])+1;
+		char* path = new char[pathlen];
+		mxGetString(prhs[1],path,pathlen);
+		captureStats.setTrace(strlen(path) ? path : NULL);
+		delete[] path;
+	} else if (!strcmp("setFrameStats",cmd)) {
+		if (nrhs < 2 || !mxIsChar(prhs[1])) mexErrMsgTxt("setFrameStats: parameters must be the statistics (as a string of mean, variance, histogram, thumbnail and sad, empty to stop), [histogramBins, thumbnailSize, roi, keepFrames]");
+		if (nrhs >= 4 && !mxIsEmpty(prhs[3]) && (!mxIsDouble(prhs[3]) || mxGetNumberOfElements(prhs[3]) != 2)) mexErrMsgTxt("setFrameStats: the thumbnail size must be [width height]");
+		if (nrhs >= 5 && !mxIsEmpty(prhs[4]) && (!mxIsDouble(prhs[4]) || mxGetNumberOfElements(prhs[4]) != 4)) mexErrMsgTxt("setFrameStats: the roi must be [xmin ymin width height]");
+		if (nlhs > 0) mexErrMsgTxt("setFrameStats: has no outputs");
+
+		FrameStatsOptions options;
+		memset(&options, 0, sizeof(options));
+		options.histogramBins = nrhs >= 3 && !mxIsEmpty(prhs[2]) ? (int)mxGetScalar(prhs[2]) : 16;
+		options.thumbWidth = nrhs >= 4 && !mxIsEmpty(prhs[3]) ? (int)mxGetPr(prhs[3])[0] : 8;
+		options.thumbHeight = nrhs >= 4 && !mxIsEmpty(prhs[3]) ? (int)mxGetPr(prhs[3])[1] : 8;
+		for (int i=0; i<4; i++) options.roi[i] = nrhs >= 5 && !mxIsEmpty(prhs[4]) ? mxGetPr(prhs[4])[i] : 0;
+		options.keepFrames = nrhs < 6 || mxGetScalar(prhs[5]) != 0;
+
+		int namelen = mxGetN(prhs[1])+1;
+		char* names = new char[namelen];
+		mxGetString(prhs[1],names,namelen);
+		for (char* name = strtok(names, " ,"); name; name = strtok(NULL, " ,"))
+		{
+			int k = 0;
+			while (k < NB_STATS && strcmp(name, statsNames[k])) k++;
+			if (k == NB_STATS)
+			{
+				delete[] names;
+				mexErrMsgTxt("setFrameStats: the statistics are mean, variance, histogram, thumbnail and sad");
+			}
+			options.which |= 1 << k;
+		}
+		delete[] names;
+
+		if (FFG.setFrameStats(options.which ? &options : NULL)) mexErrMsgTxt("setFrameStats: the histogram must have 1 to 256 bins and the thumbnail at least 1x1 blocks");
+	} else if (!strcmp("getFrameStats",cmd)) {
+		if (nrhs < 2 || !mxIsNumeric(prhs[1])) mexErrMsgTxt("getFrameStats: second parameter must be the video stream id (as a number)");
+		if (nlhs > 3) mexErrMsgTxt("getFrameStats: there are only 3 output values: stats, frameNrs, times");
+
+		const FrameStats* stats;
+		if (FFG.getFrameStats((unsigned int)mxGetScalar(prhs[1]), &stats)) mexErrMsgTxt("getFrameStats: no statistics were computed for this stream");
+
+		size_t n = stats->frameNrs.size(), m = stats->nbValues();
+		plhs[0] = mxCreateNumericMatrix(m,n,mxSINGLE_CLASS,mxREAL);
+		if (m > 0 && n > 0) memcpy(mxGetData(plhs[0]), &stats->values[0], m*n*sizeof(float));
+		if (nlhs >= 2)
+		{
+			plhs[1] = mxCreateDoubleMatrix(1,n,mxREAL);
+			for (size_t k=0; k<n; k++) mxGetPr(plhs[1])[k] = stats->frameNrs[k];
+		}
+		if (nlhs >= 3)
+		{
+			plhs[2] = mxCreateDoubleMatrix(1,n,mxREAL);
+			if (n) memcpy(mxGetPr(plhs[2]), &stats->times[0], n*sizeof(double));
+		}
+	} else if (!strcmp("getProxy",cmd)) {
+		if (nrhs < 2 || !mxIsNumeric(prhs[1]) || (nrhs >= 3 && !mxIsEmpty(prhs[2]) && !mxIsDouble(prhs[2]))) mexErrMsgTxt("getProxy: parameters must be the scale (as a number), [frameNrs (as doubles)]");
+		if (nlhs > 3) mexErrMsgTxt("getProxy: there are only 3 output values: frames, frameNrs, times");
+
+		int scale = (int)mxGetScalar(prhs[1]);
+		if (scale < 1) mexErrMsgTxt("getProxy: the scale must be at least 1");
+		vector<unsigned int> frameNrs;
+		for (size_t k=0; nrhs >= 3 && k<mxGetNumberOfElements(prhs[2]); k++) frameNrs.push_back((unsigned int)mxGetPr(prhs[2])[k]);
+
+		char* errmsg = message(FFG.buildProxy(scale, frameNrs.empty() ? NULL : &frameNrs[0], frameNrs.size()));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		// the frames asked for that are in the proxy (not those past the end of the video), or all of them
+		const FrameStore &proxy = FFG.getProxy();
+		if (!proxy.isOpen()) mexErrMsgTxt(message(-3));
+		const map<unsigned int,StoreEntry> &entries = proxy.getEntries();
+		vector<StoreEntry> frames;
+		for (size_t k=0; k<frameNrs.size(); k++)
+		{
+			map<unsigned int,StoreEntry>::const_iterator e = entries.find(frameNrs[k]);
+			if (e != entries.end()) frames.push_back(e->second);
+		}
+		if (frameNrs.empty())
+		{
+			for (map<unsigned int,StoreEntry>::const_iterator e = entries.begin(); e != entries.end(); e++) frames.push_back(e->second);
+		}
+
+		// height x width x 3 x frames, as the cdata of mmread
+		mwSize width = proxy.getHeader().width, height = proxy.getHeader().height;
+		mwSize dims[4] = {height, width, 3, frames.size()};
+		plhs[0] = mxCreateNumericArray(4, dims, mxUINT8_CLASS, mxREAL);
+		uint8_t* out = (uint8_t*)mxGetData(plhs[0]);
+		for (size_t k=0; k<frames.size(); k++)
+		{
+			const uint8_t* in = proxy.frameData(frames[k]);
+			uint8_t* frame = out + k*height*width*3;
+			for (mwSize y=0; y<height; y++)
+			{
+				for (mwSize x=0; x<width; x++)
+				{
+					for (int c=0; c<3; c++) frame[y + x*height + c*height*width] = in[(y*width+x)*3+c];
+				}
+			}
+		}
+		if (nlhs >= 2)
+		{
+			plhs[1] = mxCreateDoubleMatrix(1,frames.size(),mxREAL);
+			for (size_t k=0; k<frames.size(); k++) mxGetPr(plhs[1])[k] = frames[k].frameNr;
+		}
+		if (nlhs >= 3)
+		{
+			plhs[2] = mxCreateDoubleMatrix(1,frames.size(),mxREAL);
+			for (size_t k=0; k<frames.size(); k++) mxGetPr(plhs[2])[k] = frames[k].time;
+		}
+	} else if (!strcmp("setFrameStore",cmd)) {
+		if (nrhs < 2 || !mxIsChar(prhs[1])) mexErrMsgTxt("setFrameStore: parameters must be the store filename (as a string, empty to stop), [roi, firstChannel]");
+		if (nrhs >= 3 && !mxIsEmpty(prhs[2]) && (!mxIsDouble(prhs[2]) || mxGetNumberOfElements(prhs[2]) != 4)) mexErrMsgTxt("setFrameStore: the roi must be [xmin ymin width height]");
+		if (nlhs > 0) mexErrMsgTxt("setFrameStore: has no outputs");
+
+		int pathlen = mxGetN(prhs[1])+1;
+		char* path = new char[pathlen];
+		mxGetString(prhs[1],path,pathlen);
+		const double* roi = nrhs >= 3 && !mxIsEmpty(prhs[2]) ? mxGetPr(prhs[2]) : NULL;
+		bool firstChannel = nrhs >= 4 && mxGetScalar(prhs[3]) != 0;
+
+		FFG.setFrameStore(strlen(path) ? path : NULL, roi, firstChannel);
+		delete[] path;
 	} else if (!strcmp("cleanUp",cmd)) {
 		if (nlhs > 0) mexErrMsgTxt("cleanUp: there are no outputs");
 		FFG.cleanUp();
+	} else if (!strcmp("close",cmd)) {
+		if (nlhs > 0) mexErrMsgTxt("close: there are no outputs");
+		FFG.close();
 	}
 }
 #endif
@@ -6,6 +6,13 @@
 #include <fstream> 
 #include "CImg.h"
 #include <algorithm>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <chrono>
+#include <sys/stat.h>
 
 template<typename T>
 void readVideo(char* filename, double scale, size_t &W, size_t &H, size_t &nb_frames, std::vector<T> &video, int max_frames);
@@ -142,6 +149,27 @@ public:
 };
 
 
+// 8 bit values to [0,1], as the streamers return frames
+template<typename T>
+void bytesToUnit(const uint8_t* src, T* dst, size_t n) {
+	for (size_t i=0; i<n; i++) {
+		dst[i] = (T)src[i] / 255.;
+	}
+}
+
+// [0,1] RGB values to clamped 8 bit ones, BGR when swapRedBlue (the order the recorder encodes)
+template<typename T>
+void unitToBytes(const T* src, uint8_t* dst, size_t nbPixels, bool swapRedBlue) {
+	for (size_t i=0; i<nbPixels*3; i++) {
+		dst[i] = min(255., max(0., src[i]*255.));
+	}
+	if (swapRedBlue) {
+		for (size_t i=0; i<nbPixels; i++) {
+			std::swap(dst[i*3], dst[i*3+2]);
+		}
+	}
+}
+
 template<typename T>
 class VideoStreamer {
 public:
@@ -285,9 +313,7 @@ public:
 		unsigned int nrb;
 		double time;
 		FFG->getVideoFrame(0, cur_frame, &tmp, &nrb, &time);
-		for (int k=0; k<W*H*3; k++) {
-			frame[k] = (T)tmp[k] / 255.;
-		}
+		bytesToUnit(tmp, frame, (size_t)W*H*3);
 		delete[] tmp;
 		
 		cur_frame++;
@@ -828,35 +854,208 @@ public:
 	virtual void finalize_video() = 0;
 };
 
+// Saves planar W x H x 3 images on a pool of encoder threads.
+// Buffers are recycled: acquireBuffer() blocks while maxQueued images are
+// waiting to be encoded, which bounds memory when the producer is faster
+// than PNG/TIFF compression.  An image that can't be saved (full disk, bad
+// path) is counted as failed, the exception doesn't leave the worker.
+class ImageWriterPool {
+public:
+
+	ImageWriterPool(size_t W, size_t H, int nbThreads = 0, size_t maxQueued = 0) {
+		this->W = W;
+		this->H = H;
+		if (nbThreads <= 0)
+			nbThreads = std::max(1, (int)std::thread::hardware_concurrency());
+		if (maxQueued == 0)
+			maxQueued = 2*nbThreads;
+		this->maxQueued = maxQueued;
+		nbAllocated = 0;
+		nbBusy = 0;
+		stopping = false;
+		framesWritten = 0;
+		framesFailed = 0;
+		bytesWritten = 0;
+		started = false;
+		for (int i = 0; i < nbThreads; i++)
+			workers.push_back(std::thread(&ImageWriterPool::work, this));
+	}
+
+	// returns a W*H*3 planar buffer to fill; blocks while the queue is full
+	unsigned char* acquireBuffer() {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!started) {
+			started = true;
+			startClock = std::chrono::steady_clock::now();
+		}
+		while (freeBuffers.empty() && nbAllocated >= maxQueued + workers.size())
+			bufferFreed.wait(lock);
+		if (!freeBuffers.empty()) {
+			unsigned char* buffer = freeBuffers.back();
+			freeBuffers.pop_back();
+			return buffer;
+		}
+		nbAllocated++;
+		return new unsigned char[W*H*3];
+	}
+
+	// the pool takes ownership of buffer until it has been saved to filename
+	void submit(unsigned char* buffer, const std::string &filename) {
+		std::unique_lock<std::mutex> lock(mutex);
+		jobs.push_back(Job(buffer, filename));
+		jobQueued.notify_one();
+	}
+
+	// waits until every submitted image is on disk
+	void flush() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!jobs.empty() || nbBusy > 0)
+			bufferFreed.wait(lock);
+		stopClock = std::chrono::steady_clock::now();
+	}
+
+	void getThroughput(size_t* nbFrames, double* seconds, double* framesPerSecond, double* megabytesPerSecond) {
+		std::unique_lock<std::mutex> lock(mutex);
+		double elapsed = started ? std::chrono::duration<double>(stopClock - startClock).count() : 0;
+		*nbFrames = framesWritten;
+		*seconds = elapsed;
+		*framesPerSecond = elapsed > 0 ? framesWritten/elapsed : 0;
+		*megabytesPerSecond = elapsed > 0 ? bytesWritten/elapsed/(1024.*1024.) : 0;
+	}
+
+	// the number of images that could not be saved, and the error of the last one
+	size_t getFailures(std::string* lastError) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (lastError) *lastError = this->lastError;
+		return framesFailed;
+	}
+
+	~ImageWriterPool() {
+		flush();
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stopping = true;
+			jobQueued.notify_all();
+		}
+		for (size_t i = 0; i < workers.size(); i++)
+			workers[i].join();
+		for (size_t i = 0; i < freeBuffers.size(); i++)
+			delete[] freeBuffers[i];
+	}
+
+private:
+
+	struct Job {
+		Job(unsigned char* buffer, const std::string &filename): buffer(buffer), filename(filename) {};
+		unsigned char* buffer;
+		std::string filename;
+	};
+
+	void work() {
+		while (true) {
+			Job job(NULL, "");
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (jobs.empty() && !stopping)
+					jobQueued.wait(lock);
+				if (jobs.empty())
+					return;
+				job = jobs.front();
+				jobs.pop_front();
+				nbBusy++;
+			}
+
+			std::string error;
+			try {
+				cimg_library::CImg<unsigned char> cimg(job.buffer, W, H, 1, 3, true);
+				cimg.save(job.filename.c_str());
+			} catch (const std::exception &e) {
+				error = job.filename + ": " + e.what();
+			}
+			struct stat fstat;
+			size_t nbBytes = error.empty() && stat(job.filename.c_str(), &fstat) == 0 ? fstat.st_size : 0;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			freeBuffers.push_back(job.buffer);
+			if (error.empty()) {
+				framesWritten++;
+				bytesWritten += nbBytes;
+			} else {
+				framesFailed++;
+				lastError = error;
+			}
+			nbBusy--;
+			stopClock = std::chrono::steady_clock::now();
+			bufferFreed.notify_all();
+		}
+	}
+
+	size_t W, H;
+	size_t maxQueued, nbAllocated, nbBusy;
+	bool stopping;
+	std::vector<std::thread> workers;
+	std::deque<Job> jobs;
+	std::vector<unsigned char*> freeBuffers;
+	std::mutex mutex;
+	std::condition_variable jobQueued, bufferFreed;
+
+	size_t framesWritten, framesFailed;
+	std::string lastError;
+	double bytesWritten;
+	bool started;
+	std::chrono::steady_clock::time_point startClock, stopClock;
+};
+
+// nbThreads = 0 uses one encoder thread per core, nbThreads < 0 saves synchronously.
 template<typename T>
 class VideoRecorderImage: public VideoRecorder<T> {
 public:
 
-	VideoRecorderImage(const char* filename, size_t W, size_t H) {
+	VideoRecorderImage(const char* filename, size_t W, size_t H, int nbThreads = 0) {
 		this->W = W;
 		this->H = H;
 		this->filename = std::string(filename);
+		if (nbThreads >= 0) pool.reset(new ImageWriterPool(W, H, nbThreads));
 	}
 	void addFrame(const T* frame) {
 
-		std::vector<unsigned char> deinterleaved(W*H * 3);
+		unsigned char* deinterleaved;
+		if (pool) {
+			deinterleaved = pool->acquireBuffer();
+		} else {
+			buffer.resize(W*H * 3);
+			deinterleaved = &buffer[0];
+		}
 		for (int i = 0; i < W*H; i++) {
 			deinterleaved[i] = min(255., max(0., frame[i*3]*255.));
 			deinterleaved[i + W*H] = min(255., max(0., frame[i*3+1]*255.));
 			deinterleaved[i + 2 * W*H] = min(255., max(0., frame[i*3+2]*255.));
 		}
-		cimg_library::CImg<unsigned char> cimg(&deinterleaved[0], W, H, 1, 3);
-		cimg.save(filename.c_str());
+		if (pool) {
+			pool->submit(deinterleaved, filename);
+		} else {
+			cimg_library::CImg<unsigned char> cimg(deinterleaved, W, H, 1, 3, true);
+			cimg.save(filename.c_str());
+		}
 		increment_file_number(filename);
 	}
 	void finalize_video() {
-
-	}
-	~VideoRecorderImage() {
+		if (!pool) return;
+
+		pool->flush();
+		size_t nbFrames;
+		double seconds, fps, mbps;
+		pool->getThroughput(&nbFrames, &seconds, &fps, &mbps);
+		std::cout << " images written : " << nbFrames << " in " << seconds << "s (" << fps << " frames/s, " << mbps << " MB/s)" << std::endl;
+		std::string lastError;
+		size_t nbFailed = pool->getFailures(&lastError);
+		if (nbFailed) std::cerr << " images not written : " << nbFailed << " (last: " << lastError << ")" << std::endl;
 	}
 
 	size_t W, H;
 	std::string filename;
+	std::vector<unsigned char> buffer;
+	std::unique_ptr<ImageWriterPool> pool;
 };
 
 template<typename T>
@@ -917,7 +1116,8 @@ public:
 	int codec_id;
 	AVFormatContext *oc;
 
-	VideoRecorderMPG(const char* filename, size_t W, size_t H, int pcodec_id = 2) {
+	// gop_size is the distance between keyframes
+	VideoRecorderMPG(const char* filename, size_t W, size_t H, int pcodec_id = 2, int gop_size = 12) {
 		codec_id = pcodec_id;
 		nb_recorded_frames = 0;
 		std::cout << "using codec " << codec_id << std::endl;
@@ -1037,7 +1237,7 @@ public:
 		c->time_base.den = 25;
 		//c->sample_aspect_ratio.num=0;
 		//c->sample_aspect_ratio.den=0;
-		c->gop_size = 12;
+		c->gop_size = gop_size;
 		c->pix_fmt = dest_pxl_fmt;
 		if (c->codec_id == AV_CODEC_ID_MPEG2VIDEO) c->max_b_frames = 2;
 		if (c->codec_id == AV_CODEC_ID_MPEG1VIDEO) c->mb_decision = 2;
@@ -1230,12 +1430,7 @@ public:
 
 		double video_pts;
 		std::vector<unsigned char> resized_frame(initial_W* initial_H * 3);
-		for (int i=0; i<initial_W*initial_H*3; i++) {
-			resized_frame[i] = min(255., max(0., frame[i]*255.));
-		}
-		for (int i=0; i<initial_W*initial_H; i++) {
-			std::swap(resized_frame[i*3], resized_frame[i*3+2]);
-		}
+		unitToBytes(frame, &resized_frame[0], initial_W*initial_H, true);
 		
 		new_W = initial_W;
 		new_H = initial_H;
@@ -0,0 +1,196 @@
+/***************************************************
+Keyframe detector, see Keyframes.h.
+**************************************************/
+
+#include "Keyframes.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+using namespace std;
+
+// imhist of a double image: n bins centered on 0, 1/(n-1), ..., 1, out of range values in the end bins
+static int imhistBin(double x, int n)
+{
+	double b = floor(x*(n-1)+0.5);
+	return b <= 0 ? 0 : b >= n-1 ? n-1 : (int)b;
+}
+
+// the eigenvalues of the symmetric n x n matrix a (destroyed), cyclic Jacobi rotations
+static void symmetricEigenvalues(vector<double> &a, int n, vector<double> &eigenvalues)
+{
+	for (int sweep=0; sweep<50; sweep++)
+	{
+		double off = 0, diagonal = 0;
+		for (int i=0; i<n; i++)
+		{
+			diagonal += a[i*n+i]*a[i*n+i];
+			for (int j=i+1; j<n; j++) off += a[i*n+j]*a[i*n+j];
+		}
+		if (off <= 1e-32*diagonal) break;
+
+		for (int p=0; p<n; p++)
+		{
+			for (int q=p+1; q<n; q++)
+			{
+				double apq = a[p*n+q];
+				if (apq == 0) continue;
+				double theta = (a[q*n+q]-a[p*n+p])/(2*apq);
+				double t = (theta >= 0 ? 1 : -1)/(fabs(theta)+sqrt(theta*theta+1));
+				double c = 1/sqrt(t*t+1), s = t*c;
+				for (int k=0; k<n; k++)
+				{
+					double akp = a[k*n+p], akq = a[k*n+q];
+					a[k*n+p] = c*akp - s*akq;
+					a[k*n+q] = s*akp + c*akq;
+				}
+				for (int k=0; k<n; k++)
+				{
+					double apk = a[p*n+k], aqk = a[q*n+k];
+					a[p*n+k] = c*apk - s*aqk;
+					a[q*n+k] = s*apk + c*aqk;
+				}
+			}
+		}
+	}
+
+	eigenvalues.resize(n);
+	for (int i=0; i<n; i++) eigenvalues[i] = a[i*n+i];
+}
+
+KeyframeDetector::KeyframeDetector()
+{
+	// as colorspace, on the values divided by 255
+	saturationBins.resize(256*256);
+	for (int mx=0; mx<256; mx++)
+	{
+		double v = mx/255.0;
+		valueBins[mx] = imhistBin(v, V_BINS);
+		for (int mn=0; mn<=mx; mn++) saturationBins[mx*256+mn] = H_BINS + imhistBin((v - mn/255.0)/(v + (mx == 0)), S_BINS);
+	}
+	for (int mx=0; mx<256; mx++) valueBins[mx] += H_BINS + S_BINS;
+
+	setOptions(0.05, 12, 1);
+}
+
+int KeyframeDetector::setOptions(double threshold, int window, int step)
+{
+	if (threshold <= 0 || window < 2 || step < 1) return -1;
+
+	this->threshold = threshold;
+	this->window = window;
+	this->step = step;
+	reset();
+
+	return 0;
+}
+
+void KeyframeDetector::reset()
+{
+	histograms.assign((size_t)window*NB_BINS, 0);
+	gram.assign((size_t)window*window, 0);
+	nbFrames = 0;
+	nbWindows = 0;
+	previousRank = nextRank = 0;
+	possibility = 0;
+	keyframes.clear();
+}
+
+void KeyframeDetector::histogram(const uint8_t* data, int width, int height, int64_t* hist)
+{
+	// four banks, so that neighbouring pixels in the same bins don't wait on each other
+	uint32_t banks[4][NB_BINS];
+	memset(banks, 0, sizeof(banks));
+	for (int y=0; y<height; y+=step)
+	{
+		const uint8_t* p = data + (size_t)y*width*3;
+		int bank = 0;
+		for (int x=0; x<width; x+=step, p+=3*step, bank=(bank+1)&3)
+		{
+			int r = p[0], g = p[1], b = p[2];
+			int mx = max(r,max(g,b)), mn = min(r,min(g,b));
+
+			// the hue of colorspace: from the largest channel, the last one of equal ones, in
+			// degrees; it only falls below the last bin when red is the largest and green is
+			// at least blue (grey gives 240)
+			int hue = H_BINS-1;
+			if (r > g && r > b && g >= b)
+			{
+				double R = r/255.0, G = g/255.0, B = b/255.0;
+				hue = imhistBin(60*((G - B)/(R - B)), H_BINS);
+			}
+
+			uint32_t* h = banks[bank];
+			h[hue]++;
+			h[saturationBins[mx*256+mn]]++;
+			h[valueBins[mx]]++;
+		}
+	}
+	for (int i=0; i<NB_BINS; i++) hist[i] = (int64_t)banks[0][i] + banks[1][i] + banks[2][i] + banks[3][i];
+}
+
+// the number of singular values of the window above threshold times the largest
+int KeyframeDetector::rank()
+{
+	vector<double> a(gram), eigenvalues;
+	symmetricEigenvalues(a, window, eigenvalues);
+
+	double largest = *max_element(eigenvalues.begin(), eigenvalues.end());
+	if (largest <= 0) return 0;
+	int r = 0;
+	for (int i=0; i<window; i++) r += eigenvalues[i] > threshold*threshold*largest;
+	return r;
+}
+
+void KeyframeDetector::addFrame(const uint8_t* data, int width, int height)
+{
+	// the frame takes the place of the oldest one of the window
+	int slot = nbFrames%window;
+	int64_t* hist = &histograms[(size_t)slot*NB_BINS];
+	histogram(data, width, height, hist);
+	nbFrames++;
+
+	for (int j=0; j<window; j++)
+	{
+		const int64_t* other = &histograms[(size_t)j*NB_BINS];
+		int64_t dot = 0;
+		for (int i=0; i<NB_BINS; i++) dot += hist[i]*other[i];
+		gram[slot*window+j] = gram[j*window+slot] = (double)dot;
+	}
+
+	if (nbFrames >= (unsigned int)window) addRank(rank());
+}
+
+// the rank of the window that ends with the last frame
+void KeyframeDetector::addRank(int r)
+{
+	nbWindows++;
+	if (nbWindows == 1)
+	{
+		previousRank = r;
+		return;
+	}
+	if (nbWindows == 2)
+	{
+		nextRank = r;
+		return;
+	}
+
+	int current = nextRank;
+	nextRank = r;
+	// the last frame of the window before this one
+	unsigned int frameNumber = nbFrames-1;
+
+	if (current > previousRank) possibility = frameNumber;
+	if (current < nextRank && possibility != 0)
+	{
+		keyframes.push_back(possibility);
+		possibility = 0;
+	}
+	previousRank = current;
+}
+
+void keyframeCallback(void* user, const uint8_t* data, unsigned int /*nrBytes*/, int width, int height, double /*time*/, unsigned int /*frameNr*/)
+{
+	((KeyframeDetector*)user)->addFrame(data, width, height);
+}
@@ -0,0 +1,75 @@
+/***************************************************
+This is the header file for the keyframe detector, the
+native version of extract_keyframes.m.
+
+Every frame is summarised by a histogram of its HSV values
+(16 hue, 4 saturation and 4 value bins, side by side) and
+the histograms of a sliding window of frames form a matrix
+whose rank is the number of singular values above threshold
+times the largest one.  A keyframe is where the rank rises
+and then falls again: the last frame of the first window
+of higher rank.
+
+The frames are given one at a time, as they are decoded, so
+a video is read once whatever its length.  The histograms
+are those of colorspace('RGB->HSV') and imhist: the hue is
+in degrees but binned over [0,1] as the other channels, so
+the hue histogram mostly counts the almost pure reds.  With
+a step larger than 1 only one pixel in step along x and y
+is counted, which changes the histograms and may change the
+keyframes.
+
+The rank is not computed by an SVD of every window: the
+squared singular values are the eigenvalues of the Gram
+matrix of the window (window x window), of which only the
+row and column of the frame that comes in change from one
+window to the next.  The histograms are counts, so the Gram
+matrix is exact.
+**************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+class KeyframeDetector
+{
+public:
+	KeyframeDetector();
+
+	// the settings of extract_keyframes.m are 0.05, 12 and 1; forgets the frames
+	int setOptions(double threshold, int window, int step);
+	void reset();
+	// an RGB24 frame, interleaved
+	void addFrame(const uint8_t* data, int width, int height);
+	// the keyframes found so far, numbered from 1
+	const std::vector<unsigned int>& getKeyframes() const { return keyframes; }
+
+	enum { H_BINS = 16, S_BINS = 4, V_BINS = 4, NB_BINS = H_BINS+S_BINS+V_BINS };
+
+private:
+	void histogram(const uint8_t* data, int width, int height, int64_t* hist);
+	int rank();
+	void addRank(int r);
+
+	double threshold;
+	int window, step;
+
+	// bins by value (the largest channel), and by largest and smallest channel
+	uint8_t valueBins[256];
+	std::vector<uint8_t> saturationBins;
+
+	// the histograms of the last window frames, a ring, and their dot products
+	std::vector<int64_t> histograms;
+	std::vector<double> gram;
+	unsigned int nbFrames;
+
+	// the state of the search, as in extract_keyframes.m
+	unsigned int nbWindows;
+	int previousRank, nextRank;
+	unsigned int possibility;
+	std::vector<unsigned int> keyframes;
+};
+
+// a FrameCallback of FFGrabber, user is the KeyframeDetector
+void keyframeCallback(void* user, const uint8_t* data, unsigned int nrBytes, int width, int height, double time, unsigned int frameNr);
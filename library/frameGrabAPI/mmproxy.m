@@ -0,0 +1,82 @@
+function proxy = mmproxy(filename, frames, scale, trySeeking)
+% proxy = mmproxy(filename, frames, scale, trySeeking)
+% mmproxy reads downscaled copies of video frames, for previews and the
+% interactive selection of a ROI.  The frames are averaged over scale x
+% scale blocks and kept next to the video in filename.<scale>.proxy: the
+% next calls only decode the frames it does not hold yet (and not those
+% past the end of the video), and it is rebuilt when the video changes
+% (see FFGrab('getProxy',scale,frames)).
+%
+% INPUT
+% filename      the video file
+% frames        the frame numbers (from 1, as mmread), default [] for all
+% scale         [4] the downscaling factor, a whole number
+% trySeeking    [true] as mmread
+%
+% OUTPUT
+% proxy is a struct with the following fields:
+%   width, height   of the proxy frames
+%   scale           the downscaling factor
+%   frames          a struct array with the field cdata, as mmread
+%   frameNrs        the number of every frame in the video (the frames past
+%                   the end of the video are left out)
+%   times           the time stamp of every frame
+%   toFrame         rect = proxy.toFrame(rect) maps [x y] points or imcrop
+%                   rectangles [xmin ymin width height] of the proxy (as
+%                   getrect gives) exactly onto the video frames
+%
+% EXAMPLE
+% proxy = mmproxy('mymovie.mpg',1);
+% imshow(proxy.frames(1).cdata);
+% roiPosition = proxy.toFrame(getrect(gcf));
+
+if nargin < 4
+    trySeeking = true;
+    if nargin < 3
+        scale = 4;
+        if nargin < 2
+            frames = [];
+        end
+    end
+end
+if scale < 1 || scale ~= round(scale)
+    error('scale must be a whole number, at least 1');
+end
+
+currentdir = pwd;
+try
+    if ~ispc
+        cd(fileparts(mfilename('fullpath'))); % FFGrab searches for AVbin in the current directory
+    end
+
+    FFGrab('build',filename,0,1,double(trySeeking));
+    FFGrab('setMatlabCommand','');
+    [cdata, frameNrs, times] = FFGrab('getProxy',scale,double(frames));
+    FFGrab('cleanUp');
+catch
+    err = lasterror;
+    try
+        FFGrab('cleanUp');
+    catch
+    end
+    cd(currentdir);
+    rethrow(err);
+end
+cd(currentdir);
+
+proxy.width = size(cdata,2);
+proxy.height = size(cdata,1);
+proxy.scale = scale;
+proxy.frames = struct('cdata',reshape(num2cell(cdata,[1 2 3]),1,[]));
+proxy.frameNrs = frameNrs;
+proxy.times = times;
+proxy.toFrame = @(rect) proxyToFrame(rect, scale);
+
+
+% pixel x of the proxy covers pixels (x-1)*scale+1 to x*scale of the frame:
+% a position x is (x-0.5)*scale+0.5 there, a size is scale times larger
+function rect = proxyToFrame(rect, scale)
+rect(:,1:2) = (rect(:,1:2) - 0.5)*scale + 0.5;
+if size(rect,2) == 4
+    rect(:,3:4) = rect(:,3:4)*scale;
+end
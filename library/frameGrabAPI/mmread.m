@@ -80,6 +80,71 @@ function [video, audio] = mmread(filename, frames, time, disableVideo, disableAu
 % If there are multiple video or audio streams, then the structure will be
 % of length > 1.  For example: audio(1).data and audio(2).data.
 %
+% Successive calls normally reopen the file.  After FFGrab('setPersistent',1)
+% the file and its decoders stay open between calls on the same (unchanged)
+% file, and a call asking for frames or times after those of the previous
+% call (a time window may start where the last one stopped) decodes on from
+% there instead of starting over, so reading a long video window after
+% window costs one pass.  With audio, or after a call that seeked, the file
+% is read from the start again.  FFGrab('setPersistent',0) closes the file.
+%
+% FFGrab('setCache',megabytes) keeps the decoded frames of the calls that
+% ask for frame numbers (up to that much memory, the least recently used
+% are dropped), so analysing the same frames again does not decode them;
+% [hits, misses, nrFrames, bytes] = FFGrab('getCacheStats').
+%
+% For videos too large for that, FFGrab('setFrameStore',storeFile,roi,
+% firstChannel) keeps the decoded frames in storeFile instead, optionally
+% cropped to roi ([xmin ymin width height], as imcrop, [] for the whole
+% frame) and reduced to their first channel; later calls read the frames
+% it holds from it (memory-mapped) as long as the video is unchanged.
+% The frames returned are then in the format of the store.
+% FFGrab('setFrameStore','') stops using it.
+%
+% [nrFrames, times, keyframes, offsets] = FFGrab('probe',id) reads the
+% packets of video stream id (from 0) without decoding them, once per file:
+% the exact number of frames (getVideoInfo then reports it too), the time
+% of every frame in presentation order, whether it is a keyframe and its
+% byte offset in the file (-1 when unknown).  The keyframes also let the
+% next calls asking for frame numbers skip decoding up to the keyframe
+% before them.  frameNrs = FFGrab('frameAtTime',id,times) gives the number
+% (from 1, in presentation order) of the frame shown at each time, 0 before
+% the first frame, by a binary search of the same index.
+%
+% stats = FFGrab('getStats') tells where the calls spent their time since
+% FFGrab('resetStats'): the seconds and number of calls of every stage
+% (capture, demux, decode, convert, copy, callback, seek, stats, as fields such
+% as decodeSeconds and decodeCalls) and the packets read and decoded, the
+% frames kept and the bytes allocated.  FFGrab('setTrace',traceFile) also
+% writes every timed interval to traceFile after each call, as Chrome trace
+% events (open it in chrome://tracing or ui.perfetto.dev);
+% FFGrab('setTrace','') stops tracing.
+%
+% FFGrab('setFrameStats',stats,histogramBins,thumbnailSize,roi,keepFrames)
+% computes statistics of every frame the next calls decode, including the
+% frames that are not returned: stats is a string of mean, variance (of
+% each channel), histogram (histogramBins [16] per channel), thumbnail (the
+% means of [width height] [8 8] blocks, RGB) and sad (the sum of absolute
+% differences of roi [whole frame], as imcrop, with the previous frame).
+% With keepFrames false [true] the frames are only decoded for them, so a
+% whole video is scanned without returning any.  The cache and the frame
+% store are not used meanwhile.  [stats, frameNrs, times] =
+% FFGrab('getFrameStats',id) returns them for video stream id (from 0) as
+% one single column per frame, in the order above, until the next call.
+% FFGrab('setFrameStats','') stops computing them.
+%
+% [frames, frameNrs, times] = FFGrab('getProxy',scale,frameNrs) returns
+% the frames of the first video stream averaged over scale x scale blocks
+% (height x width x 3 x frames, all the frames when frameNrs is empty) and
+% keeps them in filename.<scale>.proxy, next to the video, for the next
+% calls: only the frames it does not hold yet are decoded (and not those
+% past the end of the video).  See mmproxy.m, which also maps the
+% coordinates back to the frames.
+%
+% indices = FFGrab('extractKeyframes',threshold,window,step) reads all the
+% frames once and returns the keyframes found by the sliding window rank of
+% their HSV histograms, see extract_keyframes.m.
+%
 % EXAMPLES
 % [video, audio] = mmread('chimes.wav'); % read whole wav file
 % wavplay(audio.data,audio.rate);
@@ -200,7 +265,8 @@ if useFFGRAB
                         warning('mmread:getVideoFrame',['Frame ' num2str(f) ' could not be decoded']);
                     else
                         % the data ordering is wrong for matlab images, so permute it
-                        data = permute(reshape(data, 3, width, height),[3 2 1]);
+                        % (frames from a frame store may have a single channel)
+                        data = permute(reshape(data, numel(data)/(width*height), width, height),[3 2 1]);
                         video(i).frames(f).cdata = data;
                         video(i).times(f) = time;
                     end
@@ -0,0 +1,285 @@
+/***************************************************
+Bit-packed binary images and morphology, see
+BinaryImage.h.
+**************************************************/
+
+#include "BinaryImage.h"
+
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+using namespace std;
+
+static inline int countTrailingZeros(uint64_t w)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, w);
+	return (int)index;
+#else
+	return __builtin_ctzll(w);
+#endif
+}
+
+static inline uint64_t lastWordMask(int length)
+{
+	return length%64 ? (((uint64_t)1 << (length%64))-1) : ~(uint64_t)0;
+}
+
+// word w of the line shifted by d: bit b is bit w*64+b+d of the line, 0 outside
+static inline uint64_t shiftedWord(const uint64_t* in, int nbWords, int w, int d)
+{
+	int q = d >= 0 ? d/64 : -((-d+63)/64);
+	int r = d-64*q;
+	int src = w+q;
+	uint64_t lo = (src >= 0 && src < nbWords) ? in[src] : 0;
+	if (r == 0) return lo;
+	uint64_t hi = (src+1 >= 0 && src+1 < nbWords) ? in[src+1] : 0;
+	return (lo >> r) | (hi << (64-r));
+}
+
+int wordsPerLine(int length)
+{
+	return (length+63)/64;
+}
+
+int countSlices(int maxCount)
+{
+	int slices = 1;
+	while ((maxCount >> slices) > 0) slices++;
+	return slices;
+}
+
+void packLine(const uint8_t* data, ptrdiff_t stride, int length, int cut, uint64_t* out)
+{
+	for (int w=0; w*64<length; w++)
+	{
+		int n = length-w*64 < 64 ? length-w*64 : 64;
+		const uint8_t* p = data + (ptrdiff_t)w*64*stride;
+		uint64_t word = 0;
+		for (int b=0; b<n; b++) word |= (uint64_t)(p[b*stride] > cut) << b;
+		out[w] = word;
+	}
+}
+
+void unpackLine(const uint64_t* in, int length, uint8_t* data, ptrdiff_t stride)
+{
+	for (int u=0; u<length; u++) data[u*stride] = (in[u/64] >> (u%64)) & 1;
+}
+
+void orLines(const uint64_t* const* rows, int nbRows, int nbWords, uint64_t* out)
+{
+	memset(out,0,nbWords*sizeof(uint64_t));
+	for (int r=0; r<nbRows; r++)
+	{
+		if (!rows[r]) continue;
+		for (int w=0; w<nbWords; w++) out[w] |= rows[r][w];
+	}
+}
+
+void orShifts(const uint64_t* in, int nbWords, int length, int d0, int d1, uint64_t* out)
+{
+	for (int w=0; w<nbWords; w++)
+	{
+		uint64_t word = 0;
+		for (int d=d0; d<=d1; d++) word |= shiftedWord(in,nbWords,w,d);
+		out[w] = word;
+	}
+	if (nbWords > 0) out[nbWords-1] &= lastWordMask(length);
+}
+
+void countAbove(const uint64_t* const* rows, int nbRows, int nbWords, int length, int d0, int d1, int threshold, uint64_t* scratch, uint64_t* out)
+{
+	int maxCount = nbRows*(d1-d0+1);
+	if (threshold >= maxCount)
+	{
+		memset(out,0,nbWords*sizeof(uint64_t));
+		return;
+	}
+	int slices = countSlices(maxCount);
+
+	// count down the rows: slice k of word w is scratch[k*nbWords+w]
+	memset(scratch,0,slices*nbWords*sizeof(uint64_t));
+	for (int r=0; r<nbRows; r++)
+	{
+		if (!rows[r]) continue;
+		for (int w=0; w<nbWords; w++)
+		{
+			uint64_t carry = rows[r][w];
+			for (int k=0; k<slices && carry; k++)
+			{
+				uint64_t t = scratch[k*nbWords+w] & carry;
+				scratch[k*nbWords+w] ^= carry;
+				carry = t;
+			}
+		}
+	}
+
+	// add the shifted column counts along the line and compare with threshold
+	uint64_t sum[32];
+	for (int w=0; w<nbWords; w++)
+	{
+		memset(sum,0,slices*sizeof(uint64_t));
+		for (int d=d0; d<=d1; d++)
+		{
+			uint64_t carry = 0;
+			for (int k=0; k<slices; k++)
+			{
+				uint64_t a = sum[k], b = shiftedWord(&scratch[k*nbWords],nbWords,w,d);
+				sum[k] = a ^ b ^ carry;
+				carry = (a & b) | (carry & (a ^ b));
+			}
+		}
+
+		uint64_t greater = 0, equal = ~(uint64_t)0;
+		for (int k=slices-1; k>=0; k--)
+		{
+			uint64_t t = ((threshold >> k) & 1) ? ~(uint64_t)0 : 0;
+			greater |= equal & sum[k] & ~t;
+			equal &= ~(sum[k] ^ t);
+		}
+		out[w] = greater;
+	}
+	if (nbWords > 0) out[nbWords-1] &= lastWordMask(length);
+}
+
+void findRuns(const uint64_t* line, int nbWords, int length, vector<pair<int,int> > &runs)
+{
+	int w = 0;
+	uint64_t word = nbWords > 0 ? line[0] : 0;
+	while (true)
+	{
+		// next set pixel
+		while (!word)
+		{
+			if (++w >= nbWords) return;
+			word = line[w];
+		}
+		int start = w*64 + countTrailingZeros(word);
+
+		// next clear pixel
+		word = ~word & (~(uint64_t)0 << (start%64));
+		while (!word)
+		{
+			if (++w >= nbWords) break;
+			word = ~line[w];
+		}
+		int end = w < nbWords ? w*64 + countTrailingZeros(word) : length;
+		runs.push_back(make_pair(start,end-1));
+		if (end >= length) return;
+
+		word = line[w] & (~(uint64_t)0 << (end%64));
+	}
+}
+
+BinaryImage::BinaryImage()
+{
+	width = height = nbWords = 0;
+}
+
+BinaryImage::BinaryImage(int width, int height)
+{
+	resize(width,height);
+}
+
+void BinaryImage::resize(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	nbWords = wordsPerLine(width);
+	bits.assign((size_t)nbWords*height,0);
+}
+
+void BinaryImage::clear()
+{
+	fill(bits.begin(),bits.end(),0);
+}
+
+bool BinaryImage::get(int x, int y) const
+{
+	return (line(y)[x/64] >> (x%64)) & 1;
+}
+
+void BinaryImage::set(int x, int y, bool value)
+{
+	uint64_t bit = (uint64_t)1 << (x%64);
+	if (value) line(y)[x/64] |= bit;
+	else line(y)[x/64] &= ~bit;
+}
+
+void BinaryImage::pack(const uint8_t* data, ptrdiff_t xStride, ptrdiff_t yStride, int cut)
+{
+	for (int y=0; y<height; y++) packLine(data+y*yStride,xStride,width,cut,line(y));
+}
+
+void BinaryImage::unpack(uint8_t* data, ptrdiff_t xStride, ptrdiff_t yStride) const
+{
+	for (int y=0; y<height; y++) unpackLine(line(y),width,data+y*yStride,xStride);
+}
+
+// out(x,y) is the OR of the pixels (x+c0..x+c1, y+r0..y+r1), optionally on the complemented images
+void BinaryImage::orFilter(BinaryImage &out, int r0, int r1, int c0, int c1, bool complement) const
+{
+	BinaryImage source;
+	const BinaryImage* in = this;
+	if (complement || &out == this)
+	{
+		source = *this;
+		if (complement)
+		{
+			for (size_t i=0; i<source.bits.size(); i++) source.bits[i] = ~source.bits[i];
+			for (int y=0; y<height && nbWords>0; y++) source.line(y)[nbWords-1] &= lastWordMask(width);
+		}
+		in = &source;
+	}
+	out.resize(width,height);
+
+	vector<const uint64_t*> rows(r1-r0+1);
+	vector<uint64_t> vertical(nbWords);
+	for (int y=0; y<height; y++)
+	{
+		for (int r=r0; r<=r1; r++) rows[r-r0] = (y+r >= 0 && y+r < height) ? in->line(y+r) : NULL;
+		orLines(&rows[0],rows.size(),nbWords,&vertical[0]);
+		orShifts(&vertical[0],nbWords,width,c0,c1,out.line(y));
+		if (complement)
+		{
+			uint64_t* o = out.line(y);
+			for (int w=0; w<nbWords; w++) o[w] = ~o[w];
+			if (nbWords > 0) o[nbWords-1] &= lastWordMask(width);
+		}
+	}
+}
+
+void BinaryImage::dilate(BinaryImage &out, int rows, int cols) const
+{
+	int r0 = 1-(rows+1)/2, c0 = 1-(cols+1)/2;
+	orFilter(out,-(rows+r0-1),-r0,-(cols+c0-1),-c0,false);
+}
+
+void BinaryImage::erode(BinaryImage &out, int rows, int cols) const
+{
+	int r0 = 1-(rows+1)/2, c0 = 1-(cols+1)/2;
+	orFilter(out,r0,rows+r0-1,c0,cols+c0-1,true);
+}
+
+void BinaryImage::median(BinaryImage &out, int rows, int cols) const
+{
+	BinaryImage source;
+	const BinaryImage* in = this;
+	if (&out == this)
+	{
+		source = *this;
+		in = &source;
+	}
+	out.resize(width,height);
+
+	int r0 = 1-(rows+1)/2, c0 = 1-(cols+1)/2;
+	vector<const uint64_t*> lines(rows);
+	vector<uint64_t> scratch(countSlices(rows*cols)*nbWords);
+	for (int y=0; y<height; y++)
+	{
+		for (int r=0; r<rows; r++) lines[r] = (y+r0+r >= 0 && y+r0+r < height) ? in->line(y+r0+r) : NULL;
+		countAbove(&lines[0],rows,nbWords,width,c0,cols+c0-1,rows*cols/2,&scratch[0],out.line(y));
+	}
+}
@@ -0,0 +1,81 @@
+/***************************************************
+This is the header file for the bit-packed binary images
+of the blob tracker.
+
+A line of a binary image is stored 64 pixels per word,
+pixel u in bit u%64 of word u/64, and the bits past the
+end of the line are always 0.  Dilation, erosion and the
+median (majority) filter then work on 64 pixels at once
+with word operations:
+ - dilation and erosion OR the lines of the neighbourhood
+   together and then OR the line with shifted copies of
+   itself;
+ - the median filter counts the set pixels of the
+   neighbourhood in bit-sliced counters (bit k of the
+   count of 64 pixels in one word per k), first down the
+   rows and then along the line, and compares the counts
+   with half the neighbourhood size.
+The line kernels are used directly by the streaming blob
+tracker, BinaryImage applies them to whole images.
+
+Neighbourhoods follow the image processing toolbox: an
+m x n rectangle is centred on element floor(([m n]+1)/2),
+dilation uses the reflected rectangle as imdilate, pixels
+outside of the image are 0 for dilation and the median
+filter and 1 for erosion (as imerode).
+**************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// number of words for a line of length pixels
+int wordsPerLine(int length);
+// number of bit slices needed to count up to maxCount
+int countSlices(int maxCount);
+
+// bit u of out is set when data[u*stride] > cut
+void packLine(const uint8_t* data, ptrdiff_t stride, int length, int cut, uint64_t* out);
+// writes 0/1 to data[u*stride]
+void unpackLine(const uint64_t* in, int length, uint8_t* data, ptrdiff_t stride);
+// OR of nbRows lines, NULL lines are 0
+void orLines(const uint64_t* const* rows, int nbRows, int nbWords, uint64_t* out);
+// bit u of out is the OR of bits u+d0 .. u+d1 of in
+void orShifts(const uint64_t* in, int nbWords, int length, int d0, int d1, uint64_t* out);
+// bit u of out is set when more than threshold pixels are set in the rows at u+d0 .. u+d1,
+// NULL rows are 0; scratch must hold countSlices(nbRows*(d1-d0+1))*nbWords words
+void countAbove(const uint64_t* const* rows, int nbRows, int nbWords, int length, int d0, int d1, int threshold, uint64_t* scratch, uint64_t* out);
+// appends the [start, end] runs of set pixels of a line
+void findRuns(const uint64_t* line, int nbWords, int length, std::vector<std::pair<int,int> > &runs);
+
+class BinaryImage
+{
+public:
+	BinaryImage();
+	BinaryImage(int width, int height);
+
+	void resize(int width, int height);
+	void clear();
+	bool get(int x, int y) const;
+	void set(int x, int y, bool value);
+	uint64_t* line(int y) { return &bits[(size_t)y*nbWords]; }
+	const uint64_t* line(int y) const { return &bits[(size_t)y*nbWords]; }
+
+	// pixels above cut are set
+	void pack(const uint8_t* data, ptrdiff_t xStride, ptrdiff_t yStride, int cut);
+	void unpack(uint8_t* data, ptrdiff_t xStride, ptrdiff_t yStride) const;
+
+	// imdilate / imerode with strel('rectangle',[rows cols])
+	void dilate(BinaryImage &out, int rows, int cols) const;
+	void erode(BinaryImage &out, int rows, int cols) const;
+	// medfilt2(image, [rows cols]) of a logical image
+	void median(BinaryImage &out, int rows, int cols) const;
+
+	int width, height, nbWords;
+	std::vector<uint64_t> bits;
+
+private:
+	void orFilter(BinaryImage &out, int r0, int r1, int c0, int c1, bool complement) const;
+};
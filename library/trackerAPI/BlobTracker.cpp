@@ -0,0 +1,531 @@
+/***************************************************
+This is the native blob tracker.  It fuses the crop,
+threshold, dilate, median filter and blob analysis steps
+of videoTracker.m into one pass over the ROI, see
+BlobTracker.h for the details and the agreement with the
+Matlab pipeline.
+
+The tracker does not depend on Matlab and can be fed with
+frames from FFGrabber (see trackVideo.cpp) or from the
+mexBlobTracker interface.
+**************************************************/
+
+#include "BlobTracker.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <functional>
+using namespace std;
+
+ImageView interleavedView(const uint8_t* data, int width, int height)
+{
+	ImageView view;
+	view.data = data;
+	view.width = width;
+	view.height = height;
+	view.channels = 3;
+	view.xStride = 3;
+	view.yStride = 3*(ptrdiff_t)width;
+	view.cStride = 1;
+	return view;
+}
+
+ImageView matlabView(const uint8_t* data, int width, int height, int channels)
+{
+	ImageView view;
+	view.data = data;
+	view.width = width;
+	view.height = height;
+	view.channels = channels;
+	view.xStride = height;
+	view.yStride = 1;
+	view.cStride = (ptrdiff_t)width*height;
+	return view;
+}
+
+// Matlab's round: halves away from zero
+static int roundHalfAway(double x)
+{
+	return x >= 0 ? (int)floor(x+0.5) : -(int)floor(-x+0.5);
+}
+
+BlobTracker::BlobTracker()
+{
+	// the defaults of videoTracker.m
+	threshold = -1;
+	filterRows = 3;
+	filterCols = 3;
+	blobArea = 200;
+	maxBlobs = 3;
+	// no ROI until setROI is called
+	roi[0] = roi[1] = 0;
+	roi[2] = roi[3] = -1;
+
+	predictionMode = PREDICT_NONE;
+	margin = 10;
+	hasLevel = false;
+	lastLevel = 0;
+	nbWindowed = nbFull = 0;
+
+	x0 = y0 = x1 = y1 = 0;
+	lineLength = nbLines = nbWords = 0;
+}
+
+int BlobTracker::setOptions(double threshold, int filterRows, int filterCols, int blobArea, int maxBlobs)
+{
+	if (threshold > 1 || filterRows < 1 || filterCols < 1 || blobArea < 0 || maxBlobs < 1) return -1;
+
+	this->threshold = threshold;
+	this->filterRows = filterRows;
+	this->filterCols = filterCols;
+	this->blobArea = blobArea;
+	this->maxBlobs = maxBlobs;
+	markers.clear();
+
+	return 0;
+}
+
+int BlobTracker::setThreads(int nbThreads)
+{
+	if (nbThreads < 0) return -1;
+
+	pool.setThreads(nbThreads);
+
+	return 0;
+}
+
+int BlobTracker::setPrediction(int mode, int margin)
+{
+	if (mode < PREDICT_NONE || mode > PREDICT_KALMAN || margin < 0) return -1;
+
+	predictionMode = mode;
+	this->margin = margin;
+	markers.clear();
+	nbWindowed = nbFull = 0;
+
+	return 0;
+}
+
+void BlobTracker::getPredictionStats(int* windowed, int* full)
+{
+	if (!windowed || !full) return;
+
+	*windowed = nbWindowed;
+	*full = nbFull;
+}
+
+int BlobTracker::setThresholdOptions(double maxDrift, int sampling)
+{
+	return otsu.setOptions(maxDrift, sampling);
+}
+
+void BlobTracker::getThresholdStats(int* computed, int* reused)
+{
+	otsu.getStats(computed, reused);
+}
+
+int BlobTracker::setROI(double xmin, double ymin, double width, double height)
+{
+	if (width < 0 || height < 0) return -1;
+	otsu.reset();
+	markers.clear();
+	hasLevel = false;
+
+	roi[0] = xmin;
+	roi[1] = ymin;
+	roi[2] = width;
+	roi[3] = height;
+
+	return 0;
+}
+
+int BlobTracker::getROISize(const ImageView &frame, int* width, int* height)
+{
+	if (!width || !height) return -1;
+
+	int err = clipROI(frame);
+	if (err) return err;
+
+	*width = x1-x0;
+	*height = y1-y0;
+
+	return 0;
+}
+
+int BlobTracker::clipROI(const ImageView &frame)
+{
+	if (roi[2] < 0 || roi[3] < 0)
+	{
+		// no ROI, use the whole frame
+		x0 = 0; x1 = frame.width;
+		y0 = 0; y1 = frame.height;
+	} else {
+		// imcrop keeps the pixels whose centres are inside the rectangle
+		x0 = max(roundHalfAway(roi[0]),1)-1;
+		x1 = min(roundHalfAway(roi[0]+roi[2]),frame.width);
+		y0 = max(roundHalfAway(roi[1]),1)-1;
+		y1 = min(roundHalfAway(roi[1]+roi[3]),frame.height);
+	}
+	if (x1 <= x0 || y1 <= y0) return -3;
+
+	setRegion(frame, x0, y0, x1, y1);
+
+	return 0;
+}
+
+// the part of the frame the pipeline runs over, in frame coordinates
+void BlobTracker::setRegion(const ImageView &frame, int rx0, int ry0, int rx1, int ry1)
+{
+	// walk along the axis that is contiguous in memory
+	alongX = labs(frame.xStride) <= labs(frame.yStride);
+	origin = frame.data + rx0*frame.xStride + ry0*frame.yStride;
+
+	// medfilt2 centres an m x n neighbourhood on element floor(([m n]+1)/2)
+	int rowStart = 1-(filterRows+1)/2, rowEnd = filterRows+rowStart-1;
+	int colStart = 1-(filterCols+1)/2, colEnd = filterCols+colStart-1;
+	if (alongX)
+	{
+		lineLength = rx1-rx0; nbLines = ry1-ry0;
+		uStride = frame.xStride; vStride = frame.yStride;
+		u0 = colStart; u1 = colEnd;
+		v0 = rowStart; v1 = rowEnd;
+	} else {
+		lineLength = ry1-ry0; nbLines = rx1-rx0;
+		uStride = frame.yStride; vStride = frame.xStride;
+		u0 = rowStart; u1 = rowEnd;
+		v0 = colStart; v1 = colEnd;
+	}
+
+	nbWords = wordsPerLine(lineLength);
+	dilateLines = v1-v0+2;
+}
+
+// imbinarize of the first channel, roiBinary(:,:,1)
+void BlobTracker::binariseLine(Stripe &s, int line, int cut)
+{
+	packLine(origin + line*vStride, uStride, lineLength, cut, &s.binaryRing[(line%3)*nbWords]);
+}
+
+// bwmorph 'dilate': 3x3 maximum, pixels outside the ROI are 0
+void BlobTracker::dilateLine(Stripe &s, int line)
+{
+	const uint64_t* rows[3];
+	rows[0] = line > 0 ? &s.binaryRing[((line+2)%3)*nbWords] : NULL;
+	rows[1] = &s.binaryRing[(line%3)*nbWords];
+	rows[2] = line+1 < nbLines ? &s.binaryRing[((line+1)%3)*nbWords] : NULL;
+
+	orLines(rows, 3, nbWords, &s.vertical[0]);
+	orShifts(&s.vertical[0], nbWords, lineLength, -1, 1, &s.dilateRing[(line%dilateLines)*nbWords]);
+}
+
+// medfilt2 with zero padding: a pixel is kept when more than half of its neighbourhood is set
+void BlobTracker::filterLine(Stripe &s, int line)
+{
+	for (int j=line+v0; j<=line+v1; j++)
+	{
+		s.filterRing[j-line-v0] = (j >= 0 && j < nbLines) ? &s.dilateRing[(j%dilateLines)*nbWords] : NULL;
+	}
+	countAbove(&s.filterRing[0], v1-v0+1, nbWords, lineLength, u0, u1, filterRows*filterCols/2, &s.counters[0], &s.filtered[0]);
+}
+
+// lines [first, last) of the ROI, the stripe recomputes the lines above it that its filters need
+void BlobTracker::trackStripe(Stripe &s, int first, int last, int cut, MaskView* mask, bool keepRuns)
+{
+	s.binaryRing.resize(3*nbWords);
+	s.vertical.resize(nbWords);
+	s.dilateRing.resize(dilateLines*nbWords);
+	s.filterRing.resize(v1-v0+1);
+	s.counters.resize(countSlices(filterRows*filterCols)*nbWords);
+	s.filtered.resize(nbWords);
+	s.labels.reset(alongX, keepRuns);
+
+	int nextDilate = max(first+v0,0);
+	int nextBinary = max(nextDilate-1,0);
+	for (int k=first; k<last; k++)
+	{
+		// the median filter of line k needs the dilated lines up to k+v1,
+		// and dilating line j needs the binarised line j+1
+		int needDilate = min(k+v1,nbLines-1);
+		while (nextDilate <= needDilate)
+		{
+			int needBinary = min(nextDilate+1,nbLines-1);
+			for (; nextBinary <= needBinary; nextBinary++) binariseLine(s,nextBinary,cut);
+			dilateLine(s,nextDilate++);
+		}
+
+		filterLine(s,k);
+
+		if (mask)
+		{
+			uint8_t* m = mask->data + (alongX?k*mask->yStride:k*mask->xStride);
+			ptrdiff_t step = alongX?mask->xStride:mask->yStride;
+			unpackLine(&s.filtered[0],lineLength,m,step);
+		}
+
+		s.lineRuns.clear();
+		findRuns(&s.filtered[0], nbWords, lineLength, s.lineRuns);
+		s.labels.addLine(k, s.lineRuns, origin + k*vStride, uStride);
+	}
+}
+
+// blob in 1-based coordinates of the region
+Blob BlobTracker::toBlob(const Component &c)
+{
+	double meanU = c.sumU/c.area, meanV = c.sumV/c.area;
+	// pixels can be set by the dilation with an intensity of 0
+	double weightedU = c.sumI > 0 ? c.sumIU/c.sumI : meanU, weightedV = c.sumI > 0 ? c.sumIV/c.sumI : meanV;
+
+	Blob b;
+	b.area = c.area;
+	if (alongX)
+	{
+		b.centroidX = meanU+1; b.centroidY = meanV+1;
+		b.weightedX = weightedU+1; b.weightedY = weightedV+1;
+		b.bboxX = c.minU+1; b.bboxY = c.minV+1;
+		b.bboxW = c.maxU-c.minU+1; b.bboxH = c.maxV-c.minV+1;
+	} else {
+		b.centroidX = meanV+1; b.centroidY = meanU+1;
+		b.weightedX = weightedV+1; b.weightedY = weightedU+1;
+		b.bboxX = c.minV+1; b.bboxY = c.minU+1;
+		b.bboxW = c.maxV-c.minV+1; b.bboxH = c.maxU-c.minU+1;
+	}
+	return b;
+}
+
+void BlobTracker::collectBlobs(Labelling &labels, vector<Blob> &blobs, LabelView* labelImage)
+{
+	labels.resolve();
+	labels.select(blobArea, maxBlobs, selected);
+
+	for (size_t i=0; i<selected.size(); i++) blobs.push_back(toBlob(labels.components[selected[i]]));
+
+	if (!labelImage) return;
+
+	// 1-based index of the blob, 0 for the background and the blobs that were not reported
+	vector<int> index(labels.components.size(),0);
+	for (size_t i=0; i<selected.size(); i++) index[selected[i]] = i+1;
+
+	ptrdiff_t uStep = alongX?labelImage->xStride:labelImage->yStride;
+	ptrdiff_t vStep = alongX?labelImage->yStride:labelImage->xStride;
+	for (int v=0; v<nbLines; v++)
+	{
+		for (int u=0; u<lineLength; u++) labelImage->data[v*vStep+u*uStep] = 0;
+	}
+	for (size_t i=0; i<labels.runs.size(); i++)
+	{
+		const LabelledRun &run = labels.runs[i];
+		int blob = index[labels.findRoot(run.label)];
+		if (!blob) continue;
+		for (int u=run.start; u<=run.end; u++) labelImage->data[run.line*vStep+u*uStep] = blob;
+	}
+}
+
+// segments a window around the predicted position of every marker, false when a marker
+// is not found inside its window and the whole ROI has to be searched
+bool BlobTracker::trackWindows(const ImageView &frame, vector<Blob> &blobs, double* level, MaskView* mask)
+{
+	// until all the markers are found the whole ROI is searched, for the missing ones to show up
+	if ((int)markers.size() < maxBlobs || (threshold < 0 && !hasLevel)) return false;
+
+	// without the histogram of the whole ROI, keep the level of the last full search
+	double lvl = threshold >= 0 ? threshold : lastLevel;
+	int cut = (int)floor(lvl*255);
+
+	// a pixel of the filtered image depends on the binarised pixels up to halo pixels away
+	int rowStart = 1-(filterRows+1)/2, colStart = 1-(filterCols+1)/2;
+	int halo = 1 + max(max(-rowStart,filterRows+rowStart-1),max(-colStart,filterCols+colStart-1));
+	int roiWidth = x1-x0, roiHeight = y1-y0;
+
+	if (mask)
+	{
+		for (int y=0; y<roiHeight; y++)
+		{
+			for (int x=0; x<roiWidth; x++) mask->data[x*mask->xStride+y*mask->yStride] = 0;
+		}
+	}
+
+	for (size_t i=0; i<markers.size(); i++)
+	{
+		// 0-based ROI coordinates
+		double px = markers[i].x.predict()-1, py = markers[i].y.predict()-1;
+		int wx0 = max((int)floor(px-0.5*markers[i].bboxW-margin),0);
+		int wx1 = min((int)ceil(px+0.5*markers[i].bboxW+margin)+1,roiWidth);
+		int wy0 = max((int)floor(py-0.5*markers[i].bboxH-margin),0);
+		int wy1 = min((int)ceil(py+0.5*markers[i].bboxH+margin)+1,roiHeight);
+		if (wx1 <= wx0 || wy1 <= wy0) return false;
+
+		int sx0 = max(wx0-halo,0), sx1 = min(wx1+halo,roiWidth);
+		int sy0 = max(wy0-halo,0), sy1 = min(wy1+halo,roiHeight);
+		setRegion(frame, x0+sx0, y0+sy0, x0+sx1, y0+sy1);
+
+		MaskView region;
+		if (mask)
+		{
+			regionMask.resize((size_t)(sx1-sx0)*(sy1-sy0));
+			region.data = &regionMask[0];
+			region.xStride = 1;
+			region.yStride = sx1-sx0;
+		}
+		trackStripe(stripes[0], 0, nbLines, cut, mask ? &region : NULL, false);
+		// the halo lacks the pixels around it, only the window is final: the windows of other
+		// markers that overlap it are not overwritten
+		if (mask)
+		{
+			for (int y=wy0; y<wy1; y++)
+			{
+				const uint8_t* m = &regionMask[(size_t)(y-sy0)*(sx1-sx0) + wx0-sx0];
+				for (int x=wx0; x<wx1; x++) mask->data[x*mask->xStride+y*mask->yStride] = *m++;
+			}
+		}
+
+		Labelling &labels = stripes[0].labels;
+		labels.resolve();
+		labels.select(blobArea, labels.components.size(), selected);
+
+		// the blob nearest to the prediction; it must not touch the edge of the window (unless the
+		// edge is the edge of the ROI), or it could be cut or merged with pixels outside the window
+		int best = -1;
+		double bestDistance = 0;
+		Blob found;
+		for (size_t j=0; j<selected.size(); j++)
+		{
+			Blob b = toBlob(labels.components[selected[j]]);
+			b.centroidX += sx0; b.centroidY += sy0;
+			b.weightedX += sx0; b.weightedY += sy0;
+			b.bboxX += sx0; b.bboxY += sy0;
+
+			int bx0 = b.bboxX-1, bx1 = bx0+b.bboxW, by0 = b.bboxY-1, by1 = by0+b.bboxH;
+			if ((bx0 <= wx0 && wx0 > 0) || (bx1 >= wx1 && wx1 < roiWidth)) continue;
+			if ((by0 <= wy0 && wy0 > 0) || (by1 >= wy1 && wy1 < roiHeight)) continue;
+
+			double dx = b.centroidX-1-px, dy = b.centroidY-1-py;
+			if (best < 0 || dx*dx+dy*dy < bestDistance)
+			{
+				best = j;
+				bestDistance = dx*dx+dy*dy;
+				found = b;
+			}
+		}
+		if (best < 0) return false;
+
+		// two markers cannot share a blob
+		for (size_t j=0; j<blobs.size(); j++)
+		{
+			if (blobs[j].bboxX == found.bboxX && blobs[j].bboxY == found.bboxY && blobs[j].area == found.area) return false;
+		}
+		blobs.push_back(found);
+	}
+
+	if (level) *level = lvl;
+	for (size_t i=0; i<markers.size(); i++) updateMarker(markers[i], blobs[i]);
+
+	return true;
+}
+
+void BlobTracker::updateMarker(Marker &marker, const Blob &blob)
+{
+	marker.x.update(blob.centroidX);
+	marker.y.update(blob.centroidY);
+	marker.bboxW = blob.bboxW;
+	marker.bboxH = blob.bboxH;
+}
+
+// after a full search: the blobs are put in the order of the markers they are nearest to,
+// new markers are started when the number of blobs changes
+void BlobTracker::updateMarkers(vector<Blob> &blobs)
+{
+	if (markers.size() != blobs.size())
+	{
+		markers.resize(blobs.size());
+		for (size_t i=0; i<blobs.size(); i++)
+		{
+			markers[i].x.reset(predictionMode, blobs[i].centroidX);
+			markers[i].y.reset(predictionMode, blobs[i].centroidY);
+			markers[i].bboxW = blobs[i].bboxW;
+			markers[i].bboxH = blobs[i].bboxH;
+		}
+		return;
+	}
+
+	// greedy assignment, nearest pairs first
+	vector<pair<double,pair<int,int> > > pairs;
+	for (size_t i=0; i<markers.size(); i++)
+	{
+		double px = markers[i].x.predict(), py = markers[i].y.predict();
+		for (size_t j=0; j<blobs.size(); j++)
+		{
+			double dx = blobs[j].centroidX-px, dy = blobs[j].centroidY-py;
+			pairs.push_back(make_pair(dx*dx+dy*dy,make_pair((int)i,(int)j)));
+		}
+	}
+	sort(pairs.begin(),pairs.end());
+
+	vector<int> assigned(markers.size(),-1);
+	vector<bool> taken(blobs.size(),false);
+	for (size_t k=0; k<pairs.size(); k++)
+	{
+		int i = pairs[k].second.first, j = pairs[k].second.second;
+		if (assigned[i] >= 0 || taken[j]) continue;
+		assigned[i] = j;
+		taken[j] = true;
+	}
+
+	vector<Blob> ordered(blobs.size());
+	for (size_t i=0; i<markers.size(); i++)
+	{
+		ordered[i] = blobs[assigned[i]];
+		updateMarker(markers[i], ordered[i]);
+	}
+	blobs.swap(ordered);
+}
+
+int BlobTracker::track(const ImageView &frame, vector<Blob> &blobs, double* level, MaskView* mask, LabelView* labels)
+{
+	blobs.clear();
+	if (!frame.data || frame.channels < 1) return -1;
+
+	int err = clipROI(frame);
+	if (err) return err;
+
+	if (predictionMode != PREDICT_NONE && !labels)
+	{
+		if (stripes.empty()) stripes.resize(1);
+		if (trackWindows(frame, blobs, level, mask))
+		{
+			nbWindowed++;
+			return 0;
+		}
+		// a marker is lost, search the whole ROI
+		blobs.clear();
+		clipROI(frame);
+	}
+
+	// graythresh uses all channels of the ROI
+	double lvl = threshold >= 0 ? threshold : otsu.level(origin, lineLength, nbLines, uStride, vStride, frame.channels, frame.cStride);
+	if (level) *level = lvl;
+	// imbinarize keeps the pixels strictly above level*255
+	int cut = (int)floor(lvl*255);
+
+	// stripes of at least minStripeLines lines, the first one on the calling thread
+	int nbStripes = max(min(pool.size(),nbLines/minStripeLines),1);
+	if ((int)stripes.size() < nbStripes) stripes.resize(nbStripes);
+
+	bool keepRuns = labels != NULL;
+	pool.run(nbStripes, [&](int i) {
+		trackStripe(stripes[i], (int)((long long)nbLines*i/nbStripes), (int)((long long)nbLines*(i+1)/nbStripes), cut, mask, keepRuns);
+	});
+
+	// join the stripes across their boundaries
+	for (int i=1; i<nbStripes; i++) stripes[0].labels.append(stripes[i].labels);
+
+	collectBlobs(stripes[0].labels, blobs, labels);
+
+	lastLevel = lvl;
+	hasLevel = true;
+	nbFull++;
+	if (predictionMode != PREDICT_NONE) updateMarkers(blobs);
+
+	return 0;
+}
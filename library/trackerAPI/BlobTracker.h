@@ -0,0 +1,196 @@
+/***************************************************
+This is the header file for the native blob tracker.
+
+The tracker replaces the per-frame image pipeline of
+videoTracker.m (imcrop, graythresh, imbinarize, bwmorph
+'dilate', medfilt2 and vision.BlobAnalysis) by a single
+streaming pass over the region of interest.  Frames can
+come from FFGrabber (interleaved RGB24) or directly from
+Matlab (planar, column-major HxWx3 uint8).
+
+The pipeline only keeps a handful of lines of the ROI in
+memory: the crop is never copied, the binarised and
+dilated images live in small ring buffers of bit-packed
+lines (64 pixels per word, see BinaryImage.h) and the
+median filter counts the neighbourhood with bit-sliced
+counters.  Connected components are labelled on the fly
+from the runs of the filtered lines, so the full-size
+intermediates that Matlab allocates are never
+materialised.
+
+Large ROIs are cut into stripes of consecutive lines that
+run through the whole pipeline on their own thread (of a
+pool created once, see WorkerPool.h); each
+stripe recomputes the few lines above it that the dilate
+and median filters need, and the components are joined
+across the stripe boundaries afterwards (see Labelling.h).
+
+With a prediction mode (see Prediction.h) the markers
+found by a search of the whole ROI are followed from frame
+to frame: only a window around the predicted position of
+each marker (its last bounding box plus a margin) is
+segmented, with the level of the last full search when the
+threshold is computed per frame.  The whole ROI is searched
+again as soon as a marker is not found inside its window,
+so the work per frame scales with the number of markers
+and the window area rather than with the ROI.  Blobs are
+then reported in the order of the markers.  They are the
+blobs a full search with the same level finds; with a
+threshold computed per frame, a full search of that frame
+can find slightly different ones, as its level drifts.
+
+Agreement with the Matlab pipeline:
+ - the binary mask is bit-identical for odd median filter
+   sizes, so centroids agree to floating point rounding
+   (better than 1e-9 pixels);
+ - for even median filter sizes medfilt2 averages the two
+   middle values, the tracker keeps a pixel when more than
+   half of its neighbourhood is set.  Blobs can then differ
+   by a pixel along their edge, which moves the centroid by
+   at most 1/area pixels (< 0.01 pixels for blobArea = 200).
+**************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Threshold.h"
+#include "BinaryImage.h"
+#include "Labelling.h"
+#include "Prediction.h"
+#include "WorkerPool.h"
+
+// An 8 bit image with arbitrary strides (in bytes).
+struct ImageView
+{
+	const uint8_t* data;
+	int width, height, channels;
+	ptrdiff_t xStride, yStride, cStride;
+};
+
+// interleaved RGB24 frame, as returned by FFGrabber::getVideoFrame
+ImageView interleavedView(const uint8_t* data, int width, int height);
+// planar column-major frame, as a Matlab HxWxC uint8 array
+ImageView matlabView(const uint8_t* data, int width, int height, int channels);
+
+// Writable mask of the ROI size, 0/1 per pixel.
+struct MaskView
+{
+	uint8_t* data;
+	ptrdiff_t xStride, yStride;
+};
+
+// Writable label image of the ROI size, 1-based index of the blob per pixel.
+struct LabelView
+{
+	int32_t* data;
+	ptrdiff_t xStride, yStride;
+};
+
+struct Blob
+{
+	// 1-based ROI coordinates, as vision.BlobAnalysis
+	double centroidX, centroidY;
+	// centroid weighted by the intensity of the first channel
+	double weightedX, weightedY;
+	int bboxX, bboxY, bboxW, bboxH;
+	int area;
+};
+
+class BlobTracker
+{
+public:
+	BlobTracker();
+
+	// threshold in [0,1], or negative to use Otsu's method on every frame (graythresh)
+	// filterRows x filterCols is the medfilt2 neighbourhood
+	// blobArea and maxBlobs are the MinimumBlobArea and MaximumCount of vision.BlobAnalysis
+	int setOptions(double threshold, int filterRows, int filterCols, int blobArea, int maxBlobs);
+	// when the threshold is computed per frame: reuse the previous level while the histogram
+	// drifts less than maxDrift, and count every sampling-th pixel only (see Threshold.h)
+	int setThresholdOptions(double maxDrift, int sampling);
+	// number of stripes the ROI is tracked in parallel with, 0 for one per core
+	int setThreads(int nbThreads);
+	// PredictionMode and the margin (in pixels) added around the last bounding box of a marker
+	int setPrediction(int mode, int margin);
+	// number of frames tracked in the predicted windows and with a search of the whole ROI
+	void getPredictionStats(int* windowed, int* full);
+	void getThresholdStats(int* computed, int* reused);
+	// rect as returned by getrect: [xmin ymin width height] in 1-based pixel coordinates
+	int setROI(double xmin, double ymin, double width, double height);
+	// size of the ROI once clipped to the frame, which is the size of the mask
+	int getROISize(const ImageView &frame, int* width, int* height);
+
+	// mask is optional, it receives the filtered binary image of the ROI,
+	// labels is optional, it receives the index of the blob in blobs (1-based) or 0
+	int track(const ImageView &frame, std::vector<Blob> &blobs, double* level, MaskView* mask = NULL, LabelView* labels = NULL);
+
+private:
+	// the scratch buffers of one stripe, reused from frame to frame
+	struct Stripe
+	{
+		std::vector<uint64_t> binaryRing; // 3 lines
+		std::vector<uint64_t> vertical;
+		std::vector<uint64_t> dilateRing; // v1-v0+2 lines
+		std::vector<const uint64_t*> filterRing; // the v1-v0+1 lines of the median filter
+		std::vector<uint64_t> counters;
+		std::vector<uint64_t> filtered;
+		std::vector<std::pair<int,int> > lineRuns;
+		Labelling labels;
+	};
+	// smaller stripes are not worth a thread
+	static const int minStripeLines = 64;
+
+	struct Marker
+	{
+		MotionPredictor x, y;
+		int bboxW, bboxH;
+	};
+
+	int clipROI(const ImageView &frame);
+	void setRegion(const ImageView &frame, int rx0, int ry0, int rx1, int ry1);
+	void binariseLine(Stripe &s, int line, int cut);
+	void dilateLine(Stripe &s, int line);
+	void filterLine(Stripe &s, int line);
+	void trackStripe(Stripe &s, int first, int last, int cut, MaskView* mask, bool keepRuns);
+	Blob toBlob(const Component &c);
+	void collectBlobs(Labelling &labels, std::vector<Blob> &blobs, LabelView* labelImage);
+	bool trackWindows(const ImageView &frame, std::vector<Blob> &blobs, double* level, MaskView* mask);
+	void updateMarker(Marker &marker, const Blob &blob);
+	void updateMarkers(std::vector<Blob> &blobs);
+
+	// options
+	double threshold;
+	int filterRows, filterCols;
+	int blobArea, maxBlobs;
+	double roi[4];
+	int predictionMode, margin;
+	WorkerPool pool;
+
+	// ROI in frame coordinates (0-based, inclusive start, exclusive end)
+	int x0, y0, x1, y1;
+	// the pipeline walks the ROI (or a window of it) line by line along the contiguous axis of the frame:
+	// u runs along a line, v across lines
+	bool alongX;
+	int lineLength, nbLines;
+	const uint8_t* origin;
+	ptrdiff_t uStride, vStride;
+	// medfilt2 neighbourhood offsets along u and v
+	int u0, u1, v0, v1;
+	// words per packed line, lines in the dilate ring
+	int nbWords, dilateLines;
+
+	std::vector<Stripe> stripes;
+	std::vector<int> selected;
+	// the mask of the search region of a window, halo included
+	std::vector<uint8_t> regionMask;
+	OtsuThreshold otsu;
+
+	// markers followed with the prediction, the level of the last full search
+	std::vector<Marker> markers;
+	bool hasLevel;
+	double lastLevel;
+	int nbWindowed, nbFull;
+};
@@ -0,0 +1,323 @@
+/***************************************************
+This is the subset correlation tracker, see
+CorrelationTracker.h.
+
+Like the blob tracker it does not depend on Matlab, the
+matlab interface is mexCorrelationTracker.
+**************************************************/
+
+#include "CorrelationTracker.h"
+
+#include <math.h>
+#include <algorithm>
+using namespace std;
+
+void CorrelationTracker::Pyramid::build(const ImageView &frame, int x0, int y0, int x1, int y1, int nbLevels)
+{
+	this->x0 = x0;
+	this->y0 = y0;
+	widths.resize(nbLevels);
+	heights.resize(nbLevels);
+	levels.resize(nbLevels);
+
+	// level 0: mean of the channels
+	int w = x1-x0, h = y1-y0;
+	widths[0] = w;
+	heights[0] = h;
+	levels[0].resize((size_t)w*h);
+	float scale = 1.0f/frame.channels;
+	for (int y=0; y<h; y++)
+	{
+		const uint8_t* line = frame.data + (x0*frame.xStride) + (y0+y)*frame.yStride;
+		float* out = &levels[0][(size_t)y*w];
+		for (int x=0; x<w; x++)
+		{
+			int sum = 0;
+			for (int c=0; c<frame.channels; c++) sum += line[x*frame.xStride + c*frame.cStride];
+			out[x] = sum*scale;
+		}
+	}
+
+	// 2x2 averages
+	for (int l=1; l<nbLevels; l++)
+	{
+		int pw = widths[l-1], ph = heights[l-1];
+		w = max(pw/2,1);
+		h = max(ph/2,1);
+		widths[l] = w;
+		heights[l] = h;
+		levels[l].resize((size_t)w*h);
+		for (int y=0; y<h; y++)
+		{
+			for (int x=0; x<w; x++)
+			{
+				levels[l][(size_t)y*w+x] = 0.25f*(at(l-1,2*x,2*y) + at(l-1,2*x+1,2*y) + at(l-1,2*x,2*y+1) + at(l-1,2*x+1,2*y+1));
+			}
+		}
+	}
+}
+
+float CorrelationTracker::Pyramid::at(int level, int x, int y) const
+{
+	x = min(max(x,0),widths[level]-1);
+	y = min(max(y,0),heights[level]-1);
+	return levels[level][(size_t)y*widths[level]+x];
+}
+
+// pixel i of a level covers the 2^level pixels of level 0 from origin + i*2^level
+double CorrelationTracker::Pyramid::toLevel(int level, double p, int origin)
+{
+	double s = 1 << level;
+	return (p - origin - 0.5*(s-1))/s;
+}
+
+double CorrelationTracker::Pyramid::fromLevel(int level, double p, int origin)
+{
+	double s = 1 << level;
+	return p*s + origin + 0.5*(s-1);
+}
+
+CorrelationTracker::CorrelationTracker()
+{
+	fftSize = 0;
+	setOptions(31, 16, 3, 0);
+	nextSubset = 0;
+}
+
+int CorrelationTracker::setOptions(int subsetSize, int searchRadius, int levels, int nbThreads)
+{
+	if (subsetSize < 3 || searchRadius < 1 || levels < 1 || levels > 8 || nbThreads < 0) return -1;
+
+	this->subsetSize = subsetSize;
+	this->searchRadius = searchRadius;
+	this->nbLevels = levels;
+	pool.setThreads(nbThreads);
+
+	// the finer levels search +-2 pixels
+	fftSize = nextPowerOfTwo(subsetSize + 2*max(searchRadius,2));
+	plan.build(fftSize);
+
+	// the reference has to be taken again
+	current.clear();
+	references.clear();
+
+	return 0;
+}
+
+// the part of the frame within reach of the subsets
+int CorrelationTracker::buildRegion(const ImageView &frame, const vector<Subset> &subsets, int reach, Pyramid &pyramid)
+{
+	if (subsets.empty()) return -1;
+
+	double minX = subsets[0].x, maxX = subsets[0].x, minY = subsets[0].y, maxY = subsets[0].y;
+	for (size_t i=1; i<subsets.size(); i++)
+	{
+		minX = min(minX,subsets[i].x);
+		maxX = max(maxX,subsets[i].x);
+		minY = min(minY,subsets[i].y);
+		maxY = max(maxY,subsets[i].y);
+	}
+	int x0 = max((int)floor(minX-1)-reach,0), x1 = min((int)ceil(maxX-1)+reach+1,frame.width);
+	int y0 = max((int)floor(minY-1)-reach,0), y1 = min((int)ceil(maxY-1)+reach+1,frame.height);
+	if (x1 <= x0 || y1 <= y0) return -3;
+
+	pyramid.build(frame, x0, y0, x1, y1, nbLevels);
+
+	return 0;
+}
+
+int CorrelationTracker::setReference(const ImageView &frame, const vector<Subset> &subsets)
+{
+	if (!frame.data || frame.channels < 1) return -1;
+
+	Pyramid reference;
+	int err = buildRegion(frame, subsets, (subsetSize/2+2) << (nbLevels-1), reference);
+	if (err) return err;
+
+	int N = fftSize, S = subsetSize;
+	current = subsets;
+	references.assign(subsets.size()*nbLevels, vector<Complex>());
+	centreX.resize(subsets.size()*nbLevels);
+	centreY.resize(subsets.size()*nbLevels);
+	vector<Complex> column(N);
+	for (size_t i=0; i<subsets.size(); i++)
+	{
+		current[i].score = 1;
+		for (int l=0; l<nbLevels; l++)
+		{
+			int k = i*nbLevels+l;
+			double cx = Pyramid::toLevel(l, subsets[i].x-1, reference.x0), cy = Pyramid::toLevel(l, subsets[i].y-1, reference.y0);
+			int tx = (int)floor(cx+0.5) - S/2, ty = (int)floor(cy+0.5) - S/2;
+			centreX[k] = cx-tx;
+			centreY[k] = cy-ty;
+
+			// zero mean and unit norm, zero padded to the FFT size
+			vector<Complex> &t = references[k];
+			t.assign((size_t)N*N, Complex(0,0));
+			double sum = 0;
+			for (int y=0; y<S; y++)
+			{
+				for (int x=0; x<S; x++) sum += reference.at(l,tx+x,ty+y);
+			}
+			double mean = sum/(S*S), norm = 0;
+			for (int y=0; y<S; y++)
+			{
+				for (int x=0; x<S; x++)
+				{
+					double v = reference.at(l,tx+x,ty+y)-mean;
+					t[(size_t)y*N+x] = Complex((float)v,0);
+					norm += v*v;
+				}
+			}
+			float scale = norm > 0 ? (float)(1/sqrt(norm)) : 0;
+			for (size_t j=0; j<t.size(); j++) t[j] *= scale;
+
+			plan.forward2D(&t[0], &column[0]);
+			for (size_t j=0; j<t.size(); j++) t[j] = conj(t[j]);
+		}
+	}
+
+	return 0;
+}
+
+void CorrelationTracker::matchSubset(int index, Workspace &w)
+{
+	int N = fftSize, S = subsetSize, range = N-S;
+	double px = current[index].x-1, py = current[index].y-1;
+	double score = 0;
+
+	for (int l=nbLevels-1; l>=0; l--)
+	{
+		int k = index*nbLevels+l;
+		double cx = Pyramid::toLevel(l, px, pyramid.x0), cy = Pyramid::toLevel(l, py, pyramid.y0);
+		// the estimate is at the centre of the displacements searched
+		int wx = (int)floor(cx-centreX[k]+0.5) - range/2, wy = (int)floor(cy-centreY[k]+0.5) - range/2;
+
+		// window, minus its mean to keep the float FFT accurate, and its running sums
+		double mean = 0;
+		for (int y=0; y<N; y++)
+		{
+			for (int x=0; x<N; x++)
+			{
+				float v = pyramid.at(l,wx+x,wy+y);
+				w.window[(size_t)y*N+x] = Complex(v,0);
+				mean += v;
+			}
+		}
+		mean /= N*N;
+		for (int y=0; y<N; y++)
+		{
+			double rowSum = 0, rowSquares = 0;
+			for (int x=0; x<N; x++)
+			{
+				float v = (float)(w.window[(size_t)y*N+x].real()-mean);
+				w.window[(size_t)y*N+x] = Complex(v,0);
+				rowSum += v;
+				rowSquares += (double)v*v;
+				w.sum[(size_t)(y+1)*(N+1)+x+1] = w.sum[(size_t)y*(N+1)+x+1] + rowSum;
+				w.sumSquares[(size_t)(y+1)*(N+1)+x+1] = w.sumSquares[(size_t)y*(N+1)+x+1] + rowSquares;
+			}
+		}
+
+		// correlation with every displacement: IFFT(FFT(window) x conj(FFT(subset)))
+		plan.forward2D(&w.window[0], &w.column[0]);
+		const vector<Complex> &t = references[k];
+		for (size_t j=0; j<t.size(); j++) w.window[j] *= t[j];
+		plan.inverse2D(&w.window[0], &w.column[0]);
+
+		// the whole window at the coarsest level, +-2 pixels around the estimate below
+		int lo = 0, hi = range;
+		if (l < nbLevels-1)
+		{
+			lo = max(range/2-2,0);
+			hi = min(range/2+2,range);
+		}
+		int bestX = lo, bestY = lo;
+		double best = -2;
+		for (int dy=lo; dy<=hi; dy++)
+		{
+			for (int dx=lo; dx<=hi; dx++)
+			{
+				double z = zncc(w, dx, dy);
+				if (z > best)
+				{
+					best = z;
+					bestX = dx;
+					bestY = dy;
+				}
+			}
+		}
+
+		// sub-pixel peak: parabola through the neighbours
+		double subX = 0, subY = 0;
+		if (l == 0)
+		{
+			if (bestX > 0 && bestX < range)
+			{
+				double a = zncc(w, bestX-1, bestY), c = zncc(w, bestX+1, bestY), d = a-2*best+c;
+				if (d < 0) subX = min(max(0.5*(a-c)/d,-0.5),0.5);
+			}
+			if (bestY > 0 && bestY < range)
+			{
+				double a = zncc(w, bestX, bestY-1), c = zncc(w, bestX, bestY+1), d = a-2*best+c;
+				if (d < 0) subY = min(max(0.5*(a-c)/d,-0.5),0.5);
+			}
+		}
+
+		px = Pyramid::fromLevel(l, wx+bestX+subX+centreX[k], pyramid.x0);
+		py = Pyramid::fromLevel(l, wy+bestY+subY+centreY[k], pyramid.y0);
+		score = best;
+	}
+
+	current[index].x = px+1;
+	current[index].y = py+1;
+	current[index].score = score;
+}
+
+// ZNCC of the subset at displacement (dx, dy) of the window, once correlated
+double CorrelationTracker::zncc(const Workspace &w, int dx, int dy)
+{
+	int N = fftSize, S = subsetSize;
+	size_t a = (size_t)dy*(N+1)+dx, b = a+S, c = a+(size_t)S*(N+1), d = c+S;
+	double sum = w.sum[d] - w.sum[b] - w.sum[c] + w.sum[a];
+	double squares = w.sumSquares[d] - w.sumSquares[b] - w.sumSquares[c] + w.sumSquares[a];
+	double variance = squares - sum*sum/(S*S);
+	if (variance <= 1e-6) return 0;
+
+	return w.window[(size_t)dy*N+dx].real()/sqrt(variance);
+}
+
+void CorrelationTracker::matchWorker(Workspace* w)
+{
+	int i;
+	while ((i = nextSubset++) < (int)current.size()) matchSubset(i, *w);
+}
+
+int CorrelationTracker::track(const ImageView &frame, vector<Subset> &subsets)
+{
+	if (!frame.data || frame.channels < 1) return -1;
+	if (current.empty()) return -2;
+
+	int err = buildRegion(frame, current, (fftSize/2+2) << (nbLevels-1), pyramid);
+	if (err) return err;
+
+	int nbWorkers = min(pool.size(),(int)current.size());
+	int N = fftSize;
+	workspaces.resize(max((int)workspaces.size(),nbWorkers));
+	for (int i=0; i<nbWorkers; i++)
+	{
+		Workspace &w = workspaces[i];
+		w.window.resize((size_t)N*N);
+		w.column.resize(N);
+		// the first row and column of the running sums stay 0
+		w.sum.assign((size_t)(N+1)*(N+1),0);
+		w.sumSquares.assign((size_t)(N+1)*(N+1),0);
+	}
+
+	nextSubset = 0;
+	pool.run(nbWorkers, [this](int i) { matchWorker(&workspaces[i]); });
+
+	subsets = current;
+
+	return 0;
+}
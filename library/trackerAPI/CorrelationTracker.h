@@ -0,0 +1,103 @@
+/***************************************************
+This is the header file for the subset correlation
+tracker, an alternative to the blob tracker for specimens
+whose markers are too faint to be thresholded (the
+approach of digital image correlation).
+
+Square subsets of a reference frame are followed in the
+next frames by their zero-normalised cross-correlation
+(ZNCC) with a search window around their last position:
+ - the correlation of a subset with every position of
+   the window is computed at once with FFTs, the ZNCC is
+   normalised with running sums of the window;
+ - large displacements are found coarse to fine on image
+   pyramids (2x2 averages): the whole window is searched
+   at the coarsest level only, the finer levels refine
+   the position by +-2 pixels;
+ - the peak is refined to sub-pixel precision with a
+   parabola through its neighbours along x and y.
+The FFTs of the reference subsets are computed once by
+setReference, the FFT plan and the per thread buffers are
+kept from frame to frame, and the subsets are shared among
+the threads.
+
+Frames are grey-levelled as the mean of their channels.
+**************************************************/
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+
+#include "BlobTracker.h"
+#include "FFT.h"
+#include "WorkerPool.h"
+
+struct Subset
+{
+	// centre in 1-based frame coordinates
+	double x, y;
+	// ZNCC of the last match, in [-1,1]
+	double score;
+};
+
+class CorrelationTracker
+{
+public:
+	CorrelationTracker();
+
+	// subsetSize: side of the subsets in pixels
+	// searchRadius: largest displacement from the last position, in pixels of the coarsest level
+	// levels: number of pyramid levels, 1 for the full resolution only
+	// nbThreads: 0 for one per core
+	int setOptions(int subsetSize, int searchRadius, int levels, int nbThreads);
+	// the subsets are centred on the x, y of subsets in frame
+	int setReference(const ImageView &frame, const std::vector<Subset> &subsets);
+	// updates the position and score of every subset of the reference
+	int track(const ImageView &frame, std::vector<Subset> &subsets);
+
+private:
+	struct Pyramid
+	{
+		// region of the frame the pyramid was built from (level 0)
+		int x0, y0;
+		std::vector<int> widths, heights;
+		std::vector<std::vector<float> > levels;
+
+		void build(const ImageView &frame, int x0, int y0, int x1, int y1, int nbLevels);
+		// clamped to the region
+		float at(int level, int x, int y) const;
+		// from 0-based frame coordinates to the coordinates of a level and back,
+		// origin is x0 or y0
+		static double toLevel(int level, double p, int origin);
+		static double fromLevel(int level, double p, int origin);
+	};
+	struct Workspace
+	{
+		std::vector<Complex> window, column;
+		std::vector<double> sum, sumSquares;
+	};
+
+	int buildRegion(const ImageView &frame, const std::vector<Subset> &subsets, int reach, Pyramid &pyramid);
+	void matchSubset(int index, Workspace &w);
+	double zncc(const Workspace &w, int dx, int dy);
+	void matchWorker(Workspace* w);
+
+	// options
+	int subsetSize, searchRadius, nbLevels;
+	int fftSize;
+	FFTPlan plan;
+
+	// last positions of the subsets
+	std::vector<Subset> current;
+	// reference: per subset and level, the conjugated FFT of the normalised subset and
+	// the position of the subset centre in the subset
+	std::vector<std::vector<Complex> > references;
+	std::vector<double> centreX, centreY;
+
+	// current frame
+	Pyramid pyramid;
+	std::vector<Workspace> workspaces;
+	std::atomic<int> nextSubset;
+	WorkerPool pool;
+};
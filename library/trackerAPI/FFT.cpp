@@ -0,0 +1,112 @@
+/***************************************************
+Radix-2 FFT of the correlation tracker, see FFT.h.
+**************************************************/
+
+#include "FFT.h"
+
+#include <math.h>
+using namespace std;
+
+static const double pi = 3.14159265358979323846;
+
+int nextPowerOfTwo(int n)
+{
+	int p = 1;
+	while (p < n) p <<= 1;
+	return p;
+}
+
+FFTPlan::FFTPlan()
+{
+	n = 0;
+}
+
+FFTPlan::FFTPlan(int n)
+{
+	build(n);
+}
+
+int FFTPlan::build(int n)
+{
+	if (n < 1 || (n & (n-1))) return -1;
+	this->n = n;
+
+	int bits = 0;
+	while ((1 << bits) < n) bits++;
+	bitReverse.resize(n);
+	for (int i=0; i<n; i++)
+	{
+		int r = 0;
+		for (int b=0; b<bits; b++) r |= ((i >> b) & 1) << (bits-1-b);
+		bitReverse[i] = r;
+	}
+
+	twiddles.resize(n/2);
+	for (int i=0; i<n/2; i++) twiddles[i] = Complex((float)cos(-2*pi*i/n), (float)sin(-2*pi*i/n));
+
+	return 0;
+}
+
+void FFTPlan::transform(Complex* data, ptrdiff_t stride, bool inverse) const
+{
+	for (int i=0; i<n; i++)
+	{
+		int j = bitReverse[i];
+		if (i < j) swap(data[i*stride],data[j*stride]);
+	}
+
+	for (int len=2; len<=n; len<<=1)
+	{
+		int half = len/2, step = n/len;
+		for (int start=0; start<n; start+=len)
+		{
+			for (int k=0; k<half; k++)
+			{
+				Complex w = inverse ? conj(twiddles[k*step]) : twiddles[k*step];
+				Complex &a = data[(start+k)*stride];
+				Complex &b = data[(start+k+half)*stride];
+				Complex t = w*b;
+				b = a-t;
+				a += t;
+			}
+		}
+	}
+
+	if (inverse)
+	{
+		float scale = 1.0f/n;
+		for (int i=0; i<n; i++) data[i*stride] *= scale;
+	}
+}
+
+void FFTPlan::forward(Complex* data, ptrdiff_t stride) const
+{
+	transform(data, stride, false);
+}
+
+void FFTPlan::inverse(Complex* data, ptrdiff_t stride) const
+{
+	transform(data, stride, true);
+}
+
+// rows in place, columns through a contiguous copy
+void FFTPlan::transform2D(Complex* data, Complex* column, bool inverse) const
+{
+	for (int y=0; y<n; y++) transform(data+(ptrdiff_t)y*n, 1, inverse);
+	for (int x=0; x<n; x++)
+	{
+		for (int y=0; y<n; y++) column[y] = data[(ptrdiff_t)y*n+x];
+		transform(column, 1, inverse);
+		for (int y=0; y<n; y++) data[(ptrdiff_t)y*n+x] = column[y];
+	}
+}
+
+void FFTPlan::forward2D(Complex* data, Complex* column) const
+{
+	transform2D(data, column, false);
+}
+
+void FFTPlan::inverse2D(Complex* data, Complex* column) const
+{
+	transform2D(data, column, true);
+}
@@ -0,0 +1,49 @@
+/***************************************************
+This is the header file for the small FFT used by the
+correlation tracker.
+
+FFTPlan holds the twiddle factors and the bit reversal
+permutation of a power of two size, so that they are
+computed once and shared by every transform of that size
+(and by every thread, the plan is read only once built).
+The transforms are in place, iterative radix-2, in single
+precision; the inverse is scaled by 1/n.
+**************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <complex>
+#include <vector>
+
+typedef std::complex<float> Complex;
+
+class FFTPlan
+{
+public:
+	FFTPlan();
+	FFTPlan(int n);
+
+	// n must be a power of two, returns -1 otherwise
+	int build(int n);
+	int size() const { return n; }
+
+	// n elements, stride apart
+	void forward(Complex* data, ptrdiff_t stride = 1) const;
+	void inverse(Complex* data, ptrdiff_t stride = 1) const;
+
+	// n x n row-major image, column is a scratch buffer of n elements
+	void forward2D(Complex* data, Complex* column) const;
+	void inverse2D(Complex* data, Complex* column) const;
+
+private:
+	void transform(Complex* data, ptrdiff_t stride, bool inverse) const;
+	void transform2D(Complex* data, Complex* column, bool inverse) const;
+
+	int n;
+	std::vector<Complex> twiddles;
+	std::vector<int> bitReverse;
+};
+
+// smallest power of two >= n
+int nextPowerOfTwo(int n);
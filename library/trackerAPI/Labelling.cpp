@@ -0,0 +1,207 @@
+/***************************************************
+Run-length connected component labelling of the blob
+tracker, see Labelling.h.
+**************************************************/
+
+#include "Labelling.h"
+
+#include <algorithm>
+using namespace std;
+
+Labelling::Labelling()
+{
+	reset(true, false);
+}
+
+void Labelling::reset(bool alongX, bool keepRuns)
+{
+	this->alongX = alongX;
+	this->keepRuns = keepRuns;
+	firstLine = lastLine = -1;
+	components.clear();
+	runs.clear();
+	firstRuns.clear();
+	previousRuns.clear();
+}
+
+int Labelling::findRoot(int label)
+{
+	while (components[label].parent != label)
+	{
+		components[label].parent = components[components[label].parent].parent;
+		label = components[label].parent;
+	}
+	return label;
+}
+
+// joins two roots, the oldest label stays the root
+int Labelling::unite(int a, int b)
+{
+	if (a == b) return a;
+	if (b < a) swap(a,b);
+	components[b].parent = a;
+	return a;
+}
+
+void Labelling::addLine(int line, const vector<pair<int,int> > &lineRuns, const uint8_t* intensity, ptrdiff_t stride)
+{
+	currentRuns.clear();
+	size_t first = 0;
+	for (size_t i=0; i<lineRuns.size(); i++)
+	{
+		LabelledRun run;
+		run.line = line;
+		run.start = lineRuns[i].first;
+		run.end = lineRuns[i].second;
+		run.label = -1;
+
+		// previous runs touching [start-1, end+1] are connected
+		while (first < previousRuns.size() && previousRuns[first].end < run.start-1) first++;
+		for (size_t j=first; j<previousRuns.size() && previousRuns[j].start <= run.end+1; j++)
+		{
+			int root = findRoot(previousRuns[j].label);
+			run.label = run.label < 0 ? root : unite(run.label,root);
+		}
+
+		if (run.label < 0)
+		{
+			Component c;
+			c.parent = components.size();
+			c.area = 0;
+			c.sumU = c.sumV = 0;
+			c.sumI = c.sumIU = c.sumIV = 0;
+			c.minU = c.minV = 0x7FFFFFFF;
+			c.maxU = c.maxV = -1;
+			c.firstX = c.firstY = 0x7FFFFFFF;
+			run.label = components.size();
+			components.push_back(c);
+		}
+
+		Component &c = components[run.label];
+		int len = run.end-run.start+1;
+		c.area += len;
+		c.sumU += 0.5*(run.start+run.end)*len;
+		c.sumV += (double)line*len;
+		double sumI = 0, sumIU = 0;
+		const uint8_t* p = intensity + run.start*stride;
+		for (int u=run.start; u<=run.end; u++, p+=stride)
+		{
+			sumI += *p;
+			sumIU += (double)*p*u;
+		}
+		c.sumI += sumI;
+		c.sumIU += sumIU;
+		c.sumIV += sumI*line;
+		c.minU = min(c.minU,run.start);
+		c.maxU = max(c.maxU,run.end);
+		c.minV = min(c.minV,line);
+		c.maxV = max(c.maxV,line);
+		int x = alongX?run.start:line, y = alongX?line:run.start;
+		if (x < c.firstX || (x == c.firstX && y < c.firstY))
+		{
+			c.firstX = x;
+			c.firstY = y;
+		}
+
+		currentRuns.push_back(run);
+	}
+	previousRuns.swap(currentRuns);
+
+	if (firstLine < 0)
+	{
+		firstLine = line;
+		firstRuns = previousRuns;
+	}
+	lastLine = line;
+	if (keepRuns) runs.insert(runs.end(),previousRuns.begin(),previousRuns.end());
+}
+
+void Labelling::append(const Labelling &next)
+{
+	if (next.firstLine < 0) return;
+	if (firstLine < 0)
+	{
+		*this = next;
+		return;
+	}
+
+	int offset = components.size();
+	for (size_t i=0; i<next.components.size(); i++)
+	{
+		Component c = next.components[i];
+		c.parent += offset;
+		components.push_back(c);
+	}
+	if (keepRuns)
+	{
+		for (size_t i=0; i<next.runs.size(); i++)
+		{
+			LabelledRun run = next.runs[i];
+			run.label += offset;
+			runs.push_back(run);
+		}
+	}
+
+	// the first line of the next stripe against the last line of this one
+	if (next.firstLine == lastLine+1)
+	{
+		size_t first = 0;
+		for (size_t i=0; i<next.firstRuns.size(); i++)
+		{
+			const LabelledRun &run = next.firstRuns[i];
+			while (first < previousRuns.size() && previousRuns[first].end < run.start-1) first++;
+			for (size_t j=first; j<previousRuns.size() && previousRuns[j].start <= run.end+1; j++)
+			{
+				unite(findRoot(previousRuns[j].label),findRoot(run.label+offset));
+			}
+		}
+	}
+
+	previousRuns = next.previousRuns;
+	for (size_t i=0; i<previousRuns.size(); i++) previousRuns[i].label += offset;
+	lastLine = next.lastLine;
+}
+
+void Labelling::resolve()
+{
+	for (int i=0; i<(int)components.size(); i++)
+	{
+		int root = findRoot(i);
+		if (root == i) continue;
+
+		Component &r = components[root];
+		const Component &c = components[i];
+		r.area += c.area;
+		r.sumU += c.sumU;
+		r.sumV += c.sumV;
+		r.sumI += c.sumI;
+		r.sumIU += c.sumIU;
+		r.sumIV += c.sumIV;
+		r.minU = min(r.minU,c.minU);
+		r.maxU = max(r.maxU,c.maxU);
+		r.minV = min(r.minV,c.minV);
+		r.maxV = max(r.maxV,c.maxV);
+		if (c.firstX < r.firstX || (c.firstX == r.firstX && c.firstY < r.firstY))
+		{
+			r.firstX = c.firstX;
+			r.firstY = c.firstY;
+		}
+	}
+}
+
+void Labelling::select(int minArea, int maxCount, vector<int> &selected)
+{
+	vector<pair<pair<int,int>,int> > order;
+	for (int i=0; i<(int)components.size(); i++)
+	{
+		const Component &c = components[i];
+		if (c.parent == i && c.area >= minArea) order.push_back(make_pair(make_pair(c.firstX,c.firstY),i));
+	}
+
+	// only the first maxCount need to be sorted
+	size_t count = min(order.size(),(size_t)max(maxCount,0));
+	partial_sort(order.begin(),order.begin()+count,order.end());
+
+	selected.clear();
+	for (size_t i=0; i<count; i++) selected.push_back(order[i].second);
+}
@@ -0,0 +1,73 @@
+/***************************************************
+This is the header file for the connected component
+labelling of the blob tracker.
+
+Components are labelled from the runs of set pixels of
+each line (8-connectivity) with a union-find over the
+labels: the oldest label stays the root and roots are
+found with path halving.  Area, centroid, intensity
+weighted centroid, bounding box and first pixel are
+accumulated per run, so no label image is needed.
+
+A region can be cut into stripes of consecutive lines
+that are labelled independently (e.g. on different
+threads) and joined afterwards with append, which only
+has to look at the runs on either side of the boundary.
+The runs of all lines are only kept when the caller asks
+for a label image.
+**************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct Component
+{
+	int parent;
+	int area;
+	// along (u) and across (v) the lines
+	double sumU, sumV;
+	// intensity weighted
+	double sumI, sumIU, sumIV;
+	int minU, maxU, minV, maxV;
+	// first pixel in column-major order, which is the order vision.BlobAnalysis reports blobs in
+	int firstX, firstY;
+};
+
+struct LabelledRun
+{
+	int line, start, end, label;
+};
+
+class Labelling
+{
+public:
+	Labelling();
+
+	// alongX is true when the lines are rows of the image, keepRuns to be able to write a label image
+	void reset(bool alongX, bool keepRuns);
+	// the [start, end] runs of a line; lines are added in increasing order and without gaps,
+	// intensity[u*stride] is the intensity of pixel u of the line
+	void addLine(int line, const std::vector<std::pair<int,int> > &runs, const uint8_t* intensity, ptrdiff_t stride);
+	// joins the stripe that starts on the line after the last line of this one
+	void append(const Labelling &next);
+
+	// folds the statistics of merged labels into their roots, once all lines are in
+	void resolve();
+	// roots with area >= minArea, the first maxCount of them in column-major order of their first pixel
+	void select(int minArea, int maxCount, std::vector<int> &selected);
+	int findRoot(int label);
+
+	std::vector<Component> components;
+	// every run when keepRuns is set
+	std::vector<LabelledRun> runs;
+
+private:
+	int unite(int a, int b);
+
+	bool alongX, keepRuns;
+	int firstLine, lastLine;
+	std::vector<LabelledRun> firstRuns, previousRuns, currentRuns;
+};
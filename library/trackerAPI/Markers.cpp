@@ -0,0 +1,191 @@
+/***************************************************
+Marker matching and measurements, see Markers.h.
+**************************************************/
+
+#include "Markers.h"
+
+#include <math.h>
+#include <algorithm>
+using namespace std;
+
+SpatialHash::SpatialHash()
+{
+	x = y = NULL;
+	cellSize = 1;
+	minX = minY = 0;
+	nbCellsX = nbCellsY = 0;
+}
+
+void SpatialHash::build(const double* x, const double* y, int n, double cellSize)
+{
+	this->x = x;
+	this->y = y;
+	this->cellSize = cellSize > 0 ? cellSize : 1;
+	points.resize(n);
+	if (n == 0)
+	{
+		nbCellsX = nbCellsY = 0;
+		cellStart.assign(1,0);
+		return;
+	}
+
+	double maxX = x[0], maxY = y[0];
+	minX = x[0];
+	minY = y[0];
+	for (int i=1; i<n; i++)
+	{
+		minX = min(minX,x[i]);
+		maxX = max(maxX,x[i]);
+		minY = min(minY,y[i]);
+		maxY = max(maxY,y[i]);
+	}
+	// a few cells per point at most, the grid must stay small for sparse points
+	double w = maxX-minX, h = maxY-minY;
+	this->cellSize = max(this->cellSize,max(sqrt(w*h/(4.0*n)),max(w,h)/(4.0*n)));
+	nbCellsX = (int)((maxX-minX)/this->cellSize)+1;
+	nbCellsY = (int)((maxY-minY)/this->cellSize)+1;
+
+	// counting sort of the points by cell
+	cellStart.assign((size_t)nbCellsX*nbCellsY+1,0);
+	vector<int> cell(n);
+	for (int i=0; i<n; i++)
+	{
+		cell[i] = (int)((y[i]-minY)/this->cellSize)*nbCellsX + (int)((x[i]-minX)/this->cellSize);
+		cellStart[cell[i]+1]++;
+	}
+	for (size_t c=1; c<cellStart.size(); c++) cellStart[c] += cellStart[c-1];
+	vector<int> next(cellStart.begin(),cellStart.end()-1);
+	for (int i=0; i<n; i++) points[next[cell[i]]++] = i;
+}
+
+void SpatialHash::query(double px, double py, double radius, vector<int> &found) const
+{
+	if (nbCellsX == 0) return;
+
+	int cx0 = (int)floor((px-radius-minX)/cellSize), cx1 = (int)floor((px+radius-minX)/cellSize);
+	int cy0 = (int)floor((py-radius-minY)/cellSize), cy1 = (int)floor((py+radius-minY)/cellSize);
+	cx0 = max(cx0,0); cx1 = min(cx1,nbCellsX-1);
+	cy0 = max(cy0,0); cy1 = min(cy1,nbCellsY-1);
+
+	double r2 = radius*radius;
+	for (int cy=cy0; cy<=cy1; cy++)
+	{
+		for (int cx=cx0; cx<=cx1; cx++)
+		{
+			int c = cy*nbCellsX+cx;
+			for (int k=cellStart[c]; k<cellStart[c+1]; k++)
+			{
+				int i = points[k];
+				double dx = x[i]-px, dy = y[i]-py;
+				if (dx*dx+dy*dy <= r2) found.push_back(i);
+			}
+		}
+	}
+}
+
+MarkerMatcher::MarkerMatcher()
+{
+}
+
+void MarkerMatcher::reset(const double* x, const double* y, int n)
+{
+	this->x.assign(x,x+n);
+	this->y.assign(y,y+n);
+	vx.assign(n,0);
+	vy.assign(n,0);
+	found.assign(n,true);
+}
+
+void MarkerMatcher::match(const double* detX, const double* detY, int n, double maxDistance, vector<int> &assignment)
+{
+	int nbMarkers = x.size();
+	predictedX.resize(nbMarkers);
+	predictedY.resize(nbMarkers);
+	for (int i=0; i<nbMarkers; i++)
+	{
+		predictedX[i] = x[i]+vx[i];
+		predictedY[i] = y[i]+vy[i];
+	}
+
+	// candidate pairs within maxDistance, nearest first
+	hash.build(detX, detY, n, maxDistance);
+	pairs.clear();
+	for (int i=0; i<nbMarkers; i++)
+	{
+		candidates.clear();
+		hash.query(predictedX[i], predictedY[i], maxDistance, candidates);
+		for (size_t k=0; k<candidates.size(); k++)
+		{
+			int j = candidates[k];
+			double dx = detX[j]-predictedX[i], dy = detY[j]-predictedY[i];
+			pairs.push_back(make_pair(dx*dx+dy*dy,make_pair(i,j)));
+		}
+	}
+	sort(pairs.begin(),pairs.end());
+
+	assignment.assign(nbMarkers,-1);
+	taken.assign(n,false);
+	for (size_t k=0; k<pairs.size(); k++)
+	{
+		int i = pairs[k].second.first, j = pairs[k].second.second;
+		if (assignment[i] >= 0 || taken[j]) continue;
+		assignment[i] = j;
+		taken[j] = true;
+	}
+
+	for (int i=0; i<nbMarkers; i++)
+	{
+		int j = assignment[i];
+		found[i] = j >= 0;
+		if (j < 0)
+		{
+			// lost: wait where it was last seen
+			vx[i] = vy[i] = 0;
+			continue;
+		}
+		vx[i] = detX[j]-x[i];
+		vy[i] = detY[j]-y[i];
+		x[i] = detX[j];
+		y[i] = detY[j];
+	}
+}
+
+void measureMarkers(const double* x, const double* y, const double* refX, const double* refY, int n, double scale, double* displacement, double* distance, double* distanceChange)
+{
+	if (displacement)
+	{
+		for (int i=0; i<n; i++)
+		{
+			double dx = x[i]-refX[i], dy = y[i]-refY[i];
+			displacement[i] = scale*sqrt(dx*dx+dy*dy);
+		}
+	}
+	if (!distance && !distanceChange) return;
+
+	// pair (i,j), i < j, is at k = i*n - i*(i+1)/2 + j-i-1
+	vector<double> current, reference;
+	for (int i=0; i+1<n; i++)
+	{
+		int m = n-i-1;
+		size_t k = (size_t)i*n - (size_t)i*(i+1)/2;
+		current.resize(m);
+		reference.resize(m);
+		const double xi = x[i], yi = y[i], rxi = refX[i], ryi = refY[i];
+		const double* xj = x+i+1;
+		const double* yj = y+i+1;
+		const double* rxj = refX+i+1;
+		const double* ryj = refY+i+1;
+		for (int j=0; j<m; j++)
+		{
+			double dx = xj[j]-xi, dy = yj[j]-yi;
+			double rx = rxj[j]-rxi, ry = ryj[j]-ryi;
+			current[j] = scale*sqrt(dx*dx+dy*dy);
+			reference[j] = scale*sqrt(rx*rx+ry*ry);
+		}
+		if (distance) copy(current.begin(),current.end(),distance+k);
+		if (distanceChange)
+		{
+			for (int j=0; j<m; j++) distanceChange[k+j] = current[j]-reference[j];
+		}
+	}
+}
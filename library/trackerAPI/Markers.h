@@ -0,0 +1,75 @@
+/***************************************************
+This is the header file for the marker bookkeeping of the
+trackers: following any number of markers from frame to
+frame and measuring them.
+
+MarkerMatcher keeps the identity of the markers instead of
+relying on the order in which they are detected.  Each
+marker is predicted at its last position plus its last
+displacement, the detections of the new frame are put in
+a spatial hash (a uniform grid with the match distance as
+cell size, stored as sorted cells) and only the detections
+in the 3x3 cells around a prediction are candidates.  The
+candidate pairs are then assigned nearest first, so the
+cost is O(n log n) for n markers instead of O(n^2).
+Markers without a detection within the match distance are
+reported as lost and keep their last position.
+
+measureMarkers computes the displacement of every marker
+from the reference and the distances between every pair of
+markers, in the order of pdist (1-2, 1-3, ..., 2-3, ...),
+from coordinates stored as separate x and y arrays so the
+inner loops run over contiguous memory.
+**************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+class SpatialHash
+{
+public:
+	SpatialHash();
+
+	void build(const double* x, const double* y, int n, double cellSize);
+	// appends the indices of the points within radius of (px, py), radius <= cellSize
+	void query(double px, double py, double radius, std::vector<int> &found) const;
+
+private:
+	const double* x;
+	const double* y;
+	double cellSize, minX, minY;
+	int nbCellsX, nbCellsY;
+	// points sorted by cell, cellStart[c] .. cellStart[c+1] are the points of cell c
+	std::vector<int> cellStart, points;
+};
+
+class MarkerMatcher
+{
+public:
+	MarkerMatcher();
+
+	// the markers and their identity (their order)
+	void reset(const double* x, const double* y, int n);
+	int size() const { return (int)x.size(); }
+
+	// assigns the n detections to the markers, assignment[i] is the detection of marker i or -1
+	void match(const double* detX, const double* detY, int n, double maxDistance, std::vector<int> &assignment);
+
+	// last known positions, in the order of the markers
+	std::vector<double> x, y;
+	std::vector<bool> found;
+
+private:
+	std::vector<double> vx, vy;
+	std::vector<double> predictedX, predictedY;
+	SpatialHash hash;
+	std::vector<int> candidates;
+	std::vector<std::pair<double,std::pair<int,int> > > pairs;
+	std::vector<bool> taken;
+};
+
+// displacement: n values, distance and distanceChange: n*(n-1)/2 values (either can be NULL),
+// everything multiplied by scale
+void measureMarkers(const double* x, const double* y, const double* refX, const double* refY, int n, double scale, double* displacement, double* distance, double* distanceChange);
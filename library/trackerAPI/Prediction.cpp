@@ -0,0 +1,57 @@
+/***************************************************
+Motion models of the blob tracker, see Prediction.h.
+**************************************************/
+
+#include "Prediction.h"
+
+// variance of the acceleration (pixels^2/frame^4) and of the measured centroids (pixels^2)
+static const double processNoise = 0.5;
+static const double measurementNoise = 0.25;
+// the velocity is unknown after the first measurement
+static const double initialVelocityVariance = 100;
+
+MotionPredictor::MotionPredictor()
+{
+	reset(PREDICT_NONE, 0);
+}
+
+void MotionPredictor::reset(int mode, double position)
+{
+	this->mode = mode;
+	x = position;
+	v = 0;
+	P[0][0] = measurementNoise;
+	P[0][1] = P[1][0] = 0;
+	P[1][1] = initialVelocityVariance;
+}
+
+double MotionPredictor::predict() const
+{
+	return mode == PREDICT_NONE ? x : x+v;
+}
+
+void MotionPredictor::update(double measured)
+{
+	if (mode != PREDICT_KALMAN)
+	{
+		v = measured-x;
+		x = measured;
+		return;
+	}
+
+	// predict: F = [1 1; 0 1], Q = q*[1/4 1/2; 1/2 1]
+	double xp = x+v;
+	double p00 = P[0][0] + 2*P[0][1] + P[1][1] + 0.25*processNoise;
+	double p01 = P[0][1] + P[1][1] + 0.5*processNoise;
+	double p11 = P[1][1] + processNoise;
+
+	// correct with the measured position, H = [1 0]
+	double s = p00 + measurementNoise;
+	double k0 = p00/s, k1 = p01/s;
+	double innovation = measured-xp;
+	x = xp + k0*innovation;
+	v = v + k1*innovation;
+	P[0][0] = (1-k0)*p00;
+	P[0][1] = P[1][0] = (1-k0)*p01;
+	P[1][1] = p11 - k1*p01;
+}
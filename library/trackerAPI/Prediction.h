@@ -0,0 +1,42 @@
+/***************************************************
+This is the header file for the motion models used by the
+blob tracker to predict where a marker is in the next
+frame.
+
+Each coordinate of a marker is predicted on its own:
+ - PREDICT_VELOCITY extrapolates the last displacement
+   (constant velocity);
+ - PREDICT_KALMAN runs a constant velocity Kalman filter
+   (state position and velocity per frame, piecewise
+   constant white acceleration), which smooths out the
+   jitter of the centroids.
+Time is counted in frames, so the frames are assumed to be
+sampled at a constant interval as in videoTracker.m.
+**************************************************/
+
+#pragma once
+
+enum PredictionMode
+{
+	PREDICT_NONE = 0,
+	PREDICT_VELOCITY = 1,
+	PREDICT_KALMAN = 2
+};
+
+class MotionPredictor
+{
+public:
+	MotionPredictor();
+
+	void reset(int mode, double position);
+	// position expected in the next frame
+	double predict() const;
+	// the position measured in the next frame
+	void update(double measured);
+
+private:
+	int mode;
+	double x, v;
+	// covariance of (x, v)
+	double P[2][2];
+};
@@ -0,0 +1,236 @@
+/***************************************************
+Projection tracker, see Projection.h.
+**************************************************/
+
+#include "Projection.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+using namespace std;
+
+// Matlab's round: halves away from zero
+static int roundHalfAway(double x)
+{
+	return x >= 0 ? (int)floor(x+0.5) : -(int)floor(-x+0.5);
+}
+
+ProjectionTracker::ProjectionTracker()
+{
+	nbMarkers = 3;
+	smoothing = 3;
+	polarity = 1;
+	window = 10;
+	roi[0] = roi[1] = 0;
+	roi[2] = roi[3] = -1;
+	x0 = y0 = x1 = y1 = 0;
+	background = 0;
+}
+
+int ProjectionTracker::setOptions(int nbMarkers, int smoothing, int polarity, int window)
+{
+	if (nbMarkers < 1 || smoothing < 1 || smoothing%2 == 0 || (polarity != 1 && polarity != -1) || window < 1) return -1;
+
+	this->nbMarkers = nbMarkers;
+	this->smoothing = smoothing;
+	this->polarity = polarity;
+	this->window = window;
+	last.clear();
+
+	return 0;
+}
+
+int ProjectionTracker::setROI(double xmin, double ymin, double width, double height)
+{
+	if (width < 0 || height < 0) return -1;
+
+	roi[0] = xmin;
+	roi[1] = ymin;
+	roi[2] = width;
+	roi[3] = height;
+	last.clear();
+
+	return 0;
+}
+
+int ProjectionTracker::clipROI(const ImageView &frame)
+{
+	if (roi[2] < 0 || roi[3] < 0)
+	{
+		x0 = 0; x1 = frame.width;
+		y0 = 0; y1 = frame.height;
+	} else {
+		// imcrop keeps the pixels whose centres are inside the rectangle
+		x0 = max(roundHalfAway(roi[0]),1)-1;
+		x1 = min(roundHalfAway(roi[0]+roi[2]),frame.width);
+		y0 = max(roundHalfAway(roi[1]),1)-1;
+		y1 = min(roundHalfAway(roi[1]+roi[3]),frame.height);
+	}
+	if (x1 <= x0 || y1 <= y0) return -3;
+
+	return 0;
+}
+
+// column sums of the first channel (the one the blob tracker binarises), smoothed, and the background
+void ProjectionTracker::project(const ImageView &frame)
+{
+	int width = x1-x0, height = y1-y0;
+	const uint8_t* origin = frame.data + x0*frame.xStride + y0*frame.yStride;
+
+	sums.assign(width,0);
+	uint32_t* sum = &sums[0];
+	if (labs(frame.xStride) <= labs(frame.yStride))
+	{
+		// lines are contiguous: accumulate whole lines
+		for (int y=0; y<height; y++)
+		{
+			const uint8_t* line = origin + y*frame.yStride;
+			if (frame.xStride == 1)
+			{
+				for (int x=0; x<width; x++) sum[x] += line[x];
+			} else {
+				for (int x=0; x<width; x++) sum[x] += line[x*frame.xStride];
+			}
+		}
+	} else {
+		// columns are contiguous (Matlab): one sum per column
+		for (int x=0; x<width; x++)
+		{
+			const uint8_t* column = origin + x*frame.xStride;
+			uint32_t s = 0;
+			if (frame.yStride == 1)
+			{
+				for (int y=0; y<height; y++) s += column[y];
+			} else {
+				for (int y=0; y<height; y++) s += column[y*frame.yStride];
+			}
+			sum[x] = s;
+		}
+	}
+
+	profile.resize(width);
+	for (int x=0; x<width; x++) profile[x] = (double)sum[x]/height;
+
+	// box filter with the edges replicated, markers are peaks whatever their polarity
+	int half = smoothing/2;
+	smoothed.resize(width);
+	double s = 0;
+	for (int k=-half; k<=half; k++) s += profile[min(max(k,0),width-1)];
+	for (int x=0; x<width; x++)
+	{
+		smoothed[x] = polarity*s/smoothing;
+		s += profile[min(x+half+1,width-1)] - profile[max(x-half,0)];
+	}
+
+	sorted = smoothed;
+	nth_element(sorted.begin(),sorted.begin()+width/2,sorted.end());
+	background = sorted[width/2];
+}
+
+// half-contrast crossings on each side of the peak
+bool ProjectionTracker::findEdges(int peak, ProfileMarker &marker)
+{
+	int width = smoothed.size();
+	double level = 0.5*(background+smoothed[peak]);
+	if (smoothed[peak] <= background) return false;
+
+	int l = peak, r = peak;
+	while (l > 0 && smoothed[l-1] >= level) l--;
+	while (r < width-1 && smoothed[r+1] >= level) r++;
+
+	marker.leftEdge = l > 0 ? l-1 + (level-smoothed[l-1])/(smoothed[l]-smoothed[l-1]) : l-0.5;
+	marker.rightEdge = r < width-1 ? r + (smoothed[r]-level)/(smoothed[r]-smoothed[r+1]) : r+0.5;
+	marker.x = 0.5*(marker.leftEdge+marker.rightEdge);
+	marker.contrast = smoothed[peak]-background;
+
+	// 1-based
+	marker.leftEdge += 1;
+	marker.rightEdge += 1;
+	marker.x += 1;
+
+	return true;
+}
+
+// the nbMarkers highest peaks that do not lie on each other, from left to right
+int ProjectionTracker::searchAll(vector<ProfileMarker> &markers)
+{
+	int width = smoothed.size();
+	vector<pair<double,int> > peaks;
+	for (int x=0; x<width; x++)
+	{
+		double v = smoothed[x];
+		if (v <= background) continue;
+		if ((x > 0 && smoothed[x-1] > v) || (x < width-1 && smoothed[x+1] >= v)) continue;
+		peaks.push_back(make_pair(-v,x));
+	}
+	sort(peaks.begin(),peaks.end());
+
+	markers.clear();
+	for (size_t k=0; k<peaks.size() && (int)markers.size()<nbMarkers; k++)
+	{
+		ProfileMarker m;
+		if (!findEdges(peaks[k].second, m)) continue;
+
+		// a lower peak on the shoulder of a marker already found is the same marker
+		bool inside = false;
+		for (size_t i=0; i<markers.size() && !inside; i++) inside = m.x >= markers[i].leftEdge && m.x <= markers[i].rightEdge;
+		if (!inside) markers.push_back(m);
+	}
+
+	struct ByX { bool operator()(const ProfileMarker &a, const ProfileMarker &b) const { return a.x < b.x; } };
+	sort(markers.begin(),markers.end(),ByX());
+
+	return 0;
+}
+
+// the peak near the predicted position of each marker
+bool ProjectionTracker::searchWindows(vector<ProfileMarker> &markers)
+{
+	int width = smoothed.size();
+	markers.resize(last.size());
+	for (size_t i=0; i<last.size(); i++)
+	{
+		int predicted = roundHalfAway(last[i].x-1+velocity[i]);
+		int wx0 = max(predicted-window,0), wx1 = min(predicted+window,width-1);
+		if (wx1 < wx0) return false;
+
+		int peak = wx0;
+		for (int x=wx0+1; x<=wx1; x++) if (smoothed[x] > smoothed[peak]) peak = x;
+		if ((peak == wx0 && wx0 > 0) || (peak == wx1 && wx1 < width-1)) return false;
+		if (!findEdges(peak, markers[i]) || markers[i].contrast < 0.5*firstContrast[i]) return false;
+		if (i > 0 && markers[i].leftEdge <= markers[i-1].rightEdge) return false;
+	}
+
+	return true;
+}
+
+int ProjectionTracker::track(const ImageView &frame, vector<ProfileMarker> &markers)
+{
+	if (!frame.data || frame.width < 1 || frame.height < 1) return -1;
+
+	int err = clipROI(frame);
+	if (err) return err;
+
+	project(frame);
+
+	bool found = (int)last.size() == nbMarkers && searchWindows(markers);
+	if (!found) searchAll(markers);
+
+	if ((int)markers.size() == nbMarkers)
+	{
+		if (found)
+		{
+			for (size_t i=0; i<markers.size(); i++) velocity[i] = markers[i].x-last[i].x;
+		} else {
+			// a new set of markers
+			velocity.assign(nbMarkers,0);
+			firstContrast.resize(nbMarkers);
+			for (int i=0; i<nbMarkers; i++) firstContrast[i] = markers[i].contrast;
+		}
+		last = markers;
+	} else {
+		last.clear();
+	}
+
+	return 0;
+}
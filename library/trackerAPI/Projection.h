@@ -0,0 +1,75 @@
+/***************************************************
+This is the header file for the projection tracker.
+
+videoTracker only measures the extension along the gauge
+length: the y coordinate of every blob is discarded.  The
+projection tracker therefore never segments the ROI in 2D:
+every column of the ROI is summed into a 1D intensity
+profile (one pass over the pixels, the inner loop runs
+along the contiguous axis of the frame), the profile is
+smoothed with a box filter and the markers are the peaks of
+the profile above its median (the background).
+
+A marker is located by its two edges, where the profile
+crosses half way between the background and the peak,
+interpolated linearly between columns; its position is the
+middle of the edges.  For a uniform marker on a uniform
+background this is the x centroid of the blob tracker.
+
+The peaks found in the first frame are followed from frame
+to frame: each one is searched within a window around its
+last position plus its last displacement, and the whole
+profile is searched again when a peak falls below half of
+its first contrast, reaches the window edge or the markers
+no longer come in order.  Markers are reported from left to
+right.
+**************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "BlobTracker.h"
+
+struct ProfileMarker
+{
+	// 1-based ROI coordinates, as the blob centroids
+	double x;
+	double leftEdge, rightEdge;
+	double contrast;
+};
+
+class ProjectionTracker
+{
+public:
+	ProjectionTracker();
+
+	// polarity 1 for markers brighter than the background, -1 for darker ones;
+	// smoothing is the width of the box filter (odd), window the search margin in pixels
+	int setOptions(int nbMarkers, int smoothing, int polarity, int window);
+	// as imcrop, forgets the markers
+	int setROI(double xmin, double ymin, double width, double height);
+	int track(const ImageView &frame, std::vector<ProfileMarker> &markers);
+	// mean intensity of every column of the ROI in the last frame
+	const std::vector<double>& getProfile() const { return profile; }
+
+private:
+	int clipROI(const ImageView &frame);
+	void project(const ImageView &frame);
+	bool findEdges(int peak, ProfileMarker &marker);
+	int searchAll(std::vector<ProfileMarker> &markers);
+	bool searchWindows(std::vector<ProfileMarker> &markers);
+
+	int nbMarkers, smoothing, polarity, window;
+	double roi[4];
+	int x0, x1, y0, y1;
+
+	std::vector<uint32_t> sums;
+	std::vector<double> profile, smoothed, sorted;
+	double background;
+
+	// markers of the last frame, with their displacement and first contrast
+	std::vector<ProfileMarker> last;
+	std::vector<double> velocity, firstContrast;
+};
@@ -0,0 +1,243 @@
+/***************************************************
+Triangulation and element strains of a grid of markers,
+see Strain.h.
+**************************************************/
+
+#include "Strain.h"
+
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+using namespace std;
+
+// a triangle with the vertex at infinity (c) is the outside of its edge a-b
+static const int GHOST = -1;
+
+struct Triangle
+{
+	int a, b, c;
+	// circumcircle
+	double cx, cy, r2;
+};
+
+static bool circumcircle(const double* x, const double* y, Triangle &t)
+{
+	double ax = x[t.a], ay = y[t.a], bx = x[t.b], by = y[t.b], cx = x[t.c], cy = y[t.c];
+	double d = 2*(ax*(by-cy) + bx*(cy-ay) + cx*(ay-by));
+	if (d == 0) return false;
+
+	double a2 = ax*ax+ay*ay, b2 = bx*bx+by*by, c2 = cx*cx+cy*cy;
+	t.cx = (a2*(by-cy) + b2*(cy-ay) + c2*(ay-by))/d;
+	t.cy = (a2*(cx-bx) + b2*(ax-cx) + c2*(bx-ax))/d;
+	t.r2 = (ax-t.cx)*(ax-t.cx) + (ay-t.cy)*(ay-t.cy);
+	return true;
+}
+
+// twice the signed area of a, b, p: positive when p is left of a->b
+static double orient(const double* x, const double* y, int a, int b, int p)
+{
+	return (x[b]-x[a])*(y[p]-y[a]) - (y[b]-y[a])*(x[p]-x[a]);
+}
+
+// the circumcircle of a ghost triangle is the half-plane outside its edge,
+// and the edge itself so that a point on the hull splits it
+static bool inCircle(const double* x, const double* y, const Triangle &t, int p, double eps)
+{
+	if (t.c != GHOST)
+	{
+		double dx = x[p]-t.cx, dy = y[p]-t.cy;
+		return dx*dx+dy*dy < t.r2-eps;
+	}
+	double o = orient(x, y, t.a, t.b, p);
+	if (o > eps) return true;
+	if (o < -eps) return false;
+	double along = (x[p]-x[t.a])*(x[t.b]-x[t.a]) + (y[p]-y[t.a])*(y[t.b]-y[t.a]);
+	double length2 = (x[t.b]-x[t.a])*(x[t.b]-x[t.a]) + (y[t.b]-y[t.a])*(y[t.b]-y[t.a]);
+	return along > 0 && along < length2;
+}
+
+void triangulate(const double* x, const double* y, int n, double minArea, vector<int> &triangles)
+{
+	triangles.clear();
+	if (n < 3) return;
+
+	double minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+	for (int i=1; i<n; i++)
+	{
+		minX = min(minX,x[i]); maxX = max(maxX,x[i]);
+		minY = min(minY,y[i]); maxY = max(maxY,y[i]);
+	}
+	double size = max(max(maxX-minX,maxY-minY),1.0);
+	// relative tolerance of the in-circle test, for the co-circular points of regular grids
+	double eps = 1e-12*size*size;
+
+	// the first triangle: the first point, the next one apart from it and the next one off their line
+	int p0 = 0, p1 = 1, p2;
+	while (p1 < n && x[p1] == x[p0] && y[p1] == y[p0]) p1++;
+	if (p1 >= n) return;
+	for (p2=p1+1; p2<n; p2++) if (fabs(orient(x, y, p0, p1, p2)) > eps) break;
+	if (p2 >= n) return;
+	if (orient(x, y, p0, p1, p2) < 0) swap(p1,p2);
+
+	// counter-clockwise, and the ghosts outside its edges: Bowyer-Watson with the vertex at infinity
+	// instead of a finite super-triangle, whose corners would cut off triangles along the hull
+	vector<Triangle> mesh;
+	Triangle first;
+	first.a = p0; first.b = p1; first.c = p2;
+	circumcircle(x, y, first);
+	mesh.push_back(first);
+	int corners[3] = {p0, p1, p2};
+	for (int i=0; i<3; i++)
+	{
+		Triangle ghost;
+		ghost.a = corners[(i+1)%3];
+		ghost.b = corners[i];
+		ghost.c = GHOST;
+		mesh.push_back(ghost);
+	}
+
+	vector<pair<int,int> > edges;
+	vector<Triangle> kept;
+	for (int p=0; p<n; p++)
+	{
+		if (p == p0 || p == p1 || p == p2) continue;
+
+		// the triangles whose circumcircle contains the point leave a cavity
+		edges.clear();
+		kept.clear();
+		for (size_t t=0; t<mesh.size(); t++)
+		{
+			const Triangle &tri = mesh[t];
+			if (inCircle(x, y, tri, p, eps))
+			{
+				edges.push_back(make_pair(tri.a,tri.b));
+				edges.push_back(make_pair(tri.b,tri.c));
+				edges.push_back(make_pair(tri.c,tri.a));
+			} else {
+				kept.push_back(tri);
+			}
+		}
+		if (edges.empty()) continue;
+
+		// the edges of the cavity are the edges that only one removed triangle has
+		vector<pair<int,int> > sorted(edges.size());
+		for (size_t e=0; e<edges.size(); e++) sorted[e] = make_pair(min(edges[e].first,edges[e].second),max(edges[e].first,edges[e].second));
+		vector<pair<int,int> > shared(sorted);
+		sort(shared.begin(),shared.end());
+		mesh.swap(kept);
+		for (size_t e=0; e<edges.size(); e++)
+		{
+			size_t count = upper_bound(shared.begin(),shared.end(),sorted[e]) - lower_bound(shared.begin(),shared.end(),sorted[e]);
+			if (count != 1) continue;
+
+			// the ghost vertex goes last
+			Triangle tri;
+			if (edges[e].first == GHOST)
+			{
+				tri.a = edges[e].second; tri.b = p; tri.c = GHOST;
+			} else if (edges[e].second == GHOST) {
+				tri.a = p; tri.b = edges[e].first; tri.c = GHOST;
+			} else {
+				tri.a = edges[e].first; tri.b = edges[e].second; tri.c = p;
+				if (!circumcircle(x, y, tri)) continue;
+			}
+			mesh.push_back(tri);
+		}
+	}
+
+	for (size_t t=0; t<mesh.size(); t++)
+	{
+		const Triangle &tri = mesh[t];
+		if (tri.c == GHOST) continue;
+
+		double area = 0.5*orient(x, y, tri.a, tri.b, tri.c);
+		if (fabs(area) < minArea) continue;
+		triangles.push_back(tri.a);
+		// counter-clockwise
+		triangles.push_back(area > 0 ? tri.b : tri.c);
+		triangles.push_back(area > 0 ? tri.c : tri.b);
+	}
+}
+
+StrainField::StrainField()
+{
+	nbPoints = 0;
+}
+
+int StrainField::setReference(const double* x, const double* y, int n)
+{
+	refX.assign(x,x+n);
+	refY.assign(y,y+n);
+	nbPoints = n;
+
+	// slivers from nearly aligned markers would amplify the noise of the positions
+	double minX = n ? x[0] : 0, maxX = minX, minY = n ? y[0] : 0, maxY = minY;
+	for (int i=1; i<n; i++)
+	{
+		minX = min(minX,x[i]); maxX = max(maxX,x[i]);
+		minY = min(minY,y[i]); maxY = max(maxY,y[i]);
+	}
+	double extent = max(maxX-minX,maxY-minY);
+	triangulate(x, y, n, 1e-6*extent*extent, triangles);
+
+	int nbElems = triangles.size()/3;
+	node0.resize(nbElems); node1.resize(nbElems); node2.resize(nbElems);
+	bx0.resize(nbElems); bx1.resize(nbElems); bx2.resize(nbElems);
+	by0.resize(nbElems); by1.resize(nbElems); by2.resize(nbElems);
+	for (int e=0; e<nbElems; e++)
+	{
+		int a = triangles[3*e], b = triangles[3*e+1], c = triangles[3*e+2];
+		node0[e] = a; node1[e] = b; node2[e] = c;
+
+		// linear shape functions: dN_i/dX = (y_j - y_k)/2A, dN_i/dY = (x_k - x_j)/2A
+		double twoArea = (x[b]-x[a])*(y[c]-y[a]) - (x[c]-x[a])*(y[b]-y[a]);
+		bx0[e] = (y[b]-y[c])/twoArea; by0[e] = (x[c]-x[b])/twoArea;
+		bx1[e] = (y[c]-y[a])/twoArea; by1[e] = (x[a]-x[c])/twoArea;
+		bx2[e] = (y[a]-y[b])/twoArea; by2[e] = (x[b]-x[a])/twoArea;
+	}
+
+	return nbElems > 0 ? 0 : -1;
+}
+
+void StrainField::computeFrame(const double* x, const double* y, float* strain)
+{
+	int nbElems = node0.size();
+	const double* rx = &refX[0];
+	const double* ry = &refY[0];
+	for (int e=0; e<nbElems; e++)
+	{
+		int a = node0[e], b = node1[e], c = node2[e];
+		double ua = x[a]-rx[a], ub = x[b]-rx[b], uc = x[c]-rx[c];
+		double va = y[a]-ry[a], vb = y[b]-ry[b], vc = y[c]-ry[c];
+
+		// displacement gradient
+		double uX = ua*bx0[e] + ub*bx1[e] + uc*bx2[e];
+		double uY = ua*by0[e] + ub*by1[e] + uc*by2[e];
+		double vX = va*bx0[e] + vb*bx1[e] + vc*bx2[e];
+		double vY = va*by0[e] + vb*by1[e] + vc*by2[e];
+
+		// Green-Lagrange strain
+		strain[3*e] = (float)(uX + 0.5*(uX*uX + vX*vX));
+		strain[3*e+1] = (float)(vY + 0.5*(uY*uY + vY*vY));
+		strain[3*e+2] = (float)(0.5*(uY + vX + uX*uY + vX*vY));
+	}
+}
+
+int StrainField::compute(const double* x, const double* y, ptrdiff_t frameStride, int nbFrames, float* strain, int nbThreads)
+{
+	if (node0.empty()) return -2;
+	if (!x || !y || !strain || nbFrames < 0 || nbThreads < 0) return -1;
+
+	pool.setThreads(nbThreads);
+	int nbWorkers = max(min(pool.size(),nbFrames),1);
+	size_t frameSize = 3*node0.size();
+
+	atomic<int> nextFrame(0);
+	pool.run(nbWorkers, [&](int)
+	{
+		int f;
+		while ((f = nextFrame++) < nbFrames) computeFrame(x + f*frameStride, y + f*frameStride, strain + f*frameSize);
+	});
+
+	return 0;
+}
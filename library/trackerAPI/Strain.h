@@ -0,0 +1,61 @@
+/***************************************************
+This is the header file for the full-field strain of a
+grid of markers.
+
+The markers of the reference frame are triangulated once
+(Delaunay, Bowyer-Watson with a vertex at infinity instead
+of a super-triangle, so that the triangles cover the whole
+convex hull), and every triangle is a linear element: its
+displacement gradient H = du/dX is constant and follows
+from the displacements of its three markers and the
+gradients of the shape functions, which only depend on the
+reference and are precomputed.  The strain of an element
+is the Green-Lagrange tensor
+    E = (H + H' + H'H)/2
+stored as exx, eyy, exy (tensor, not engineering, shear).
+
+Markers are stored as separate x and y arrays per frame
+(structure of arrays) and so are the element data, so the
+element loop is a straight sequence of multiply-adds the
+compiler can vectorise.  Frames are independent and are
+shared among the threads.  The strains are written as
+floats, frame after frame, 3 per element.
+**************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include "WorkerPool.h"
+
+// Delaunay triangles of n points, 3 point indices per triangle, counter-clockwise;
+// triangles with an area below minArea are dropped
+void triangulate(const double* x, const double* y, int n, double minArea, std::vector<int> &triangles);
+
+class StrainField
+{
+public:
+	StrainField();
+
+	// triangulates the markers of the reference frame, -1 when there is no triangle
+	int setReference(const double* x, const double* y, int n);
+	int nbMarkers() const { return nbPoints; }
+	int nbElements() const { return (int)node0.size(); }
+	const std::vector<int>& getTriangles() const { return triangles; }
+
+	// x and y hold nbFrames frames of nbMarkers() positions, frame f starts at x + f*frameStride,
+	// strain receives nbFrames x nbElements() x 3 floats (exx, eyy, exy)
+	int compute(const double* x, const double* y, ptrdiff_t frameStride, int nbFrames, float* strain, int nbThreads);
+
+private:
+	void computeFrame(const double* x, const double* y, float* strain);
+
+	int nbPoints;
+	std::vector<double> refX, refY;
+	std::vector<int> triangles;
+	// per element: nodes and shape function gradients dN/dX, dN/dY of its three nodes
+	std::vector<int> node0, node1, node2;
+	std::vector<double> bx0, bx1, bx2, by0, by1, by2;
+	WorkerPool pool;
+};
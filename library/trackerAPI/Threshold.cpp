@@ -0,0 +1,162 @@
+/***************************************************
+Histogram and Otsu threshold of the blob tracker, see
+Threshold.h.
+**************************************************/
+
+#include "Threshold.h"
+
+#include <string.h>
+#include <math.h>
+
+void accumulateHistogram(const uint8_t* data, ptrdiff_t stride, size_t n, unsigned int* hist)
+{
+	unsigned int banks[4][256];
+	memset(banks,0,sizeof(banks));
+
+	size_t i = 0;
+	if (stride == 1)
+	{
+		for (; i+8 <= n; i+=8)
+		{
+			uint64_t w;
+			memcpy(&w,data+i,8);
+			banks[0][w & 0xFF]++;
+			banks[1][(w >> 8) & 0xFF]++;
+			banks[2][(w >> 16) & 0xFF]++;
+			banks[3][(w >> 24) & 0xFF]++;
+			banks[0][(w >> 32) & 0xFF]++;
+			banks[1][(w >> 40) & 0xFF]++;
+			banks[2][(w >> 48) & 0xFF]++;
+			banks[3][w >> 56]++;
+		}
+	} else {
+		for (; i+4 <= n; i+=4)
+		{
+			banks[0][data[i*stride]]++;
+			banks[1][data[(i+1)*stride]]++;
+			banks[2][data[(i+2)*stride]]++;
+			banks[3][data[(i+3)*stride]]++;
+		}
+	}
+	for (; i<n; i++) banks[0][data[i*stride]]++;
+
+	for (int j=0; j<256; j++) hist[j] += banks[0][j]+banks[1][j]+banks[2][j]+banks[3][j];
+}
+
+double otsuLevel(const unsigned int* hist)
+{
+	// with N pixels, S the sum of the bin indices, c and I the prefix sums up to bin k,
+	// the between-class variance of graythresh is (S*c - N*I)^2 / (N^2 * c * (N-c))
+	double N = 0, S = 0;
+	for (int i=0; i<256; i++)
+	{
+		N += hist[i];
+		S += (double)i*hist[i];
+	}
+	if (N == 0) return 0;
+
+	double c = 0, I = 0, maxSigma = -1, sumIdx = 0;
+	int nbIdx = 0;
+	for (int i=0; i<256; i++)
+	{
+		c += hist[i];
+		I += (double)i*hist[i];
+		if (c == 0 || c == N) continue;
+
+		double d = S*c - N*I;
+		double sigma = d*d/(c*(N-c));
+		if (sigma > maxSigma)
+		{
+			maxSigma = sigma;
+			sumIdx = i;
+			nbIdx = 1;
+		} else if (sigma == maxSigma) {
+			sumIdx += i;
+			nbIdx++;
+		}
+	}
+	if (nbIdx == 0) return 0;
+
+	return sumIdx/nbIdx/255.0;
+}
+
+double histogramDistance(const unsigned int* a, const unsigned int* b)
+{
+	double na = 0, nb = 0;
+	for (int i=0; i<256; i++)
+	{
+		na += a[i];
+		nb += b[i];
+	}
+	if (na == 0 || nb == 0) return na == nb ? 0 : 1;
+
+	double d = 0;
+	for (int i=0; i<256; i++) d += fabs(a[i]/na - b[i]/nb);
+
+	return 0.5*d;
+}
+
+OtsuThreshold::OtsuThreshold()
+{
+	maxDrift = 0;
+	sampling = 1;
+	reset();
+}
+
+int OtsuThreshold::setOptions(double maxDrift, int sampling)
+{
+	if (maxDrift < 0 || maxDrift > 1 || sampling < 1) return -1;
+
+	this->maxDrift = maxDrift;
+	this->sampling = sampling;
+	reset();
+
+	return 0;
+}
+
+void OtsuThreshold::reset()
+{
+	hasLevel = false;
+	lastLevel = 0;
+	nbComputed = 0;
+	nbReused = 0;
+}
+
+void OtsuThreshold::getStats(int* computed, int* reused)
+{
+	if (!computed || !reused) return;
+
+	*computed = nbComputed;
+	*reused = nbReused;
+}
+
+double OtsuThreshold::level(const uint8_t* origin, int lineLength, int nbLines, ptrdiff_t uStride, ptrdiff_t vStride, int channels, ptrdiff_t cStride)
+{
+	memset(histogram,0,sizeof(histogram));
+
+	size_t n = (lineLength+sampling-1)/sampling;
+	for (int v=0; v<nbLines; v+=sampling)
+	{
+		const uint8_t* line = origin + v*vStride;
+		if (sampling == 1 && cStride == 1 && uStride == channels)
+		{
+			// interleaved pixels: all channels of a line are contiguous
+			accumulateHistogram(line,1,lineLength*channels,histogram);
+		} else {
+			for (int c=0; c<channels; c++) accumulateHistogram(line+c*cStride,uStride*sampling,n,histogram);
+		}
+	}
+
+	if (hasLevel && maxDrift > 0 && histogramDistance(histogram,reference) <= maxDrift)
+	{
+		nbReused++;
+		return lastLevel;
+	}
+
+	lastLevel = otsuLevel(histogram);
+	memcpy(reference,histogram,sizeof(histogram));
+	hasLevel = true;
+	nbComputed++;
+
+	return lastLevel;
+}
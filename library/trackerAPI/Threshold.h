@@ -0,0 +1,59 @@
+/***************************************************
+This is the header file for the binarisation threshold
+of the blob tracker: the 256 bin histogram and Otsu's
+method of graythresh.
+
+The histogram is counted in four banks so that runs of
+equal pixel values (the background of the ROI) do not
+serialise on a single counter, and contiguous lines are
+read eight bytes at a time.  Otsu's level is found from
+integer prefix sums of the histogram in a single sweep.
+
+OtsuThreshold adds two ways to do less work per frame:
+ - sampling: only every n-th pixel along and across the
+   lines of the ROI is counted, for very large ROIs;
+ - maxDrift: the previous level is kept as long as the
+   histogram stays within maxDrift (total variation
+   distance between the normalised histograms, 0..1) of
+   the histogram the level was computed from.
+With the defaults (sampling 1, maxDrift 0) the level is
+the one graythresh returns for every frame.
+**************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// adds n bytes, stride bytes apart, to hist
+void accumulateHistogram(const uint8_t* data, ptrdiff_t stride, size_t n, unsigned int* hist);
+// Otsu's level in [0,1], as graythresh (ties are averaged)
+double otsuLevel(const unsigned int* hist);
+// total variation distance between two histograms after normalisation, in [0,1]
+double histogramDistance(const unsigned int* a, const unsigned int* b);
+
+class OtsuThreshold
+{
+public:
+	OtsuThreshold();
+
+	int setOptions(double maxDrift, int sampling);
+	// forget the previous level, e.g. when the ROI changes
+	void reset();
+
+	// level of a region made of nbLines lines of lineLength pixels with the given channels
+	double level(const uint8_t* origin, int lineLength, int nbLines, ptrdiff_t uStride, ptrdiff_t vStride, int channels, ptrdiff_t cStride);
+
+	// number of frames for which Otsu's level was computed or reused
+	void getStats(int* computed, int* reused);
+
+private:
+	double maxDrift;
+	int sampling;
+
+	unsigned int histogram[256];
+	unsigned int reference[256];
+	bool hasLevel;
+	double lastLevel;
+	int nbComputed, nbReused;
+};
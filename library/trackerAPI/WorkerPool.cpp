@@ -0,0 +1,90 @@
+/***************************************************
+Worker pool of the trackers, see WorkerPool.h.
+**************************************************/
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+using namespace std;
+
+WorkerPool::WorkerPool()
+{
+	nbThreads = 0;
+	started = false;
+	task = NULL;
+	nbTasks = pending = 0;
+	generation = 0;
+	stopping = false;
+}
+
+WorkerPool::~WorkerPool()
+{
+	stop();
+}
+
+void WorkerPool::setThreads(int nbThreads)
+{
+	this->nbThreads = max(nbThreads,0);
+}
+
+int WorkerPool::size()
+{
+	int n = nbThreads > 0 ? nbThreads : max((int)thread::hardware_concurrency(),1);
+	if (!started || n != (int)threads.size()+1)
+	{
+		stop();
+		started = true;
+		for (int i=1; i<n; i++) threads.push_back(thread(&WorkerPool::work, this, i, generation));
+	}
+	return (int)threads.size()+1;
+}
+
+void WorkerPool::stop()
+{
+	{
+		unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+		wake.notify_all();
+	}
+	for (size_t i=0; i<threads.size(); i++) threads[i].join();
+	threads.clear();
+	stopping = false;
+}
+
+void WorkerPool::run(int nbTasks, const function<void(int)> &task)
+{
+	nbTasks = min(nbTasks,size());
+	if (nbTasks > 1)
+	{
+		unique_lock<std::mutex> lock(mutex);
+		this->task = &task;
+		this->nbTasks = nbTasks;
+		pending = nbTasks-1;
+		generation++;
+		wake.notify_all();
+	}
+	if (nbTasks > 0) task(0);
+	if (nbTasks > 1)
+	{
+		unique_lock<std::mutex> lock(mutex);
+		while (pending > 0) done.wait(lock);
+	}
+}
+
+void WorkerPool::work(int index, unsigned int seen)
+{
+	unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		while (!stopping && generation == seen) wake.wait(lock);
+		if (stopping) return;
+		seen = generation;
+		if (index >= nbTasks) continue;
+
+		const function<void(int)>* t = task;
+		lock.unlock();
+		(*t)(index);
+		lock.lock();
+		if (--pending == 0) done.notify_one();
+	}
+}
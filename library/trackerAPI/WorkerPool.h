@@ -0,0 +1,52 @@
+/***************************************************
+This is the header file for the worker pool of the
+trackers.
+
+The trackers split every frame (or every call) in a few
+tasks: the stripes of the blob tracker, the subsets of the
+correlation tracker, the frames of the strain field.  The
+threads are created at the first run after the number of
+threads is set and wait between the runs, so that a frame
+does not pay for creating and joining them.
+Task 0 runs on the calling thread.
+**************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool
+{
+public:
+	WorkerPool();
+	~WorkerPool();
+
+	// nbThreads workers in all, the calling thread included, 0 for one per core
+	void setThreads(int nbThreads);
+	// starts the threads if needed
+	int size();
+	// task(i) for i from 0 to nbTasks-1 (at most size()), returns when they are all done
+	void run(int nbTasks, const std::function<void(int)> &task);
+
+private:
+	WorkerPool(const WorkerPool&);
+	WorkerPool& operator=(const WorkerPool&);
+
+	void stop();
+	void work(int index, unsigned int seen);
+
+	int nbThreads;
+	bool started;
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	// the current run: every new one increments generation
+	const std::function<void(int)>* task;
+	int nbTasks, pending;
+	unsigned int generation;
+	bool stopping;
+};
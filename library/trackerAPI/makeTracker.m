@@ -0,0 +1,28 @@
+function makeTracker
+% function makeTracker
+% makeTracker compiles mexBlobTracker, the native blob tracker used by
+% videoTracker when the 'native' option is given, mexCorrelationTracker,
+% the subset correlation tracker used with the 'correlation' option,
+% mexMarkerTracker, which keeps the identity of the blobs and measures
+% them, mexStrainField, the strain field of a grid of blobs used with the
+% 'strain' option, and mexProjectionTracker, the 1D tracker used with the
+% 'projection' option.  Any C++ compiler that mex is configured with will
+% do (type mex -setup at the matlab prompt if needed).
+%
+% The same sources build without Matlab, see trackVideo.cpp.
+
+sources = {'BlobTracker.cpp', 'Threshold.cpp', 'BinaryImage.cpp', 'Labelling.cpp', 'Prediction.cpp', 'CorrelationTracker.cpp', 'FFT.cpp', 'Markers.cpp', 'Strain.cpp', 'Projection.cpp', 'WorkerPool.cpp'};
+mexFiles = {'mexBlobTracker.cpp', 'mexCorrelationTracker.cpp', 'mexMarkerTracker.cpp', 'mexStrainField.cpp', 'mexProjectionTracker.cpp'};
+
+currentdir = pwd;
+cd(fileparts(mfilename('fullpath')));
+try
+    for i = 1:numel(mexFiles)
+        disp(['Running: mex -O ' mexFiles{i} ' ' sprintf('%s ',sources{:})]);
+        mex('-O', mexFiles{i}, sources{:});
+    end
+catch
+    cd(currentdir);
+    rethrow(lasterror);
+end
+cd(currentdir);
@@ -0,0 +1,195 @@
+/***************************************************
+This is the matlab interface code to the blob tracker.
+It just wraps the tracker functions and does some error
+conversion.
+
+  mexBlobTracker('setOptions', threshold, filter, blobArea, blobs)
+      threshold  level in [0,1], or [] / negative for graythresh
+      filter     [rows cols] of the median filter
+      blobArea   minimum blob area
+      blobs      maximum number of blobs
+  mexBlobTracker('setThresholdOptions', maxDrift, sampling)
+      maxDrift   keep the previous level while the histogram has
+                 drifted less than this (0..1, 0 = every frame)
+      sampling   count every sampling-th pixel of the ROI only
+  [computed, reused] = mexBlobTracker('getThresholdStats')
+  mexBlobTracker('setThreads', threads)
+      threads    number of stripes the ROI is tracked in parallel
+                 with, 0 = one per core (default)
+  mexBlobTracker('setPrediction', mode, margin)
+      mode       0 = search the whole ROI in every frame (default),
+                 1 = constant velocity, 2 = Kalman filter: only
+                 search windows around the predicted markers
+      margin     pixels added around the last bounding box of a
+                 marker to make its window
+  [windowed, full] = mexBlobTracker('getPredictionStats')
+  mexBlobTracker('setROI', [xmin ymin width height])
+  [centroid, bBox, level, mask, area, weighted, labels] = mexBlobTracker('track', frame)
+      frame      HxW or HxWx3 uint8 image
+      centroid   Nx2 [x y], bBox Nx4 int32 [x y width height],
+                 both in ROI coordinates as vision.BlobAnalysis
+      mask       filtered binary ROI, only computed when requested
+      area       Nx1 int32 blob areas
+      weighted   Nx2 [x y] centroids weighted by the intensity of
+                 the first channel
+      labels     int32 ROI image with the blob index per pixel (0 for
+                 the background), only computed when requested
+**************************************************/
+
+#include "mex.h"
+#include "BlobTracker.h"
+
+#include <string.h>
+#include <vector>
+using namespace std;
+
+BlobTracker BT;
+vector<Blob> blobs;
+
+const char* message(int err)
+{
+	switch (err)
+	{
+		case 0: return "";
+		case -1: return "Invalid parameters";
+		case -3: return "The ROI is outside of the frame";
+		default: return "Unknown error";
+	}
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (nrhs < 1 || !mxIsChar(prhs[0])) mexErrMsgTxt("First parameter must be the command (a string)");
+
+	char cmd[100];
+	mxGetString(prhs[0],cmd,100);
+
+	if (!strcmp("setOptions",cmd))
+	{
+		if (nrhs < 5 || !mxIsNumeric(prhs[2]) || mxGetNumberOfElements(prhs[2]) != 2) mexErrMsgTxt("setOptions: parameters must be threshold, filter ([rows cols]), blobArea, blobs");
+		if (nlhs > 0) mexErrMsgTxt("setOptions: there are no outputs");
+
+		double threshold = mxIsEmpty(prhs[1])?-1:mxGetScalar(prhs[1]);
+		double* filter = mxGetPr(prhs[2]);
+		const char* errmsg = message(BT.setOptions(threshold, (int)filter[0], (int)filter[1], (int)mxGetScalar(prhs[3]), (int)mxGetScalar(prhs[4])));
+
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+	} else if (!strcmp("setThresholdOptions",cmd)) {
+		if (nrhs < 3 || !mxIsNumeric(prhs[1]) || !mxIsNumeric(prhs[2])) mexErrMsgTxt("setThresholdOptions: parameters must be maxDrift and sampling");
+		if (nlhs > 0) mexErrMsgTxt("setThresholdOptions: there are no outputs");
+
+		const char* errmsg = message(BT.setThresholdOptions(mxGetScalar(prhs[1]), (int)mxGetScalar(prhs[2])));
+
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+	} else if (!strcmp("getThresholdStats",cmd)) {
+		if (nlhs > 2) mexErrMsgTxt("getThresholdStats: there are only 2 output values: computed, reused");
+
+		int computed, reused;
+		BT.getThresholdStats(&computed, &reused);
+
+		if (nlhs >= 1) {plhs[0] = mxCreateDoubleMatrix(1,1,mxREAL); mxGetPr(plhs[0])[0] = computed; }
+		if (nlhs >= 2) {plhs[1] = mxCreateDoubleMatrix(1,1,mxREAL); mxGetPr(plhs[1])[0] = reused; }
+	} else if (!strcmp("setThreads",cmd)) {
+		if (nrhs < 2 || !mxIsNumeric(prhs[1])) mexErrMsgTxt("setThreads: second parameter must be the number of threads");
+		if (nlhs > 0) mexErrMsgTxt("setThreads: there are no outputs");
+
+		const char* errmsg = message(BT.setThreads((int)mxGetScalar(prhs[1])));
+
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+	} else if (!strcmp("setPrediction",cmd)) {
+		if (nrhs < 3 || !mxIsNumeric(prhs[1]) || !mxIsNumeric(prhs[2])) mexErrMsgTxt("setPrediction: parameters must be mode and margin");
+		if (nlhs > 0) mexErrMsgTxt("setPrediction: there are no outputs");
+
+		const char* errmsg = message(BT.setPrediction((int)mxGetScalar(prhs[1]), (int)mxGetScalar(prhs[2])));
+
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+	} else if (!strcmp("getPredictionStats",cmd)) {
+		if (nlhs > 2) mexErrMsgTxt("getPredictionStats: there are only 2 output values: windowed, full");
+
+		int windowed, full;
+		BT.getPredictionStats(&windowed, &full);
+
+		if (nlhs >= 1) {plhs[0] = mxCreateDoubleMatrix(1,1,mxREAL); mxGetPr(plhs[0])[0] = windowed; }
+		if (nlhs >= 2) {plhs[1] = mxCreateDoubleMatrix(1,1,mxREAL); mxGetPr(plhs[1])[0] = full; }
+	} else if (!strcmp("setROI",cmd)) {
+		if (nrhs < 2 || !mxIsDouble(prhs[1]) || mxGetNumberOfElements(prhs[1]) != 4) mexErrMsgTxt("setROI: second parameter must be the ROI [xmin ymin width height]");
+		if (nlhs > 0) mexErrMsgTxt("setROI: there are no outputs");
+
+		double* rect = mxGetPr(prhs[1]);
+		const char* errmsg = message(BT.setROI(rect[0], rect[1], rect[2], rect[3]));
+
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+	} else if (!strcmp("track",cmd)) {
+		if (nrhs < 2 || !mxIsUint8(prhs[1])) mexErrMsgTxt("track: second parameter must be the frame (as uint8)");
+		if (nlhs > 7) mexErrMsgTxt("track: there are only 7 output values: centroid, bBox, level, mask, area, weighted, labels");
+
+		mwSize nrDims = mxGetNumberOfDimensions(prhs[1]);
+		const mwSize* dims = mxGetDimensions(prhs[1]);
+		int height = dims[0], width = dims[1], channels = nrDims > 2 ? dims[2] : 1;
+		ImageView frame = matlabView((const uint8_t*)mxGetData(prhs[1]), width, height, channels);
+
+		double level;
+		MaskView mask;
+		LabelView labels;
+		int roiWidth, roiHeight;
+		if (nlhs >= 4)
+		{
+			const char* errmsg = message(BT.getROISize(frame, &roiWidth, &roiHeight));
+			if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+			plhs[3] = mxCreateLogicalMatrix(roiHeight, roiWidth);
+			mask.data = (uint8_t*)mxGetLogicals(plhs[3]);
+			mask.xStride = roiHeight;
+			mask.yStride = 1;
+		}
+		if (nlhs >= 7)
+		{
+			plhs[6] = mxCreateNumericMatrix(roiHeight, roiWidth, mxINT32_CLASS, mxREAL);
+			labels.data = (int32_t*)mxGetData(plhs[6]);
+			labels.xStride = roiHeight;
+			labels.yStride = 1;
+		}
+		const char* errmsg = message(BT.track(frame, blobs, &level, nlhs >= 4 ? &mask : NULL, nlhs >= 7 ? &labels : NULL));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		int nrBlobs = blobs.size();
+		plhs[0] = mxCreateDoubleMatrix(nrBlobs,2,mxREAL);
+		double* centroid = mxGetPr(plhs[0]);
+		for (int i=0; i<nrBlobs; i++)
+		{
+			centroid[i] = blobs[i].centroidX;
+			centroid[i+nrBlobs] = blobs[i].centroidY;
+		}
+		if (nlhs >= 2)
+		{
+			plhs[1] = mxCreateNumericMatrix(nrBlobs,4,mxINT32_CLASS,mxREAL);
+			int* bBox = (int*)mxGetData(plhs[1]);
+			for (int i=0; i<nrBlobs; i++)
+			{
+				bBox[i] = blobs[i].bboxX;
+				bBox[i+nrBlobs] = blobs[i].bboxY;
+				bBox[i+2*nrBlobs] = blobs[i].bboxW;
+				bBox[i+3*nrBlobs] = blobs[i].bboxH;
+			}
+		}
+		if (nlhs >= 3) {plhs[2] = mxCreateDoubleMatrix(1,1,mxREAL); mxGetPr(plhs[2])[0] = level; }
+		if (nlhs >= 5)
+		{
+			plhs[4] = mxCreateNumericMatrix(nrBlobs,1,mxINT32_CLASS,mxREAL);
+			int* area = (int*)mxGetData(plhs[4]);
+			for (int i=0; i<nrBlobs; i++) area[i] = blobs[i].area;
+		}
+		if (nlhs >= 6)
+		{
+			plhs[5] = mxCreateDoubleMatrix(nrBlobs,2,mxREAL);
+			double* weighted = mxGetPr(plhs[5]);
+			for (int i=0; i<nrBlobs; i++)
+			{
+				weighted[i] = blobs[i].weightedX;
+				weighted[i+nrBlobs] = blobs[i].weightedY;
+			}
+		}
+	} else {
+		mexErrMsgTxt("Unknown command");
+	}
+}
@@ -0,0 +1,107 @@
+/***************************************************
+This is the matlab interface code to the subset
+correlation tracker.  It just wraps the tracker functions
+and does some error conversion.
+
+  mexCorrelationTracker('setOptions', subset, search, levels, threads)
+      subset     side of the square subsets in pixels
+      search     largest displacement searched between two frames,
+                 in pixels of the coarsest pyramid level
+      levels     number of pyramid levels (1 = full resolution only)
+      threads    0 = one per core
+  mexCorrelationTracker('setReference', frame, positions)
+      frame      HxW or HxWx3 uint8 image
+      positions  Nx2 [x y] centres of the subsets, in frame coordinates
+  [positions, score] = mexCorrelationTracker('track', frame)
+      positions  Nx2 [x y] centres of the subsets in frame
+      score      Nx1 zero-normalised cross-correlation of each subset
+                 with the reference (1 = perfect match)
+**************************************************/
+
+#include "mex.h"
+#include "CorrelationTracker.h"
+
+#include <string.h>
+#include <vector>
+using namespace std;
+
+CorrelationTracker CT;
+vector<Subset> subsets;
+
+const char* message(int err)
+{
+	switch (err)
+	{
+		case 0: return "";
+		case -1: return "Invalid parameters";
+		case -2: return "No reference, call setReference first";
+		case -3: return "The subsets are outside of the frame";
+		default: return "Unknown error";
+	}
+}
+
+ImageView frameView(const mxArray* frame)
+{
+	mwSize nrDims = mxGetNumberOfDimensions(frame);
+	const mwSize* dims = mxGetDimensions(frame);
+	int height = dims[0], width = dims[1], channels = nrDims > 2 ? dims[2] : 1;
+	return matlabView((const uint8_t*)mxGetData(frame), width, height, channels);
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (nrhs < 1 || !mxIsChar(prhs[0])) mexErrMsgTxt("First parameter must be the command (a string)");
+
+	char cmd[100];
+	mxGetString(prhs[0],cmd,100);
+
+	if (!strcmp("setOptions",cmd))
+	{
+		if (nrhs < 5) mexErrMsgTxt("setOptions: parameters must be subset, search, levels, threads");
+		if (nlhs > 0) mexErrMsgTxt("setOptions: there are no outputs");
+
+		const char* errmsg = message(CT.setOptions((int)mxGetScalar(prhs[1]), (int)mxGetScalar(prhs[2]), (int)mxGetScalar(prhs[3]), (int)mxGetScalar(prhs[4])));
+
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+	} else if (!strcmp("setReference",cmd)) {
+		if (nrhs < 3 || !mxIsUint8(prhs[1])) mexErrMsgTxt("setReference: second parameter must be the frame (as uint8)");
+		if (!mxIsDouble(prhs[2]) || mxGetN(prhs[2]) != 2) mexErrMsgTxt("setReference: third parameter must be the Nx2 positions");
+		if (nlhs > 0) mexErrMsgTxt("setReference: there are no outputs");
+
+		int nrSubsets = mxGetM(prhs[2]);
+		double* positions = mxGetPr(prhs[2]);
+		subsets.resize(nrSubsets);
+		for (int i=0; i<nrSubsets; i++)
+		{
+			subsets[i].x = positions[i];
+			subsets[i].y = positions[i+nrSubsets];
+			subsets[i].score = 1;
+		}
+		const char* errmsg = message(CT.setReference(frameView(prhs[1]), subsets));
+
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+	} else if (!strcmp("track",cmd)) {
+		if (nrhs < 2 || !mxIsUint8(prhs[1])) mexErrMsgTxt("track: second parameter must be the frame (as uint8)");
+		if (nlhs > 2) mexErrMsgTxt("track: there are only 2 output values: positions, score");
+
+		const char* errmsg = message(CT.track(frameView(prhs[1]), subsets));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		int nrSubsets = subsets.size();
+		plhs[0] = mxCreateDoubleMatrix(nrSubsets,2,mxREAL);
+		double* positions = mxGetPr(plhs[0]);
+		for (int i=0; i<nrSubsets; i++)
+		{
+			positions[i] = subsets[i].x;
+			positions[i+nrSubsets] = subsets[i].y;
+		}
+		if (nlhs >= 2)
+		{
+			plhs[1] = mxCreateDoubleMatrix(nrSubsets,1,mxREAL);
+			double* score = mxGetPr(plhs[1]);
+			for (int i=0; i<nrSubsets; i++) score[i] = subsets[i].score;
+		}
+	} else {
+		mexErrMsgTxt("Unknown command");
+	}
+}
@@ -0,0 +1,95 @@
+/***************************************************
+This is the matlab interface code to the marker matching
+and measurements.  It just wraps the functions of
+Markers.h and does some error conversion.
+
+  mexMarkerTracker('setReference', positions)
+      positions  Nx2 [x y] markers, their order is their identity
+  [positions, found, index] = mexMarkerTracker('match', detections, maxDistance)
+      detections Mx2 [x y] blobs detected in the new frame, in any order
+      maxDistance  largest displacement of a marker between frames
+      positions  Nx2 [x y] markers in the order of the reference, the
+                 last known position for lost markers
+      found      Nx1 logical, false for the lost markers
+      index      Nx1 row of the detection of each marker, 0 if lost
+  [displacement, distance, distanceChange] = mexMarkerTracker('measure', positions, reference, scale)
+      positions, reference  Nx2 [x y]
+      displacement    1xN distance of each marker from the reference
+      distance        1xN*(N-1)/2 distances between the markers, in
+                      the order of pdist (1-2, 1-3, ..., 2-3, ...)
+      distanceChange  distance minus the same distance in the reference
+      all multiplied by scale
+**************************************************/
+
+#include "mex.h"
+#include "Markers.h"
+
+#include <string.h>
+#include <vector>
+using namespace std;
+
+MarkerMatcher MM;
+vector<int> assignment;
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (nrhs < 1 || !mxIsChar(prhs[0])) mexErrMsgTxt("First parameter must be the command (a string)");
+
+	char cmd[100];
+	mxGetString(prhs[0],cmd,100);
+
+	if (!strcmp("setReference",cmd))
+	{
+		if (nrhs < 2 || !mxIsDouble(prhs[1]) || mxGetN(prhs[1]) != 2) mexErrMsgTxt("setReference: second parameter must be the Nx2 positions");
+		if (nlhs > 0) mexErrMsgTxt("setReference: there are no outputs");
+
+		int n = mxGetM(prhs[1]);
+		double* positions = mxGetPr(prhs[1]);
+		MM.reset(positions, positions+n, n);
+	} else if (!strcmp("match",cmd)) {
+		if (nrhs < 3 || !mxIsDouble(prhs[1]) || (mxGetN(prhs[1]) != 2 && !mxIsEmpty(prhs[1]))) mexErrMsgTxt("match: parameters must be the Mx2 detections and maxDistance");
+		if (nlhs > 3) mexErrMsgTxt("match: there are only 3 output values: positions, found, index");
+
+		int n = mxIsEmpty(prhs[1]) ? 0 : mxGetM(prhs[1]);
+		double* detections = mxGetPr(prhs[1]);
+		MM.match(detections, detections+n, n, mxGetScalar(prhs[2]), assignment);
+
+		int nrMarkers = MM.size();
+		plhs[0] = mxCreateDoubleMatrix(nrMarkers,2,mxREAL);
+		double* positions = mxGetPr(plhs[0]);
+		for (int i=0; i<nrMarkers; i++)
+		{
+			positions[i] = MM.x[i];
+			positions[i+nrMarkers] = MM.y[i];
+		}
+		if (nlhs >= 2)
+		{
+			plhs[1] = mxCreateLogicalMatrix(nrMarkers,1);
+			mxLogical* found = mxGetLogicals(plhs[1]);
+			for (int i=0; i<nrMarkers; i++) found[i] = MM.found[i];
+		}
+		if (nlhs >= 3)
+		{
+			plhs[2] = mxCreateDoubleMatrix(nrMarkers,1,mxREAL);
+			double* index = mxGetPr(plhs[2]);
+			for (int i=0; i<nrMarkers; i++) index[i] = assignment[i]+1;
+		}
+	} else if (!strcmp("measure",cmd)) {
+		if (nrhs < 4 || !mxIsDouble(prhs[1]) || !mxIsDouble(prhs[2]) || mxGetN(prhs[1]) != 2 || mxGetM(prhs[1]) != mxGetM(prhs[2]) || mxGetN(prhs[2]) != 2) mexErrMsgTxt("measure: parameters must be the Nx2 positions and reference, and scale");
+		if (nlhs > 3) mexErrMsgTxt("measure: there are only 3 output values: displacement, distance, distanceChange");
+
+		int n = mxGetM(prhs[1]);
+		double* positions = mxGetPr(prhs[1]);
+		double* reference = mxGetPr(prhs[2]);
+		int nrPairs = n*(n-1)/2;
+
+		plhs[0] = mxCreateDoubleMatrix(1,n,mxREAL);
+		double* distance = NULL;
+		double* distanceChange = NULL;
+		if (nlhs >= 2) {plhs[1] = mxCreateDoubleMatrix(1,nrPairs,mxREAL); distance = mxGetPr(plhs[1]); }
+		if (nlhs >= 3) {plhs[2] = mxCreateDoubleMatrix(1,nrPairs,mxREAL); distanceChange = mxGetPr(plhs[2]); }
+		measureMarkers(positions, positions+n, reference, reference+n, n, mxGetScalar(prhs[3]), mxGetPr(plhs[0]), distance, distanceChange);
+	} else {
+		mexErrMsgTxt("Unknown command");
+	}
+}
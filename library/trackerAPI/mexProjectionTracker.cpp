@@ -0,0 +1,99 @@
+/***************************************************
+This is the matlab interface code to the projection
+tracker.  It just wraps the tracker functions of
+Projection.h and does some error conversion.
+
+  mexProjectionTracker('setOptions', markers, smoothing, polarity, window)
+      markers    number of markers to track
+      smoothing  width of the box filter of the profile (odd)
+      polarity   1 for bright markers, -1 for dark ones
+      window     search margin in pixels around the predicted markers
+  mexProjectionTracker('setROI', [xmin ymin width height])
+  [x, edges, profile] = mexProjectionTracker('track', frame)
+      frame      HxW or HxWx3 uint8 image
+      x          Nx1 positions of the markers, from left to right, in
+                 ROI coordinates as the blob centroids
+      edges      Nx2 [left right] half-contrast edges of the markers
+      profile    1xW mean intensity of each column of the ROI
+**************************************************/
+
+#include "mex.h"
+#include "Projection.h"
+
+#include <string.h>
+#include <vector>
+using namespace std;
+
+ProjectionTracker PT;
+vector<ProfileMarker> markers;
+
+const char* message(int err)
+{
+	switch (err)
+	{
+		case 0: return "";
+		case -1: return "Invalid parameters";
+		case -3: return "The ROI is outside of the frame";
+		default: return "Unknown error";
+	}
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (nrhs < 1 || !mxIsChar(prhs[0])) mexErrMsgTxt("First parameter must be the command (a string)");
+
+	char cmd[100];
+	mxGetString(prhs[0],cmd,100);
+
+	if (!strcmp("setOptions",cmd))
+	{
+		if (nrhs < 5) mexErrMsgTxt("setOptions: parameters must be markers, smoothing, polarity, window");
+		if (nlhs > 0) mexErrMsgTxt("setOptions: there are no outputs");
+
+		const char* errmsg = message(PT.setOptions((int)mxGetScalar(prhs[1]), (int)mxGetScalar(prhs[2]), (int)mxGetScalar(prhs[3]), (int)mxGetScalar(prhs[4])));
+
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+	} else if (!strcmp("setROI",cmd)) {
+		if (nrhs < 2 || !mxIsDouble(prhs[1]) || mxGetNumberOfElements(prhs[1]) != 4) mexErrMsgTxt("setROI: second parameter must be the ROI [xmin ymin width height]");
+		if (nlhs > 0) mexErrMsgTxt("setROI: there are no outputs");
+
+		double* rect = mxGetPr(prhs[1]);
+		const char* errmsg = message(PT.setROI(rect[0], rect[1], rect[2], rect[3]));
+
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+	} else if (!strcmp("track",cmd)) {
+		if (nrhs < 2 || !mxIsUint8(prhs[1])) mexErrMsgTxt("track: second parameter must be the frame (as uint8)");
+		if (nlhs > 3) mexErrMsgTxt("track: there are only 3 output values: x, edges, profile");
+
+		mwSize nrDims = mxGetNumberOfDimensions(prhs[1]);
+		const mwSize* dims = mxGetDimensions(prhs[1]);
+		int height = dims[0], width = dims[1], channels = nrDims > 2 ? dims[2] : 1;
+		ImageView frame = matlabView((const uint8_t*)mxGetData(prhs[1]), width, height, channels);
+
+		const char* errmsg = message(PT.track(frame, markers));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		int nrMarkers = markers.size();
+		plhs[0] = mxCreateDoubleMatrix(nrMarkers,1,mxREAL);
+		double* x = mxGetPr(plhs[0]);
+		for (int i=0; i<nrMarkers; i++) x[i] = markers[i].x;
+		if (nlhs >= 2)
+		{
+			plhs[1] = mxCreateDoubleMatrix(nrMarkers,2,mxREAL);
+			double* edges = mxGetPr(plhs[1]);
+			for (int i=0; i<nrMarkers; i++)
+			{
+				edges[i] = markers[i].leftEdge;
+				edges[i+nrMarkers] = markers[i].rightEdge;
+			}
+		}
+		if (nlhs >= 3)
+		{
+			const vector<double> &profile = PT.getProfile();
+			plhs[2] = mxCreateDoubleMatrix(1,profile.size(),mxREAL);
+			if (!profile.empty()) memcpy(mxGetPr(plhs[2]), &profile[0], profile.size()*sizeof(double));
+		}
+	} else {
+		mexErrMsgTxt("Unknown command");
+	}
+}
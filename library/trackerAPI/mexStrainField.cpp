@@ -0,0 +1,99 @@
+/***************************************************
+This is the matlab interface code to the full-field
+strain of a grid of markers.  It just wraps StrainField
+of Strain.h and does some error conversion.
+
+  triangles = mexStrainField('setReference', positions)
+      positions  Nx2 [x y] markers of the reference frame
+      triangles  Mx3 rows of positions of the corners of each element
+  strain = mexStrainField('compute', positions, threads)
+      positions  Nx2xF [x y] markers, in the order of the reference,
+                 for F frames (NaN for lost markers gives NaN strains)
+      threads    optional, 0 (default) for one per core
+      strain     Mx3xF single, [exx eyy exy] Green-Lagrange strain of
+                 each element in each frame
+**************************************************/
+
+#include "mex.h"
+#include "Strain.h"
+
+#include <string.h>
+#include <vector>
+using namespace std;
+
+StrainField SF;
+vector<float> strain;
+
+const char* message(int err)
+{
+	switch (err)
+	{
+		case 0: return "";
+		case -1: return "Invalid parameters";
+		case -2: return "No reference, call setReference first";
+		default: return "Unknown error";
+	}
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+	if (nrhs < 1 || !mxIsChar(prhs[0])) mexErrMsgTxt("First parameter must be the command (a string)");
+
+	char cmd[100];
+	mxGetString(prhs[0],cmd,100);
+
+	if (!strcmp("setReference",cmd))
+	{
+		if (nrhs < 2 || !mxIsDouble(prhs[1]) || mxGetN(prhs[1]) != 2) mexErrMsgTxt("setReference: second parameter must be the Nx2 positions");
+		if (nlhs > 1) mexErrMsgTxt("setReference: there is only 1 output value: triangles");
+
+		int n = mxGetM(prhs[1]);
+		double* positions = mxGetPr(prhs[1]);
+		if (SF.setReference(positions, positions+n, n) < 0) mexErrMsgTxt("setReference: the markers do not make any triangle");
+
+		const vector<int> &triangles = SF.getTriangles();
+		int nrElements = SF.nbElements();
+		plhs[0] = mxCreateDoubleMatrix(nrElements,3,mxREAL);
+		double* corners = mxGetPr(plhs[0]);
+		for (int e=0; e<nrElements; e++)
+		{
+			for (int k=0; k<3; k++) corners[e+k*nrElements] = triangles[3*e+k]+1;
+		}
+	} else if (!strcmp("compute",cmd)) {
+		if (nrhs < 2 || !mxIsDouble(prhs[1])) mexErrMsgTxt("compute: second parameter must be the Nx2xF positions");
+		if (nlhs > 1) mexErrMsgTxt("compute: there is only 1 output value: strain");
+
+		const mwSize* dims = mxGetDimensions(prhs[1]);
+		int nbDims = mxGetNumberOfDimensions(prhs[1]);
+		int n = dims[0];
+		int nbFrames = nbDims > 2 ? dims[2] : 1;
+		if (nbDims > 3 || dims[1] != 2 || n != SF.nbMarkers()) mexErrMsgTxt("compute: the positions must be Nx2xF with the markers of the reference");
+		int nbThreads = nrhs >= 3 ? (int)mxGetScalar(prhs[2]) : 0;
+
+		int nrElements = SF.nbElements();
+		if (nrElements == 0) mexErrMsgTxt(message(-2));
+
+		// the components of an element are contiguous, matlab wants elements x components x frames
+		mwSize outDims[3] = {(mwSize)nrElements, 3, (mwSize)nbFrames};
+		plhs[0] = mxCreateNumericArray(3,outDims,mxSINGLE_CLASS,mxREAL);
+		if (nbFrames == 0) return;
+
+		strain.resize((size_t)3*nrElements*nbFrames);
+		double* positions = mxGetPr(prhs[1]);
+		const char* errmsg = message(SF.compute(positions, positions+n, 2*n, nbFrames, &strain[0], nbThreads));
+		if (strcmp("",errmsg)) mexErrMsgTxt(errmsg);
+
+		float* out = (float*)mxGetData(plhs[0]);
+		for (size_t f=0; f<(size_t)nbFrames; f++)
+		{
+			const float* in = &strain[3*nrElements*f];
+			float* frame = out + 3*nrElements*f;
+			for (int e=0; e<nrElements; e++)
+			{
+				for (int k=0; k<3; k++) frame[e+k*nrElements] = in[3*e+k];
+			}
+		}
+	} else {
+		mexErrMsgTxt("Unknown command");
+	}
+}
@@ -0,0 +1,96 @@
+/***************************************************
+Standalone blob tracking: decodes a video with FFGrabber
+and runs the native blob tracker on every frame, without
+Matlab.  One line is printed per frame with the time
+stamp followed by the x y centroid of each blob (in
+frame coordinates), as soon as the frame is decoded.
+
+With -follow the video may still be recording: at its end
+trackVideo waits for more frames and stops after the given
+number of seconds without any.  This needs a container that
+can be read while it is written (MPEG-TS, fragmented MP4,
+MPG), not one whose index is written when it is closed.
+
+usage: trackVideo [-follow seconds] video xmin ymin width height [threshold [blobs [blobArea]]]
+
+build: g++ -O2 trackVideo.cpp BlobTracker.cpp Threshold.cpp BinaryImage.cpp Labelling.cpp Prediction.cpp WorkerPool.cpp ../dataAPI/MappedFile.cpp -lavbin -pthread -o trackVideo
+**************************************************/
+
+#include "../frameGrabAPI/FFGrab.cpp"
+#include "BlobTracker.h"
+
+#include <math.h>
+
+struct Tracking
+{
+	BlobTracker BT;
+	int x0, y0;
+	vector<Blob> blobs;
+};
+
+static void trackFrame(void* user, const uint8_t* data, unsigned int /*nrBytes*/, int width, int height, double time, unsigned int /*frameNr*/)
+{
+	Tracking* T = (Tracking*)user;
+	double level;
+	// the blobs are reported in ROI coordinates
+	if (T->BT.track(interleavedView(data, width, height), T->blobs, &level) == 0)
+	{
+		FFprintf("%.8f",time);
+		for (size_t i=0; i<T->blobs.size(); i++) FFprintf("\t%.8f\t%.8f",T->x0+T->blobs[i].centroidX,T->y0+T->blobs[i].centroidY);
+		FFprintf("\n");
+		fflush(stdout);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double follow = 0;
+	if (argc > 2 && !strcmp(argv[1],"-follow"))
+	{
+		follow = atof(argv[2]);
+		argv[2] = argv[0];
+		argv += 2;
+		argc -= 2;
+	}
+
+	if (argc < 6)
+	{
+		FFprintf("usage: %s [-follow seconds] video xmin ymin width height [threshold [blobs [blobArea]]]\n",argv[0]);
+		return 1;
+	}
+
+	double threshold = argc > 6 ? atof(argv[6]) : -1;
+	int nrBlobs = argc > 7 ? atoi(argv[7]) : 3;
+	int blobArea = argc > 8 ? atoi(argv[8]) : 200;
+
+	Tracking T;
+	if (T.BT.setOptions(threshold, 3, 3, blobArea, nrBlobs) || T.BT.setROI(atof(argv[2]), atof(argv[3]), atof(argv[4]), atof(argv[5])))
+	{
+		FFprintf("invalid tracking options\n");
+		return 1;
+	}
+	T.x0 = max((int)floor(atof(argv[2])+0.5),1)-1;
+	T.y0 = max((int)floor(atof(argv[3])+0.5),1)-1;
+
+	FFGrabber FFG;
+	if (FFG.build(argv[1],false,true,true))
+	{
+		FFprintf("could not open %s\n",argv[1]);
+		return 1;
+	}
+	// every frame is tracked as it is decoded instead of being kept until the end of the video
+	FFG.setFrameCallback(trackFrame, &T);
+	FFG.setFollow(follow, 0.2);
+	FFG.doCapture();
+
+	int width, height, nrFramesCaptured, nrFramesTotal;
+	double rate, totalDuration;
+	if (FFG.getVideoInfo(0, &width, &height, &rate, &nrFramesCaptured, &nrFramesTotal, &totalDuration))
+	{
+		FFprintf("no video stream in %s\n",argv[1]);
+		return 1;
+	}
+
+	FFG.cleanUp();
+	return 0;
+}
@@ -0,0 +1,91 @@
+function timeOffset = syncStageLog(pfName_dataOutput,pfName_stageLog,varargin)
+%% Function description:
+% This function aligns the displacement measured by videoTracker with the
+% displacement logged by the tensile stage, which are started at
+% different moments, and saves a merged stress-strain table.
+% The offset between the two clocks is found by cross-correlating the two
+% displacement signals (~\library\dataAPI, see makeData.m), to a fraction
+% of the sampling interval of the stage log.
+%
+%% Syntax:
+%  timeOffset = syncStageLog(pfName_dataOutput,pfName_stageLog)
+%
+%% Input:
+%  pfName_dataOutput - @char, the vidExt_*.txt file of videoTracker.
+%  pfName_stageLog   - @char, the stage_*.txt log of the tensile stage.
+%
+%% Output:
+%  timeOffset   - @double, the stage time of a video time is the video
+%                 time + timeOffset.
+%  *_stressStrain.txt - a text file next to the vidExt_*.txt file with
+%                 the video time, the stage time, the strain measured on
+%                 the video and the stage columns at that time.
+%
+%% Options:
+% 'signal'     - @char, the column of the vidExt_*.txt file to align
+%                (default = 'Avg. blobDisplacement (mm)').
+% 'column'     - @char, the start of the name of the stage column to
+%                align it with (default = 'Displacement').
+% 'output'     - @cell, the starts of the names of the stage columns to
+%                save (default = {'Displacement','Force','Stress'}).
+% 'step'       - @double, the sampling interval in seconds of the
+%                correlation (default = 0, i.e. the larger interval of
+%                the two files).
+% 'maxOffset'  - @double, the largest offset in seconds to search
+%                (default = 0, i.e. any offset).
+% 'rate'       - correlates the rates of the signals instead of the
+%                signals, for tests with sharp changes of rate.
+%%
+
+
+%% Read the video measurements
+fid = fopen(pfName_dataOutput,'rt');
+videoHeader = strtrim(strsplit(fgetl(fid),'\t'));
+fclose(fid);
+videoData = dlmread(pfName_dataOutput,'\t',1,0);
+videoTime = videoData(:,1);
+videoColumn = find(strcmp(videoHeader,get_option(varargin,'signal','Avg. blobDisplacement (mm)')),1);
+if isempty(videoColumn)
+    error('syncStageLog: the signal is not a column of %s',pfName_dataOutput);
+end
+
+% Engineering strain between the two blobs furthest apart
+distanceColumns = find(strncmp(videoHeader,'blobDistance_',13));
+displacementColumns = find(strncmp(videoHeader,'blobDisplacement_',17));
+[initialDistance,pair] = max(videoData(1,distanceColumns));
+videoStrain = 100 .* videoData(:,displacementColumns(pair)) ./ initialDistance;
+%%
+
+
+%% Align the stage log
+stageColumns = mexStageLog('open',pfName_stageLog);
+stageColumn = find(strncmp(stageColumns,get_option(varargin,'column','Displacement'),length(get_option(varargin,'column','Displacement'))),1);
+if isempty(stageColumn)
+    mexStageLog('close');
+    error('syncStageLog: the column is not in %s',pfName_stageLog);
+end
+[timeOffset,score] = mexStageLog('synchronise',videoTime,videoData(:,videoColumn),stageColumn,...
+    get_option(varargin,'step',0),get_option(varargin,'maxOffset',0),check_option(varargin,'rate'));
+disp(['Stage time = video time + ',num2str(timeOffset),' s (correlation = ',num2str(score),')']);
+%%
+
+
+%% Save the merged stress-strain table
+outputNames = get_option(varargin,'output',{'Displacement','Force','Stress'});
+outputColumns = [];
+for ii = 1:length(outputNames)
+    outputColumns = [outputColumns, find(strncmp(stageColumns,outputNames{ii},length(outputNames{ii})),1)];
+end
+stageData = mexStageLog('interpolate',videoTime + timeOffset,outputColumns);
+mexStageLog('close');
+
+fileHeader = [{'Time (s)','Stage time (s)',sprintf('Strain_%s (%%)',videoHeader{displacementColumns(pair)}(18:end-5))},...
+    stageColumns(outputColumns)];
+fileData = [videoTime, videoTime + timeOffset, videoStrain, stageData]';
+fid = fopen([pfName_dataOutput(1:end-4),'_stressStrain.txt'],'wt');
+fprintf(fid,[repmat('%s\t',1,length(fileHeader)-1),'%s\n'],fileHeader{:});
+fprintf(fid,[repmat('%.8f\t',1,length(fileHeader)),'\n'],fileData);
+fclose(fid);
+%%
+
+end
@@ -43,6 +43,53 @@ function videoTracker(varargin)
 %                distiniguish the blobs from the background.
 % 'filter'     - @double, a [1 x 2] vector defining the median filter mask
 %                size.
+% 'native'     - use the compiled blob tracker (~\library\trackerAPI, see
+%                makeTracker.m) instead of the image processing and
+%                computer vision toolboxes.
+% 'drift'      - @double, with 'native' and no 'threshold', keeps the
+%                previous frame's threshold until the ROI histogram has
+%                drifted by more than this fraction (default = 0, i.e.
+%                recompute every frame).
+% 'sampling'   - @double, with 'native' and no 'threshold', computes the
+%                threshold from every n-th pixel of the ROI (default = 1).
+% 'threads'    - @double, with 'native', the number of threads the ROI is
+%                tracked with (default = 0, i.e. one per core).
+% 'predict'    - @char, with 'native', follows the blobs from frame to
+%                frame and only searches small windows around their
+%                predicted positions: 'velocity' (constant velocity) or
+%                'kalman' (default = none, i.e. search the whole ROI).
+% 'window'     - @double, with 'predict', the margin in pixels added
+%                around the last bounding box of a blob (default = 10).
+% 'correlation'- follow the blobs found in the first frame by subset
+%                correlation (~\library\trackerAPI, see makeTracker.m)
+%                instead of segmenting every frame, for specimens whose
+%                markers are too faint to be thresholded reliably.
+% 'subset'     - @double, with 'correlation', the side of the square
+%                subsets in pixels (default = 31).
+% 'search'     - @double, with 'correlation', the largest displacement
+%                between two frames in pixels of the coarsest pyramid
+%                level (default = 16).
+% 'levels'     - @double, with 'correlation', the number of pyramid
+%                levels (default = 3).
+% 'match'      - @double, with 'native', the largest displacement in
+%                pixels of a blob between two frames; the blobs are
+%                matched to those of the previous frame by position
+%                instead of by the order they are detected in
+%                (default = 20).
+% 'projection'- sums the columns of the ROI into an intensity profile and
+%                tracks the blobs as the peaks of the profile, along x
+%                only (~\library\trackerAPI, see makeTracker.m); much
+%                faster than segmenting the ROI, for blobs that are
+%                side by side along the gauge length.
+% 'polarity'   - @double, with 'projection', 1 for blobs brighter than
+%                the background, -1 for darker ones (default = 1).
+% 'binary'     - also saves the data to vidExt_*.bin, a binary columnar
+%                file that reloads much faster than the *.txt file
+%                (~\library\dataAPI, see makeData.m and mexResultStore).
+% 'strain'     - with a grid of blobs, triangulates the blobs of the
+%                first frame and saves the Green-Lagrange strain of every
+%                triangle in every frame to vidExt_*_strain.mat
+%                (~\library\trackerAPI, see makeTracker.m).
 %
 
 
@@ -53,6 +100,11 @@ numBlobs = get_option(varargin,'blobs',3);
 blobArea = get_option(varargin,'blobArea',200);
 frameRate = get_option(varargin,'frames',5);
 medfilterSize = get_option(varargin,'filter',[3 3]);
+useNative = check_option(varargin,'native');
+useCorrelation = check_option(varargin,'correlation');
+subsetSize = get_option(varargin,'subset',31);
+useStrain = check_option(varargin,'strain');
+useProjection = check_option(varargin,'projection');
 
 
 %% Default directories - Do not modify
@@ -304,12 +356,41 @@ clf; close all;
 
 
 %% Define the blobs to track
-% Set the handler for blob analysis
-hblob = vision.BlobAnalysis('AreaOutputPort', false, ...
-    'CentroidOutputPort', true, ...
-    'BoundingBoxOutputPort', true', ...
-    'MinimumBlobArea', blobArea, ...
-    'MaximumCount', numBlobs);
+% Set the handler for blob analysis, only the toolbox path needs the
+% Computer Vision Toolbox
+if ~useNative && ~useCorrelation && ~useProjection
+    hblob = vision.BlobAnalysis('AreaOutputPort', false, ...
+        'CentroidOutputPort', true, ...
+        'BoundingBoxOutputPort', true', ...
+        'MinimumBlobArea', blobArea, ...
+        'MaximumCount', numBlobs);
+end
+% Set up the native blob tracker with the same options, it also places the
+% subsets of the correlation tracker in the first frame
+if useNative || useCorrelation
+    mexBlobTracker('setOptions',get_option(varargin,'threshold',[]),medfilterSize,blobArea,numBlobs);
+    mexBlobTracker('setThresholdOptions',get_option(varargin,'drift',0),get_option(varargin,'sampling',1));
+    mexBlobTracker('setThreads',get_option(varargin,'threads',0));
+    predictionMode = find(strcmpi(get_option(varargin,'predict','none'),{'velocity','kalman'}));
+    if isempty(predictionMode)
+        predictionMode = 0;
+    end
+    mexBlobTracker('setPrediction',predictionMode,get_option(varargin,'window',10));
+    mexBlobTracker('setROI',roiPosition);
+end
+% Set up the correlation tracker, the subsets are placed on the blobs of
+% the first frame
+if useCorrelation
+    mexCorrelationTracker('setOptions',subsetSize,get_option(varargin,'search',16),get_option(varargin,'levels',3),get_option(varargin,'threads',0));
+    % offset from the ROI (imcrop) to the frame coordinates
+    roiOffset = max(round(roiPosition(1:2)),1) - 1;
+end
+% Set up the projection tracker, the profile is smoothed along x as the
+% median filter does
+if useProjection
+    mexProjectionTracker('setOptions',numBlobs,2*floor(medfilterSize(2)/2)+1,get_option(varargin,'polarity',1),get_option(varargin,'window',10));
+    mexProjectionTracker('setROI',roiPosition);
+end
 %%
 
 
@@ -321,6 +402,8 @@ if ~exist(outputSubfolder, 'dir')
 end
 pfName_dataOutput = [outputSubfolder,'/vidExt_',fileName(1:end-4),'.txt'];
 pfName_videoOutput = [outputSubfolder,'/vidExt_',fileName(1:end-4),'.avi'];
+pfName_binaryOutput = [outputSubfolder,'/vidExt_',fileName(1:end-4),'.bin'];
+pfName_strainOutput = [outputSubfolder,'/vidExt_',fileName(1:end-4),'_strain.mat'];
 %%
 
 
@@ -348,36 +431,87 @@ set(f,'position',[(screenWidth-figWidth)/2,...
     figHeight]);
 
 coordinates = zeros(numBlobs,2,numFrames2Analyse); % rows = number of blobs; columns = X and Y co-ordinates
+markerPositions = zeros(numBlobs,2,numFrames2Analyse); % as coordinates, without the horizontal line
 displacement_eachBlob = zeros(numFrames2Analyse,numBlobs); % columns = number of blobs
 avgDisplacement_eachBlob = zeros(numFrames2Analyse,1);
 
-distance_12 = zeros(numFrames2Analyse,1);
-distance_13 = zeros(numFrames2Analyse,1);
-distance_23 = zeros(numFrames2Analyse,1);
-displacement_12 = zeros(numFrames2Analyse,1);
-displacement_13 = zeros(numFrames2Analyse,1);
-displacement_23 = zeros(numFrames2Analyse,1);
+% Every pair of blobs, in the order of pdist (1-2, 1-3, ..., 2-3, ...)
+[pairB, pairA] = find(tril(true(numBlobs),-1));
+numPairs = length(pairA);
+distance_betweenBlobs = zeros(numFrames2Analyse,numPairs); % columns = pairs of blobs
+displacement_betweenBlobs = zeros(numFrames2Analyse,numPairs); % columns = pairs of blobs
 avgDisplacement_betweenBlobs = zeros(numFrames2Analyse,1);
+% Blob and pair names and colours for the plots and the data file
+if numBlobs <= 9
+    pairFormat = 'B%d%d';
+else
+    pairFormat = 'B%d-%d';
+end
+blobNames = arrayfun(@(i) sprintf('B%d',i),1:numBlobs,'UniformOutput',false);
+pairNames = arrayfun(@(k) sprintf(pairFormat,pairA(k),pairB(k)),1:numPairs,'UniformOutput',false);
+pairLegend = arrayfun(@(k) sprintf('B%d-B%d',pairA(k),pairB(k)),1:numPairs,'UniformOutput',false);
+if numBlobs <= 3
+    blobColours = [1 0 0; 0 1 0; 0 0 1];
+    pairColours = [0 1 1; 1 0 1; 1 1 0];
+else
+    blobColours = lines(numBlobs);
+    pairColours = lines(numPairs);
+end
+matchDistance = get_option(varargin,'match',20);
 
 for frameNumber = 1:numFrames2Analyse
 
     % Crop the frame to the ROI for analysis
     %     currentFrame = videoFrames2Analyse.frames(1,frameNumber).cdata;
     currentFrame = videoFrames2Analyse{frameNumber};
-    roi2Analyse = imcrop(currentFrame,roiPosition);
-
-    %% ROI image processing
-    % Define a threshold
-    level = get_option(varargin,'threshold',graythresh(roi2Analyse));
-    % Binarise the image using the threshold
-    roiBinary = imbinarize(roi2Analyse,level);
-    % Dilate the white regions
-    roiDilate = bwmorph(roiBinary(:,:,1),'dilate');
-    % Filter out the noise by using a median filter (default = 3x3)
-    roiMedianFilter = medfilt2(roiDilate, medfilterSize);
-    % Get the coordinates of the centroids and bounding boxes of the blobs
-    [centroid, bBox] = step(hblob, roiMedianFilter);
+
+    if useProjection
+        %% Peaks of the column profile of the ROI, the y coordinate is
+        % the middle of the ROI
+        roiMedianFilter = imcrop(currentFrame,roiPosition);
+        [blobX, blobEdges] = mexProjectionTracker('track',currentFrame);
+        roiHeight = size(roiMedianFilter,1);
+        centroid = [blobX, repmat((roiHeight+1)/2,size(blobX))];
+        bBox = int32([blobEdges(:,1), ones(size(blobX)), diff(blobEdges,1,2), repmat(roiHeight,size(blobX))]);
+    elseif useCorrelation && frameNumber > 1
+        %% Follow the subsets of the first frame
+        roiMedianFilter = imcrop(currentFrame,roiPosition);
+        centroid = bsxfun(@minus,mexCorrelationTracker('track',currentFrame),roiOffset);
+        bBox = int32([centroid - subsetSize/2, repmat(subsetSize,size(centroid,1),2)]);
+    elseif useNative || useCorrelation
+        %% ROI image processing in a single pass (crop, threshold, dilate,
+        % median filter and blob analysis)
+        [centroid, bBox, ~, roiMedianFilter] = mexBlobTracker('track',currentFrame);
+    else
+        roi2Analyse = imcrop(currentFrame,roiPosition);
+
+        %% ROI image processing
+        % Define a threshold
+        level = get_option(varargin,'threshold',graythresh(roi2Analyse));
+        % Binarise the image using the threshold
+        roiBinary = imbinarize(roi2Analyse,level);
+        % Dilate the white regions
+        roiDilate = bwmorph(roiBinary(:,:,1),'dilate');
+        % Filter out the noise by using a median filter (default = 3x3)
+        roiMedianFilter = medfilt2(roiDilate, medfilterSize);
+        % Get the coordinates of the centroids and bounding boxes of the blobs
+        [centroid, bBox] = step(hblob, roiMedianFilter);
+    end
+    if useNative && ~useCorrelation && ~useProjection
+        % Keep the identity of the blobs from frame to frame
+        if frameNumber == 1
+            mexMarkerTracker('setReference',double(centroid));
+        else
+            [centroid, blobFound, blobIndex] = mexMarkerTracker('match',double(centroid),matchDistance);
+            bBox(blobFound,:) = bBox(blobIndex(blobFound),:);
+            bBox(~blobFound,:) = 0;
+        end
+    end
+    if useCorrelation && frameNumber == 1
+        mexCorrelationTracker('setReference',currentFrame,bsxfun(@plus,double(centroid),roiOffset));
+    end
     coordinates(:,:,frameNumber) = centroid;
+    markerPositions(:,:,frameNumber) = bsxfun(@plus,double(centroid),roiPosition(1:2));
 
     % To ensure a horizontal line is always calculated, force the lines to 
     % be horizontal by adjusting the y-coordinates
@@ -386,42 +520,34 @@ for frameNumber = 1:numFrames2Analyse
     coordinates(:, 1, frameNumber) = roiPosition(1) + coordinates(:, 1, frameNumber);
     coordinates(:, 2, frameNumber) = roiPosition(2) + coordinates(:, 2, frameNumber);
 
-    % Distance between the blobs in the current frame
-    distance_12(frameNumber,1) = calibration .* sqrt((coordinates(1,1,frameNumber)-coordinates(2,1,frameNumber)).^2 +...
-        (coordinates(1,2,frameNumber)-coordinates(2,2,frameNumber)).^2);
-    distance_13(frameNumber,1) = calibration .* sqrt((coordinates(1,1,frameNumber)-coordinates(3,1,frameNumber)).^2 +...
-        (coordinates(1,2,frameNumber)-coordinates(3,2,frameNumber)).^2);
-    distance_23(frameNumber,1) = calibration .* sqrt((coordinates(2,1,frameNumber)-coordinates(3,1,frameNumber)).^2 +...
-        (coordinates(2,2,frameNumber)-coordinates(3,2,frameNumber)).^2);
-
-    if frameNumber > 1
-        % Displacement of each blob between the current and starting frames
+    % Distance between the blobs in the current frame, displacement of
+    % each blob and between the blobs from the starting frame
+    if useNative
+        [displacement_eachBlob(frameNumber,:), distance_betweenBlobs(frameNumber,:), displacement_betweenBlobs(frameNumber,:)] = ...
+            mexMarkerTracker('measure',coordinates(:,:,frameNumber),coordinates(:,:,1),calibration);
+    else
+        distance_betweenBlobs(frameNumber,:) = (calibration .* sqrt((coordinates(pairA,1,frameNumber)-coordinates(pairB,1,frameNumber)).^2 +...
+            (coordinates(pairA,2,frameNumber)-coordinates(pairB,2,frameNumber)).^2))';
         displacement_eachBlob(frameNumber,:) = (calibration .* sqrt((coordinates(:,1,frameNumber)-coordinates(:,1,1)).^2 +...
             (coordinates(:,2,frameNumber)-coordinates(:,2,1)).^2))';
-        avgDisplacement_eachBlob(frameNumber,1) = mean(displacement_eachBlob(frameNumber,:));
-
-        % Displacement between blobs between the current and starting frames
-        displacement_12(frameNumber,1) = distance_12(frameNumber,1) - distance_12(1,1);
-        displacement_13(frameNumber,1) = distance_13(frameNumber,1) - distance_13(1,1);
-        displacement_23(frameNumber,1) = distance_23(frameNumber,1) - distance_23(1,1);
-        avgDisplacement_betweenBlobs(frameNumber,1) = mean([displacement_12(frameNumber,1),...
-            displacement_13(frameNumber,1),...
-            displacement_23(frameNumber,1)]);
+        displacement_betweenBlobs(frameNumber,:) = distance_betweenBlobs(frameNumber,:) - distance_betweenBlobs(1,:);
     end
+    avgDisplacement_eachBlob(frameNumber,1) = mean(displacement_eachBlob(frameNumber,:));
+    avgDisplacement_betweenBlobs(frameNumber,1) = mean(displacement_betweenBlobs(frameNumber,:));
 
     %% Sub-plot 1: Processed image of the blobs
     subplot(1,3,1);
     % Plot the image processed blobs
     imshow(roiMedianFilter);
     hold all
-    % Plot a cross marker at their centroids
-    plot(centroid(1,1),centroid(1,2),'r+','MarkerSize',12,'LineWidth',1);
-    plot(centroid(2,1),centroid(2,2),'g+','MarkerSize',12,'LineWidth',1);
-    plot(centroid(3,1),centroid(3,2),'b+','MarkerSize',12,'LineWidth',1);
-    % Plot a rectangular bounding box around each blob
-    rectangle('Position',[bBox(1,1) bBox(1,2) bBox(1,3) bBox(1,4)],'EdgeColor','r','LineWidth',2);
-    rectangle('Position',[bBox(2,1) bBox(2,2) bBox(2,3) bBox(2,4)],'EdgeColor','g','LineWidth',2);
-    rectangle('Position',[bBox(3,1) bBox(3,2) bBox(3,3) bBox(3,4)],'EdgeColor','b','LineWidth',2);
+    for ii = 1:numBlobs
+        % Plot a cross marker at their centroids
+        plot(centroid(ii,1),centroid(ii,2),'+','Color',blobColours(ii,:),'MarkerSize',12,'LineWidth',1);
+        % Plot a rectangular bounding box around each blob
+        if all(bBox(ii,3:4) > 0)
+            rectangle('Position',double(bBox(ii,:)),'EdgeColor',blobColours(ii,:),'LineWidth',2);
+        end
+    end
     hold off
     set(gca,'units','pixels','nextplot','replacechildren');
     %%
@@ -443,22 +569,16 @@ for frameNumber = 1:numFrames2Analyse
         'nextplot','add');
     xlabel('Time (s)');%,'fontSize',12);
     ylabel('Displacement between frames (mm)');%,'fontSize',12);
-    plot(timeStamp(1:frameNumber),displacement_eachBlob(1:frameNumber,1),'.-r',...
-        timeStamp(1:frameNumber),displacement_eachBlob(1:frameNumber,2),'.-g',...
-        timeStamp(1:frameNumber),displacement_eachBlob(1:frameNumber,3),'.-b',...
-        timeStamp(1:frameNumber),avgDisplacement_eachBlob(1:frameNumber,1),'.-k');
-    legend({'B1','B2','B3','AVG'},'location','southoutside','orientation','horizontal');
+    set(gca,'colororder',[blobColours; 0 0 0]);
+    plot(timeStamp(1:frameNumber),[displacement_eachBlob(1:frameNumber,:),avgDisplacement_eachBlob(1:frameNumber,1)],'.-');
+    legend([blobNames,{'AVG'}],'location','southoutside','orientation','horizontal');
 
 
     %% Sub-plot 3: Displacement between blobs between current and starting frames
     subplot(1,3,3);
     axis square
-    if max(max([displacement_12,...
-            displacement_13,...
-            displacement_23])) ~= 0
-        yLimits3 = [0,max(max([displacement_12,...
-            displacement_13,...
-            displacement_23]))];
+    if max(max(displacement_betweenBlobs)) ~= 0
+        yLimits3 = [0,max(max(displacement_betweenBlobs))];
     else
         yLimits3 = [0,0.0001];
     end
@@ -469,11 +589,9 @@ for frameNumber = 1:numFrames2Analyse
         'nextplot','add');
     xlabel('Time (s)');
     ylabel('Displacement between blobs (mm)');
-    plot(timeStamp(1:frameNumber),displacement_12(1:frameNumber,1),'.-c',...
-        timeStamp(1:frameNumber),displacement_13(1:frameNumber,1),'.-m',...
-        timeStamp(1:frameNumber),displacement_23(1:frameNumber,1),'.-y',...
-        timeStamp(1:frameNumber),avgDisplacement_betweenBlobs(1:frameNumber,1),'.-k');
-    legend({'B1-B2','B1-B3','B2-B3','AVG'},'location','southoutside','orientation','horizontal');
+    set(gca,'colororder',[pairColours; 0 0 0]);
+    plot(timeStamp(1:frameNumber),[displacement_betweenBlobs(1:frameNumber,:),avgDisplacement_betweenBlobs(1:frameNumber,1)],'.-');
+    legend([pairLegend,{'AVG'}],'location','southoutside','orientation','horizontal');
     %%
 
     writeVideo(videoObj, getframe(f));
@@ -500,36 +618,48 @@ disp('...')
 tic
 disp('...')
 disp('Saving data...')
-fileHeader = {'Time (s)',...
-    'frameDisplacement_B1 (mm)',...
-    'frameDisplacement_B2 (mm)',...
-    'frameDisplacement_B3 (mm)',...
-    'Avg. frameDisplacement (mm)',...
-    'blobDistance_B12 (mm)',...
-    'blobDistance_B13 (mm)',...
-    'blobDistance_B23 (mm)',...
-    'blobDisplacement_B12 (mm)',...
-    'blobDisplacement_B13 (mm)',...
-    'blobDisplacement_B23 (mm)',...
-    'Avg. blobDisplacement (mm)'};
+fileHeader = [{'Time (s)'},...
+    strcat('frameDisplacement_',blobNames,' (mm)'),...
+    {'Avg. frameDisplacement (mm)'},...
+    strcat('blobDistance_',pairNames,' (mm)'),...
+    strcat('blobDisplacement_',pairNames,' (mm)'),...
+    {'Avg. blobDisplacement (mm)'}];
 fileData = [timeStamp,...
-    displacement_eachBlob(:,1),...
-    displacement_eachBlob(:,2),...
-    displacement_eachBlob(:,3),...
+    displacement_eachBlob,...
     avgDisplacement_eachBlob(:,1),...
-    distance_12(:,1),...
-    distance_13(:,1),...
-    distance_23(:,1),...
-    displacement_12(:,1),...
-    displacement_13(:,1),...
-    displacement_23(:,1),...
+    distance_betweenBlobs,...
+    displacement_betweenBlobs,...
     avgDisplacement_betweenBlobs(:,1)]';
 fid = fopen(pfName_dataOutput,'wt');
-fprintf(fid,'%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n',fileHeader{:});
-fprintf(fid,'%.8f\t%.8f\t%.8f\t%.8f\t%.8f\t%.8f\t%.8f\t%.8f\t%.8f\t%.8f\t%.8f\t%.8f\t\n',fileData);
+fprintf(fid,[repmat('%s\t',1,length(fileHeader)-1),'%s\n'],fileHeader{:});
+fprintf(fid,[repmat('%.8f\t',1,length(fileHeader)),'\n'],fileData);
 fclose(fid);
+if check_option(varargin,'binary')
+    % the store appends to an existing file, start a new one; every column
+    % is measured, none is constant enough for the delta encoding
+    if exist(pfName_binaryOutput,'file')
+        delete(pfName_binaryOutput);
+    end
+    mexResultStore('write',pfName_binaryOutput,fileHeader,fileData','double');
+end
 toc
 disp('...')
 %%
 
+
+%% Save the *.mat strain file
+if useStrain
+    tic
+    disp('...')
+    disp('Saving strain field...')
+    % triangles = elements x 3 blob indices; strainField = elements x
+    % [exx eyy exy] x frames
+    triangles = mexStrainField('setReference',markerPositions(:,:,1));
+    strainField = mexStrainField('compute',markerPositions,get_option(varargin,'threads',0));
+    save(pfName_strainOutput,'timeStamp','markerPositions','triangles','strainField','calibration');
+    toc
+    disp('...')
+end
+%%
+
 end